@@ -19,6 +19,7 @@
 #include <iomanip>
 #include <sstream>
 #include <fstream>
+#include <limits>
 
 #include <Poco/Path.h>
 #include <Poco/File.h>
@@ -328,6 +329,15 @@ namespace audioutil
             std::bind( &CAudioUtil::ParseOptionNoConvertSamples, &GetInstance(), placeholders::_1 ),
         },
 
+        //smplcache
+        {
+            "smplcache",
+            1,
+            "Sets how many megabytes of samples converted to pcm16 are kept in memory while baking samples, so they aren't converted again for every split using them. Defaults to 64.",
+            "-smplcache (nbmegabytes)",
+            std::bind( &CAudioUtil::ParseOptionSampleCacheSize, &GetInstance(), placeholders::_1 ),
+        },
+
         //match blob scanned containers by internal name
         {
             "nmatchoff",
@@ -382,6 +392,7 @@ namespace audioutil
         m_bMakeCvinfo     = false;
         m_bConvertSamples = true;
         m_bmatchbyname    = true;
+        m_smplcachebudget = DSE::DecodedSampleCache::DefaultBudget;
         m_nbloops         = 0;
         m_outtype         = eOutputType::SF2;
     }
@@ -795,6 +806,22 @@ namespace audioutil
         return true;
     }
 
+    bool CAudioUtil::ParseOptionSampleCacheSize( const std::vector<std::string> & optdata )
+    {
+        stringstream conv;
+        size_t       nbmegabytes = 0;
+        conv << optdata[1];
+        conv >> nbmegabytes;
+
+        if( conv.fail() || nbmegabytes > (std::numeric_limits<size_t>::max() / (1024 * 1024)) )
+        {
+            cerr <<"<!>- ERROR: Invalid sample cache size \"" <<optdata[1] <<"\"! Expected a number of megabytes!\n";
+            return false;
+        }
+        m_smplcachebudget = nbmegabytes * 1024 * 1024;
+        return true;
+    }
+
 //------------------------------------------------
 //  Program Setup and Execution
 //------------------------------------------------
@@ -1848,6 +1875,7 @@ namespace audioutil
 
     void CAudioUtil::DoExportLoader( DSE::BatchAudioLoader & bal, const std::string & outputpath )
     {
+        bal.SetSampleCacheBudget( m_smplcachebudget );
         cout << "-------------------------------------------------------------\n";
         if( m_outtype == eOutputType::SF2 )
         {
@@ -89,6 +89,8 @@ namespace audioutil
 
         bool ParseOptionMatchByName(const std::vector<std::string> & optdata);
 
+        bool ParseOptionSampleCacheSize( const std::vector<std::string> & optdata );
+
         //Execution
         void DetermineOperation();
         int  Execute           ();
@@ -183,6 +185,7 @@ namespace audioutil
         bool        m_bMakeCvinfo;      //Whether we should export a blank cvinfo file!
         bool        m_bConvertSamples;  //Whether the samples should be converted to pcm16 when exporting
         bool        m_bmatchbyname;     //Whether the containers inside a blob should be matched by internal name or simply matched by order in the blob.
+        size_t      m_smplcachebudget;  //Max amount of bytes of converted samples kept in memory while baking samples.
         
         //bool        m_bForceMidiExp;    //Whether the user is forcing MIDI export.
 
@@ -12,6 +12,9 @@ Description:
 #include <vector>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <utils/parallel_tasks.hpp>
 #include <dse/dse_common.hpp>
 #include <dse/dse_containers.hpp>
 
@@ -37,6 +40,8 @@ namespace DSE
         static const uint8_t FirstCharacterDSEMagicNum = 0x73;
         static const size_t  OffsetDSECntFilename      = 32;
         static const size_t  FilenameLength            = 16;
+        static const size_t  ParallelScanMinLength     = 4 * 1024 * 1024; //Blobs smaller than this are searched on a single thread
+        static const size_t  ParallelScanChunkLength   = 1024 * 1024;     //Size of the chunks larger blobs are split into for searching
         
         BlobScanner( inputiterator beg, inputiterator end, bool matchbynames = true )
             :m_srcbeg(beg), m_srcend(end), m_bmatchbyname(matchbynames)
@@ -46,11 +51,16 @@ namespace DSE
             Scan
                 Finds all DSE containers within a blob of data.
                 Store them in a ToC to allow easy retrieval later on.
+
+                Any header that lies within a container already found is skipped. 
+                Large blobs are searched for headers in parallel chunks first, when there's more than one thread to use.
         */
         size_t Scan( bool bquiet = false )
         {
             using namespace std;
-            size_t offset = 0;
+            const size_t srclen = static_cast<size_t>( std::distance( m_srcbeg, m_srcend ) );
+            size_t       offset = 0; //Offset of the end of the last container found
+            m_toc.clear();
 
             if( utils::LibWide().isLogOn() )
             {
@@ -59,44 +69,44 @@ namespace DSE
                      <<"========================================\n";
             }
 
-            for( auto itby = m_srcbeg; itby != m_srcend;  )
+            auto lambdaHandle = [&]( const HeaderCandidate & cand )
             {
-                if( *itby == FirstCharacterDSEMagicNum )
-                {
-                    //Try to see if its indeed the beginning of a DSE header!
-                    uint32_t fullmagic   = 0;
-                    auto     itbefmagicn = itby; //Save our position before the magic number
-                    auto     aftermagicn = utils::ReadIntFromBytes( fullmagic, itby, m_srcend, false );
+                inputiterator itbefmagicn = m_srcbeg;
+                std::advance( itbefmagicn, cand._offset );
+                inputiterator aftermagicn = itbefmagicn;
+                std::advance( aftermagicn, sizeof(uint32_t) );
 
-                    eDSEContainers cntty = IntToContainerMagicNum( fullmagic );
-                    if( cntty != eDSEContainers::invalid )
-                    {
-                        size_t possibleoffset = offset;
-                        itby = HandleContainer( aftermagicn, itbefmagicn, cntty, offset );
+                //The size in the header may go past the end of the blob, so resume from where the container was clamped to
+                offset = cand._offset;
+                offset = static_cast<size_t>( std::distance( m_srcbeg, HandleContainer( aftermagicn, itbefmagicn, cand._type, offset ) ) );
 
-                        if(!bquiet)
-                        {
-                            stringstream sstr;
-                            sstr << "<*>- Found container off: 0x" <<hex <<uppercase <<possibleoffset <<nouppercase <<dec <<", " <<m_toc.back()._name <<", of type " <<hex <<showbase <<cntty <<noshowbase <<dec <<" !\n";
-                            string txt = sstr.str();
-                            cout << txt;
+                if(!bquiet)
+                {
+                    stringstream sstr;
+                    sstr << "<*>- Found container off: 0x" <<hex <<uppercase <<cand._offset <<nouppercase <<dec <<", " <<m_toc.back()._name <<", of type " <<hex <<showbase <<cand._type <<noshowbase <<dec <<" !\n";
+                    string txt = sstr.str();
+                    cout << txt;
 
-                            if( utils::LibWide().isLogOn() )
-                                clog << txt;
-                        }
-                    }
-                    else
-                    {
-                        ++itby; 
-                        ++offset;
-                    }
+                    if( utils::LibWide().isLogOn() )
+                        clog << txt;
                 }
-                else
+            };
+
+            if( srclen >= ParallelScanMinLength && utils::LibWide().getNbThreadsToUse() > 1 )
+            {
+                for( const auto & cand : FindAllHeaders(srclen) )
                 {
-                    ++itby; 
-                    ++offset;
+                    if( cand._offset >= offset )
+                        lambdaHandle(cand);
                 }
             }
+            else
+            {
+                //Searching from the end of the last container, we never look at the content of containers
+                HeaderCandidate cand;
+                while( FindNextHeader( offset, srclen, cand ) )
+                    lambdaHandle(cand);
+            }
 
             if( utils::LibWide().isLogOn() )
                 clog <<"\n\n";
@@ -183,6 +193,74 @@ namespace DSE
 
     private:
 
+        struct HeaderCandidate
+        {
+            size_t         _offset;
+            eDSEContainers _type;
+        };
+
+        /*
+            FindAllHeaders
+                Returns the offset of all valid DSE headers in the blob, in order, including those within other containers.
+                The blob is split into chunks searched in parallel.
+        */
+        std::vector<HeaderCandidate> FindAllHeaders( size_t srclen )const
+        {
+            //Only the first byte of a header has to be within a chunk, the rest is read from the whole blob.
+            // So headers straddling the end of a chunk are found too.
+            const size_t                              chunklen = ParallelScanChunkLength;
+            const size_t                              nbchunks = (srclen + chunklen - 1) / chunklen;
+            std::vector<std::vector<HeaderCandidate>> found(nbchunks);
+            utils::parallel_for( 0, nbchunks, 1, [&]( size_t i )
+            {
+                const size_t    chunkbeg = i * chunklen;
+                const size_t    chunkend = (srclen - chunkbeg > chunklen)? (chunkbeg + chunklen) : srclen;
+                HeaderCandidate cand;
+                for( size_t off = chunkbeg; FindNextHeader( off, chunkend, cand ); off = cand._offset + 1 )
+                    found[i].push_back(cand);
+            });
+
+            std::vector<HeaderCandidate> merged;
+            for( auto & chunk : found )
+                merged.insert( merged.end(), chunk.begin(), chunk.end() );
+            return std::move(merged);
+        }
+
+        //Search for the first valid header beginning between the 2 offsets. Returns false if there are none.
+        bool FindNextHeader( size_t begoff, size_t endoff, HeaderCandidate & out )const
+        {
+            const uint8_t firstchar = FirstCharacterDSEMagicNum; //std::find takes the value by reference
+            inputiterator itcur     = m_srcbeg;
+            inputiterator itend     = m_srcbeg;
+            std::advance( itcur, begoff );
+            std::advance( itend, endoff );
+
+            //std::find on bytes gets turned into a memchr by the standard library, which is much faster than a byte by byte loop
+            for( itcur = std::find( itcur, itend, firstchar ); itcur != itend; itcur = std::find( ++itcur, itend, firstchar ) )
+            {
+                eDSEContainers cntty = ValidateHeader(itcur);
+                if( cntty != eDSEContainers::invalid )
+                {
+                    out = HeaderCandidate{ static_cast<size_t>(std::distance( m_srcbeg, itcur )), cntty };
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //Returns the type of container whose header begins at itmagicnum, or invalid if there's no valid header there.
+        eDSEContainers ValidateHeader( inputiterator itmagicnum )const
+        {
+            //There must be room for the whole header, up to the end of the internal filename
+            if( std::distance( itmagicnum, m_srcend ) < static_cast<ptrdiff_t>(OffsetDSECntFilename + FilenameLength) )
+                return eDSEContainers::invalid;
+
+            //Magic numbers are big endian. We know there's room, so read the bytes directly.
+            const uint32_t fullmagic = (static_cast<uint32_t>(itmagicnum[0]) << 24) | (static_cast<uint32_t>(itmagicnum[1]) << 16) | 
+                                       (static_cast<uint32_t>(itmagicnum[2]) <<  8) |  static_cast<uint32_t>(itmagicnum[3]);
+            return IntToContainerMagicNum( fullmagic );
+        }
+
         inputiterator HandleContainer( inputiterator itaftermagicnum, inputiterator itbefmagicnum, eDSEContainers cnty, size_t & offset )
         {
             using namespace std;
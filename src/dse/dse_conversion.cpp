@@ -524,6 +524,109 @@ namespace DSE
             return eDSESmplFmt::invalid;
     }
 
+    size_t GetConvertedDSESampleInfo( int16_t                                smplfmt, 
+                                      size_t                                 origloopbeg,
+                                      size_t                                 rawlen,
+                                      DSESampleConvertionInfo              & out_cvinfo )
+    {
+        size_t smpllen = 0;
+        if( smplfmt == static_cast<uint16_t>(eDSESmplFmt::ima_adpcm) )
+        {
+            smpllen = (rawlen > ::audio::IMA_ADPCM_PreambleLen)? ::audio::ADPCMSzToPCM16Sz(rawlen) : 0;
+            out_cvinfo.loopbeg_ = (origloopbeg - SizeADPCMPreambleWords) * 8; //Same as ConvertDSESample
+        }
+        else if( smplfmt == static_cast<uint16_t>(eDSESmplFmt::pcm8) )
+        {
+            smpllen = rawlen; //One pcm16 sample per pcm8 byte
+            out_cvinfo.loopbeg_ = origloopbeg * 4;
+        }
+        else if( smplfmt == static_cast<uint16_t>(eDSESmplFmt::pcm16) )
+        {
+            smpllen = rawlen / 2;
+            out_cvinfo.loopbeg_ = origloopbeg * 2;
+        }
+        else
+            return 0;
+
+        out_cvinfo.loopend_ = smpllen;
+        return smpllen;
+    }
+
+
+//========================================================================================
+//  DecodedSampleCache
+//========================================================================================
+    DecodedSampleCache::pcmptr_t DecodedSampleCache::Get( const SampleBank & bank, unsigned int smplid, DSESampleConvertionInfo & out_cvinfo )
+    {
+        const key_t key( &bank, smplid );
+        {
+            lock_guard<mutex> lock(m_mtx);
+            auto itfound = m_lookup.find(key);
+            if( itfound != m_lookup.end() )
+            {
+                m_lru.splice( m_lru.begin(), m_lru, itfound->second ); //Its now the most recently used
+                out_cvinfo = itfound->second->cvinfo;
+                return itfound->second->pcm;
+            }
+        }
+
+        const vector<uint8_t> * psmpl    = bank.sample(smplid);
+        const WavInfo         * psmplinf = bank.sampleInfo(smplid);
+        if( psmpl == nullptr || psmplinf == nullptr )
+            return nullptr;
+
+        //Convert without holding the lock, so several samples can be converted at the same time
+        auto pconverted = make_shared<vector<int16_t>>();
+        ConvertDSESample( static_cast<uint16_t>(psmplinf->smplfmt), psmplinf->loopbeg, *psmpl, out_cvinfo, *pconverted );
+
+        lock_guard<mutex> lock(m_mtx);
+        if( m_lookup.find(key) == m_lookup.end() ) //Another thread may have converted it in the meantime
+        {
+            m_lru.push_front( cacheentry{ key, pconverted, out_cvinfo } );
+            m_lookup.emplace( key, m_lru.begin() );
+            m_curbytes += pconverted->size() * sizeof(int16_t);
+            EvictOverBudget();
+        }
+        return pconverted;
+    }
+
+    void DecodedSampleCache::SetBudget( size_t budgetbytes )
+    {
+        lock_guard<mutex> lock(m_mtx);
+        m_budget = budgetbytes;
+        EvictOverBudget();
+    }
+
+    size_t DecodedSampleCache::GetBudget()const
+    {
+        lock_guard<mutex> lock(m_mtx);
+        return m_budget;
+    }
+
+    size_t DecodedSampleCache::GetCachedBytes()const
+    {
+        lock_guard<mutex> lock(m_mtx);
+        return m_curbytes;
+    }
+
+    void DecodedSampleCache::Clear()
+    {
+        lock_guard<mutex> lock(m_mtx);
+        m_lru.clear();
+        m_lookup.clear();
+        m_curbytes = 0;
+    }
+
+    void DecodedSampleCache::EvictOverBudget()
+    {
+        while( m_curbytes > m_budget && !m_lru.empty() )
+        {
+            const cacheentry & oldest = m_lru.back();
+            m_curbytes -= oldest.pcm->size() * sizeof(int16_t);
+            m_lookup.erase( oldest.key );
+            m_lru.pop_back();
+        }
+    }
 
     //eDSESmplFmt ConvertAndLoopDSESample( int16_t                                smplfmt, 
     //                                     size_t                                 origloopbeg,
@@ -573,9 +676,14 @@ namespace DSE
 //========================================================================================
 
     BatchAudioLoader::BatchAudioLoader( bool singleSF2, bool lfofxenabled )
-        : m_bSingleSF2(singleSF2),m_lfoeffects(lfofxenabled)
+        : m_bSingleSF2(singleSF2),m_lfoeffects(lfofxenabled), m_smplcache(make_shared<DecodedSampleCache>())
     {}
 
+    void BatchAudioLoader::SetSampleCacheBudget( size_t budgetbytes )
+    {
+        m_smplcache->SetBudget(budgetbytes);
+    }
+
 
     void BatchAudioLoader::LoadMasterBank( const std::string & mbank )
     {
@@ -1297,14 +1405,11 @@ namespace DSE
             stringstream sstrnames;
             sstrnames <<"Prg" <<presetidcnt << "->Smpl" <<cntsplit;
 
-            //Place the sample used by the current split in the soundfont
-            sf2::Sample sampl(  cursmpls[cntsplit].begin(), 
-                                cursmpls[cntsplit].end(), 
-                                sstrnames.str(),
-                                0,
-                                0,
-                                cursmplsinf[cntsplit].smplrate,
-                                cursplit.rootkey );
+            //Place the sample used by the current split in the soundfont. Its only processed when the soundfont is written.
+            sf2::Sample sampl( sf2::Sample::loadfun_t(cursmpls[cntsplit]), entry.splitsmpllens[cntsplit] );
+            sampl.SetName( sstrnames.str() );
+            sampl.SetSampleRate( cursmplsinf[cntsplit].smplrate );
+            sampl.SetOriginalKey( cursplit.rootkey );
 
             if( cursmplsinf[cntsplit].smplloop != 0 )
                 sampl.SetLoopBounds( cursmplsinf[cntsplit].loopbeg, cursmplsinf[cntsplit].loopbeg + cursmplsinf[cntsplit].looplen );
@@ -1421,7 +1526,7 @@ namespace DSE
         if (!IsMasterBankLoaded() && !m_bSingleSF2)
         {
             trackprgconvlist = move(BuildPresetConversionDB());
-            deque<ProcessedPresets> procpres; //We need to put all processed stuff in there, because the samples need to exist when the soundfont is written.
+            deque<ProcessedPresets> procpres; //The processed program info. The samples themselves are processed when the soundfont is written.
 
             //If no master bank is loaded, assume we use the swd in the pair to get our samples
             for (size_t cntpair = 0; cntpair < m_pairs.size(); ++cntpair )
@@ -1435,7 +1540,7 @@ namespace DSE
                     continue;
 
                 SoundFont sf(pairname);
-                procpres.push_back(std::move(ProcessDSESamples(*samples, *prgptr)));
+                procpres.push_back(std::move(ProcessDSESamples(*samples, *prgptr, m_smplcache)));
                 int cntpres = 0;
                 int cntinst = 0;
                 HandleBakedPrg(procpres.back(), &sf, pairname, cntpair, trackprgconvlist, cntinst, cntpres, prgptr->Keygrps());
@@ -1451,6 +1556,7 @@ namespace DSE
                              <<"================================================================================\n";
                     }
                     sf.Write(sf2path);
+                    m_smplcache->Clear(); //The next pair uses its own samples
                 }
                 catch( const overflow_error & e )
                 {
@@ -1475,7 +1581,7 @@ namespace DSE
 
             //Prepare
             shared_ptr<SampleBank>  samples = m_master.smplbank().lock();
-            deque<ProcessedPresets> procpres; //We need to put all processed stuff in there, because the samples need to exist when the soundfont is written.
+            deque<ProcessedPresets> procpres; //The processed program info. The samples themselves are processed when the soundfont is written.
 
             //Counters for the unique preset and instruments IDs
             int cntpres = 0;
@@ -1489,7 +1595,7 @@ namespace DSE
 
                 if (prgptr != nullptr)
                 {
-                    procpres.push_back(move(ProcessDSESamples(*samples, *prgptr)));
+                    procpres.push_back(move(ProcessDSESamples(*samples, *prgptr, m_smplcache)));
                     HandleBakedPrg(procpres.back(), &sf, pairname, cntpair, trackprgconvlist, cntinst, cntpres, prgptr->Keygrps());
                 }
 
@@ -1509,6 +1615,7 @@ namespace DSE
                 }
                 cout<<"\tWriting soundfont \"" <<destf <<"\"..";
                 sf.Write( destf );
+                m_smplcache->Clear();
                 cout<<"\n";
             }
             catch( const overflow_error & e )
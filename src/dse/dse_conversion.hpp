@@ -19,6 +19,9 @@ All wrongs reversed, no crappyrights :P
 #include <memory>
 #include <future>
 #include <map>
+#include <list>
+#include <mutex>
+#include <functional>
 #include <sstream>
 
 //namespace DSE{ struct SMDLPresetConversionInfo; };
@@ -53,6 +56,8 @@ namespace DSE
 //====================================================================================================
 // Class
 //====================================================================================================
+    class DecodedSampleCache;
+
 
 
 //
@@ -73,13 +78,17 @@ namespace DSE
             {}
 
             PresetEntry( PresetEntry && mv )
-                :prginf(std::move(mv.prginf)), splitsmplinf(std::move( mv.splitsmplinf )), splitsamples( std::move(mv.splitsamples) )
+                :prginf(std::move(mv.prginf)), splitsmplinf(std::move( mv.splitsmplinf )), splitsamples( std::move(mv.splitsamples) ), 
+                 splitsmpllens( std::move(mv.splitsmpllens) )
             {
             }
 
+            typedef std::function<std::vector<int16_t>()> smplloader_t;
+
             DSE::ProgramInfo                    prginf;       //
             std::vector< DSE::WavInfo >         splitsmplinf; //Modified sample info for a split's sample.
-            std::vector< std::vector<int16_t> > splitsamples; //Sample for each split of a preset.
+            std::vector< smplloader_t >         splitsamples; //Decodes and processes the sample for each split of a preset, when called.
+            std::vector< size_t >               splitsmpllens;//Length in sample points of the sample each entry in splitsamples returns.
         };
 
         typedef std::map< int16_t, PresetEntry >::iterator       iterator;
@@ -224,6 +233,13 @@ namespace DSE
         */
         void ExportSoundfontAndMIDIs( const std::string & destdir, int nbloops = 0, bool bbakesamples = true );
 
+        /*
+            SetSampleCacheBudget
+                Sets the maximum amount of bytes of converted pcm16 samples kept in memory while 
+                exporting samples with baked envelopes.
+        */
+        void SetSampleCacheBudget( size_t budgetbytes );
+
         /*
             ExportSoundfontAsGM
                 Attempts to export as a sounfont, following the General MIDI standard instrument patch list.
@@ -377,6 +393,7 @@ namespace DSE
         std::vector<smdswdpair_t> m_pairs;
 
         audiostats                m_stats;      //Used for research mainly. Stores statistics during processing of the DSE files
+        std::shared_ptr<DecodedSampleCache> m_smplcache; //Converted samples used when baking samples
 
         BatchAudioLoader( const BatchAudioLoader & )           = delete;
         BatchAudioLoader & operator=(const BatchAudioLoader& ) = delete;
@@ -405,6 +422,54 @@ namespace DSE
         size_t loopend_ = 0;
     };
 
+    /*
+        DecodedSampleCache
+            Keeps the most recently used samples converted to pcm16, up to a budget in bytes.
+            Samples are converted from their SampleBank when first asked for, and the least recently
+            used ones are dropped once the budget is exceeded. Samples that were handed out stay valid
+            after being dropped, since they're shared.
+            Can be used from several threads at once.
+    */
+    class DecodedSampleCache
+    {
+    public:
+        typedef std::shared_ptr<const std::vector<int16_t>> pcmptr_t;
+        static const size_t DefaultBudget = 64 * 1024 * 1024; //64 MB
+
+        DecodedSampleCache( size_t budgetbytes = DefaultBudget )
+            :m_budget(budgetbytes), m_curbytes(0)
+        {}
+
+        /*
+            Returns the sample converted to pcm16, and its loop points after conversion in out_cvinfo.
+            Returns nullptr if the sample slot has no data or info.
+        */
+        pcmptr_t Get( const SampleBank & bank, unsigned int smplid, DSESampleConvertionInfo & out_cvinfo );
+
+        void   SetBudget( size_t budgetbytes );
+        size_t GetBudget()const;
+        size_t GetCachedBytes()const;
+        void   Clear();
+
+    private:
+        typedef std::pair<const SampleBank*, unsigned int> key_t;
+        struct cacheentry
+        {
+            key_t                   key;
+            pcmptr_t                pcm;
+            DSESampleConvertionInfo cvinfo;
+        };
+
+        //Drop the least recently used samples until we're within budget. m_mtx must be locked!
+        void EvictOverBudget();
+
+        mutable std::mutex                                  m_mtx;
+        std::list<cacheentry>                               m_lru;      //Most recently used first
+        std::map<key_t, std::list<cacheentry>::iterator>    m_lookup;
+        size_t                                              m_budget;
+        size_t                                              m_curbytes; //Bytes of pcm16 data in m_lru
+    };
+
     /*
         ConvertDSESample
             Converts the given raw samples from a DSE compatible format to a signed pcm16 sample.
@@ -423,6 +488,22 @@ namespace DSE
                                   DSESampleConvertionInfo              & out_cvinfo,
                                   std::vector<int16_t>                 & out_smpl );
 
+    /*
+        GetConvertedDSESampleInfo
+            Works out what ConvertDSESample would output for a sample, without converting it.
+
+                * smplfmt    : The DSE sample type ID.
+                * origloopbeg: The begining pos of the loop, straight from the WavInfo struct !
+                * rawlen     : The length of the raw sample data in bytes.
+                * out_cvinfo : The conversion info struct ConvertDSESample would fill. Left untouched for unsupported formats.
+
+            Return the length of the resulting pcm16 sample, in samples.
+    */
+    size_t GetConvertedDSESampleInfo( int16_t                                smplfmt, 
+                                      size_t                                 origloopbeg,
+                                      size_t                                 rawlen,
+                                      DSESampleConvertionInfo              & out_cvinfo );
+
     /*
         ConvertAndLoopDSESample
             Converts the given raw samples from a DSE compatible format to a signed pcm16 sample.
@@ -452,15 +533,19 @@ namespace DSE
 
             * srcsmpl         : The samplebank containing all the raw samples used by the programbank.
             * prestoproc      : The programbank containing all the program whose samples needs to be processed.
+            * cache           : Where the converted samples are taken from.
             * desiredsmplrate : The desired sample rate in hertz to resample all samples to! (-1 means no resampling)
             * bakeenv         : Whether the envelopes should be baked into the samples.
 
-            Returns a ProcessedPresets object, contining the new program data, along with the new samples.
+            Returns a ProcessedPresets object, contining the new program data, along with a function that returns the
+            new sample for each split. The samples are only converted and processed when those functions are called, 
+            so srcsmpl must outlive the returned object.
     */
-    DSE::ProcessedPresets ProcessDSESamples( const DSE::SampleBank  & srcsmpl, 
-                                             const DSE::ProgramBank & prestoproc, 
-                                             int                      desiredsmplrate = -1, 
-                                             bool                     bakeenv         = true );
+    DSE::ProcessedPresets ProcessDSESamples( const DSE::SampleBank                     & srcsmpl, 
+                                             const DSE::ProgramBank                    & prestoproc, 
+                                             std::shared_ptr<DSE::DecodedSampleCache>    cache,
+                                             int                                         desiredsmplrate = -1, 
+                                             bool                                        bakeenv         = true );
 
     //-------------------
     //  Audio Loaders
@@ -5,6 +5,8 @@
 #include <utils/parse_utils.hpp>
 #include <utils/utility.hpp>
 #include <utils/library_wide.hpp>
+#include <utils/poco_wrapper.hpp>
+#include <utils/binary_cache.hpp>
 
 #include <iostream>
 #include <iomanip>
@@ -372,6 +374,187 @@ namespace DSE
 
     };
 
+//==============================================================================
+//  SMDLConvInfoDBBinCache
+//==============================================================================
+    /*
+        SMDLConvInfoDBBinCache
+            Saves and loads the content of a parsed conversion info xml file to/from 
+            a binary file next to it, to avoid parsing the xml file every time.
+    */
+    class SMDLConvInfoDBBinCache
+    {
+    public:
+        static const uint32_t MagicNumber   = 0x46495643; //"CVIF" as it appears in the file
+        static const uint32_t FormatVersion = 1;          //Increment whenever anything cached changes!
+
+        SMDLConvInfoDBBinCache( const std::string & cvinfxml )
+            :m_xmlpath(utils::MakeAbsolutePath(cvinfxml)), m_cachepath(m_xmlpath + CvInfoCacheFileExt), m_bneedsrefresh(false)
+        {}
+
+        /*
+            Returns false if there's no usable cache, or if it was built from an xml file at another path.
+            Never writes to the cache. If NeedsRefresh() is true afterwards, call Save() to update it.
+        */
+        bool Load( SMDLConvInfoDB & target )
+        {
+            utils::BinaryCacheReader rd;
+            if( !rd.Load( m_cachepath, MagicNumber, FormatVersion ) )
+                return false;
+            if( rd.SourceFiles().empty() || rd.SourceFiles().front() != m_xmlpath )
+                return false; //Built from an xml file somewhere else, like when the whole folder was copied
+            m_bneedsrefresh = rd.NeedsRefresh();
+
+            try
+            {
+                SMDLConvInfoDB loaded;
+                const uint32_t nbtracks = rd.ReadInt<uint32_t>();
+                for( uint32_t i = 0; i < nbtracks; ++i )
+                {
+                    string                   pairname = rd.ReadStr();
+                    SMDLPresetConversionInfo info;
+                    info.SetOutputName( rd.ReadStr() );
+
+                    const uint32_t nbprgs = rd.ReadInt<uint32_t>();
+                    for( uint32_t j = 0; j < nbprgs; ++j )
+                    {
+                        const dsepresetid_t dseid = rd.ReadInt<dsepresetid_t>();
+                        info.AddPresetConvInfo( dseid, ReadPresetConvData(rd) );
+                    }
+                    loaded.AddConversionInfo( pairname, move(info) );
+                }
+                if( !rd.AtEnd() )
+                    return false;
+                target = move(loaded);
+            }
+            catch( const std::exception & )
+            {
+                return false;
+            }
+            return true;
+        }
+
+        //Whether the last successful Load() found the xml file was touched, but not modified.
+        inline bool NeedsRefresh()const { return m_bneedsrefresh; }
+
+        /*
+            Failing to write the cache isn't an error, the xml will just be parsed again next time.
+        */
+        void Save( const SMDLConvInfoDB & src )
+        {
+            try
+            {
+                utils::BinaryCacheWriter wr;
+                wr.AddSourceFile(m_xmlpath);
+
+                wr.WriteInt<uint32_t>( static_cast<uint32_t>( distance(src.begin(), src.end()) ) );
+                for( const auto & track : src )
+                {
+                    wr.WriteStr( track.first );
+                    wr.WriteStr( track.second.GetOutputName() );
+                    wr.WriteInt<uint32_t>( static_cast<uint32_t>( distance(track.second.begin(), track.second.end()) ) );
+                    for( const auto & prg : track.second )
+                    {
+                        wr.WriteInt<dsepresetid_t>( prg.first );
+                        WritePresetConvData( wr, prg.second );
+                    }
+                }
+                wr.Save( m_cachepath, MagicNumber, FormatVersion );
+            }
+            catch( const std::exception & e )
+            {
+                if(utils::LibWide().isLogOn())
+                    clog << "<!>- SMDLConvInfoDBBinCache::Save(): Couldn't write the conversion info cache file \"" <<m_cachepath <<"\": " <<e.what() <<"\n";
+            }
+        }
+
+    private:
+        void WritePresetConvData( utils::BinaryCacheWriter & wr, const SMDLPresetConversionInfo::PresetConvData & pconv )
+        {
+            wr.WriteInt<presetid_t>( pconv.midipres );
+            wr.WriteInt<bankid_t>  ( pconv.midibank );
+
+            wr.WriteInt<uint32_t>( static_cast<uint32_t>(pconv.remapnotes.size()) );
+            for( const auto & rmap : pconv.remapnotes )
+            {
+                wr.WriteInt<midinote_t>( rmap.first );
+                wr.WriteInt<midinote_t>( rmap.second.destnote );
+                wr.WriteInt<presetid_t>( rmap.second.destpreset );
+                wr.WriteInt<bankid_t>  ( rmap.second.destbank );
+                wr.WriteInt<uint8_t>   ( rmap.second.idealchan );
+                wr.WriteInt<uint16_t>  ( rmap.second.origsmplid );
+            }
+
+            wr.WriteInt<uint32_t>( static_cast<uint32_t>(pconv.extrafx.size()) );
+            for( const auto & fx : pconv.extrafx )
+            {
+                wr.WriteInt<uint32_t>( static_cast<uint32_t>(fx.effty) );
+                wr.WriteInt<int32_t> ( fx.rate );
+                wr.WriteInt<int32_t> ( fx.delay );
+                wr.WriteInt<int32_t> ( fx.depth );
+                wr.WriteInt<int32_t> ( fx.fadeout );
+            }
+
+            wr.WriteInt<uint8_t> ( pconv.maxpoly );
+            wr.WriteInt<uint8_t> ( pconv.priority );
+            wr.WriteInt<uint32_t>( pconv.maxkeydowndur );
+            wr.WriteInt<int8_t>  ( pconv.transpose );
+            wr.WriteInt<uint8_t> ( pconv.idealchan );
+
+            wr.WriteInt<uint32_t>( static_cast<uint32_t>(pconv.origsmplids.size()) );
+            for( const auto & smplid : pconv.origsmplids )
+                wr.WriteInt<uint16_t>( smplid );
+        }
+
+        SMDLPresetConversionInfo::PresetConvData ReadPresetConvData( utils::BinaryCacheReader & rd )
+        {
+            SMDLPresetConversionInfo::PresetConvData pconv;
+            pconv.midipres = rd.ReadInt<presetid_t>();
+            pconv.midibank = rd.ReadInt<bankid_t>();
+
+            const uint32_t nbremaps = rd.ReadInt<uint32_t>();
+            for( uint32_t i = 0; i < nbremaps; ++i )
+            {
+                const midinote_t                        inkey = rd.ReadInt<midinote_t>();
+                SMDLPresetConversionInfo::NoteRemapData rmap;
+                rmap.destnote   = rd.ReadInt<midinote_t>();
+                rmap.destpreset = rd.ReadInt<presetid_t>();
+                rmap.destbank   = rd.ReadInt<bankid_t>();
+                rmap.idealchan  = rd.ReadInt<uint8_t>();
+                rmap.origsmplid = rd.ReadInt<uint16_t>();
+                pconv.remapnotes.insert( make_pair( inkey, rmap ) );
+            }
+
+            const uint32_t nbfx = rd.ReadInt<uint32_t>();
+            for( uint32_t i = 0; i < nbfx; ++i )
+            {
+                SMDLPresetConversionInfo::ExtraEffects fx;
+                fx.effty   = static_cast<SMDLPresetConversionInfo::eEffectTy>( rd.ReadInt<uint32_t>() );
+                fx.rate    = rd.ReadInt<int32_t>();
+                fx.delay   = rd.ReadInt<int32_t>();
+                fx.depth   = rd.ReadInt<int32_t>();
+                fx.fadeout = rd.ReadInt<int32_t>();
+                pconv.extrafx.push_back(fx);
+            }
+
+            pconv.maxpoly       = rd.ReadInt<uint8_t>();
+            pconv.priority      = rd.ReadInt<uint8_t>();
+            pconv.maxkeydowndur = rd.ReadInt<uint32_t>();
+            pconv.transpose     = rd.ReadInt<int8_t>();
+            pconv.idealchan     = rd.ReadInt<uint8_t>();
+
+            const uint32_t nbsmplids = rd.ReadInt<uint32_t>();
+            for( uint32_t i = 0; i < nbsmplids; ++i )
+                pconv.origsmplids.push_back( rd.ReadInt<uint16_t>() );
+            return move(pconv);
+        }
+
+    private:
+        string m_xmlpath;
+        string m_cachepath;
+        bool   m_bneedsrefresh;
+    };
+
 //==============================================================================
 //  SMDLConvInfoDB
 //==============================================================================
@@ -391,10 +574,22 @@ namespace DSE
     /*
         Parse
             Triggers parsing of the specified xml file!
+            Uses the binary cache of the file instead when its up to date.
     */
     void SMDLConvInfoDB::Parse( const std::string & cvinfxml )
     {
-        SMDLConvInfoDBXMLParser(*this).Parse(cvinfxml);
+        SMDLConvInfoDBBinCache cache(cvinfxml);
+        SMDLConvInfoDB         parsed;
+        if( !cache.Load(parsed) )
+        {
+            SMDLConvInfoDBXMLParser(parsed).Parse(cvinfxml);
+            cache.Save(parsed);
+        }
+        else if( cache.NeedsRefresh() )
+            cache.Save(parsed);
+
+        for( auto & entry : parsed )
+            AddConversionInfo( entry.first, move(entry.second) );
     }
 
     /*
@@ -16,6 +16,8 @@ Description: Conversion info data used while converting SMDL files into MIDIs.
 
 namespace DSE
 {
+    //Appended to the name of a conversion info file to make the name of its binary cache
+    const std::string CvInfoCacheFileExt = ".cache";
 
 //================================================================================
 //  SMDLPresetConversionInfo
@@ -183,6 +185,8 @@ namespace DSE
         /*
             Parse
                 Triggers parsing of the specified xml file!
+                The parsed data is cached to a binary file next to the xml file ( CvInfoCacheFileExt is appended to its name ),
+                and the cache is used instead of the xml file, as long as the xml file hasn't changed.
         */
         void Parse( const std::string & cvinfxml );
 
@@ -36,12 +36,14 @@ namespace DSE
     class SampleProcessor
     {
     public:
-        SampleProcessor( const SampleBank &srcsmpl, 
-                         int               desiredsmplrate  = -1, 
-                         bool              bakeenv          = true, 
-                         bool              applyfilters     = true, 
-                         bool              applyfx          = true )
+        SampleProcessor( const SampleBank                    &srcsmpl, 
+                         std::shared_ptr<DecodedSampleCache>  cache,
+                         int                                  desiredsmplrate  = -1, 
+                         bool                                 bakeenv          = true, 
+                         bool                                 applyfilters     = true, 
+                         bool                                 applyfx          = true )
             :m_srcsmpl(srcsmpl), 
+             m_cache(cache),
              m_desiredsmplrate(desiredsmplrate), 
              m_bshouldbakeenv(bakeenv), 
              m_bApplyFilters(applyfilters),
@@ -75,6 +77,60 @@ namespace DSE
 
 
     private:
+
+        /*
+            SplitRenderer
+                Everything needed to convert and process the sample of a split, once its needed.
+                The lengths and loop points are all worked out beforehand by ProcessASplit2, 
+                so the sample info can be used before the sample is rendered.
+        */
+        struct SplitRenderer
+        {
+            std::shared_ptr<DecodedSampleCache> cache;
+            const SampleBank                  * psrcsmpl;
+            unsigned int                        smplid;
+            bool                                bapplyenv;      //Whether to render the envelope
+            size_t                              lengthento;     //If not 0, loop the sample until its this long
+            int                                 nbextraloops;   //Nb of times to append the loop to the end of the sample
+            bool                                bloopatend;     //Whether to append one more loop, so the loop plays after the envelope
+            DSE::DSEEnvelope                    env;
+            int                                 envsmplrate;
+            double                              volumeFactor;
+            int                                 desiredsmplrate;
+            bool                                bapplyfilters;
+            bool                                bapplyfx;
+            int                                 finalsmplrate;
+            std::vector<DSE::LFOTblEntry>       lfos;
+
+            std::vector<int16_t> operator()()const
+            {
+                DSESampleConvertionInfo postconvloop; //The loop points after conversion
+                auto                    pconverted = cache->Get( *psrcsmpl, smplid, postconvloop );
+                if( pconverted == nullptr )
+                    return std::vector<int16_t>();
+                std::vector<int16_t> smpl( *pconverted );
+                pconverted.reset(); //Let the cache drop it if it needs to
+
+                if( lengthento != 0 )
+                    Lenghten( smpl, lengthento, postconvloop );
+                if( nbextraloops != 0 )
+                    LenghtenByNbLoops( smpl, nbextraloops, postconvloop );
+                if( bloopatend )
+                    LenghtenByNbLoops( smpl, 1, postconvloop );
+                if( bapplyenv )
+                    ApplyEnveloppe( smpl, env, envsmplrate, volumeFactor );
+
+                // ---- Extra Processing ----
+                if( desiredsmplrate != -1 && desiredsmplrate != envsmplrate )
+                    Resample( smpl, envsmplrate, desiredsmplrate, postconvloop );
+                if( bapplyfilters )
+                    ApplyFilters( smpl, finalsmplrate );
+                if( bapplyfx )
+                    ApplyFx( smpl, finalsmplrate, lfos );
+                return std::move(smpl);
+            }
+        };
+
         void ProcessAPrgm( const DSE::ProgramInfo & prgm, ProcessedPresets & processed )
         {
             ProcessedPresets::PresetEntry entry;
@@ -111,31 +167,52 @@ namespace DSE
             return envtotaldur;
         }
 
+        //Length added to the sample by LenghtenByNbLoops
+        static inline size_t LenghtenByNbLoopsLen( size_t smpllen, int nbloops, const DSESampleConvertionInfo & loopinf )
+        {
+            return (smpllen > loopinf.loopbeg_)? (nbloops * (smpllen - loopinf.loopbeg_)) : 0;
+        }
+
         /*
+            Works out the new sample info and length for the split's sample, and adds a SplitRenderer to the entry
+            to do the actual processing later on.
         */
         void ProcessASplit2(ProcessedPresets::PresetEntry           & entry, 
                             const DSE::SplitEntry                   & split, 
                             const std::vector<DSE::LFOTblEntry>     & lfos,
-                            const std::vector<uint8_t>              * psmpl, 
+                            const std::vector<uint8_t>              * psmpl,
                             const DSE::WavInfo                      * psmplinf,
                             const DSE::ProgramInfo                  & prgminf )
         {
-            const size_t    curindex               = entry.splitsamples.size(); //!#FIXME: Past me, what the fuck?
+            const size_t    curindex               = entry.splitsmplinf.size();
             const bool      IsSampleLooped         = psmplinf->smplloop != 0;
             const bool      ShouldUnloop           = ( split.env.sustain == 0 ) || ( split.env.decay2 != 0x7F );
-            const bool      ShouldRenderEnvAndLoop = !ShouldUnloop && IsSampleLooped;
             const uint32_t  envtotaldur            = CalcTotalEnveloppeDuration(split);
             const uint32_t  envtotaldursmpl        = MsecToNbSamples( psmplinf->smplrate, envtotaldur );
 
-            // --- Convert Sample ----
+            // --- Converted Sample Info ----
+            //The sample is only converted when the SplitRenderer runs, so work out its length and loop points from the sample info.
             DSESampleConvertionInfo postconvloop; //The loop points after conversion
-            
-            //entry.splitsamples.push_back( move( ConvertAndLoopSample( *psmpl, static_cast<uint16_t>(psmplinf->smplfmt), psmplinf->loopbeg, psmplinf->looplen, 1, postconvloop ) ) );
-            entry.splitsamples.push_back( move( ConvertSample( *psmpl, static_cast<uint16_t>(psmplinf->smplfmt), psmplinf->loopbeg, postconvloop ) ) );
-            
-            entry.splitsmplinf.push_back( *psmplinf ); //Copy sample info #FIXME: maybe get a custom way to store the relevant data for loop points and sample rate instead ?
-            const size_t    SampleLenPreLengthen = entry.splitsamples[curindex].size();
+            const size_t            SampleLenPreLengthen = GetConvertedDSESampleInfo( static_cast<uint16_t>(psmplinf->smplfmt), psmplinf->loopbeg, psmpl->size(), postconvloop );
+            size_t                  smpllen              = SampleLenPreLengthen;
+
+            SplitRenderer render;
+            render.cache           = m_cache;
+            render.psrcsmpl        = &m_srcsmpl;
+            render.smplid          = split.smplid;
+            render.bapplyenv       = false;
+            render.lengthento      = 0;
+            render.nbextraloops    = 0;
+            render.bloopatend      = false;
+            render.env             = split.env;
+            render.envsmplrate     = psmplinf->smplrate;
+            render.volumeFactor    = 1.0;
+            render.desiredsmplrate = (ShouldResample())? m_desiredsmplrate : -1;
+            render.bapplyfilters   = ShouldApplyFilters();
+            render.bapplyfx        = ShouldApplyFx();
+            render.lfos            = lfos;
 
+            entry.splitsmplinf.push_back( *psmplinf ); //Copy sample info #FIXME: maybe get a custom way to store the relevant data for loop points and sample rate instead ?
             entry.splitsmplinf[curindex].smplfmt = eDSESmplFmt::pcm16;
 
             //Update Loop info
@@ -145,7 +222,7 @@ namespace DSE
             // ---- Handle Enveloppe ----
             if( split.envon != 0 )
             {
-                double volumeFactor = ( static_cast<int>(prgminf.prgvol * 100 / 127) / 100.0) * ( static_cast<int>(split.smplvol * 100 / 127) / 100.0);
+                render.volumeFactor = ( static_cast<int>(prgminf.prgvol * 100 / 127) / 100.0) * ( static_cast<int>(split.smplvol * 100 / 127) / 100.0);
 
                 if( IsSampleLooped )
                 {
@@ -154,77 +231,43 @@ namespace DSE
                     if( ShouldUnloop )
                     {
                         //Loop the sample a few times, so its as long as the envelope
-                        if( envtotaldursmpl > entry.splitsamples[curindex].size() )
-                            Lenghten( entry.splitsamples[curindex], envtotaldursmpl, postconvloop );
-
-            ////!###TEST####
-            //const bool bispcm16                   = (psmplinf->smplfmt == eDSESmplFmt::pcm16);
-            //uint32_t   presmplrate                = psmplinf->smplrate;
-            //uint32_t   Newsmplrate                = std::lround((static_cast<double>(entry.splitsamples[curindex].size()) / static_cast<double>(SampleLenPreLengthen)) / 100.0) * presmplrate;
-            //if( bispcm16 )
-            //    entry.splitsmplinf[curindex].smplrate = Newsmplrate;
-            ////!###TEST####
+                        if( envtotaldursmpl > smpllen )
+                        {
+                            render.lengthento = envtotaldursmpl;
+                            smpllen           = envtotaldursmpl;
+                        }
 
                         //We render the envelope and disable looping
-                        ApplyEnveloppe( entry.splitsamples[curindex], split.env, psmplinf->smplrate, volumeFactor );
+                        render.bapplyenv = true;
                         entry.splitsmplinf[curindex].smplloop = 0;
                     }
                     else
                     {
                         //Loop the sample a few times, so its as long as the envelope
-                        if( envtotaldursmpl > entry.splitsamples[curindex].size() )
+                        if( envtotaldursmpl > smpllen )
                         {
                             int          nbextraloops = 0;
                             const size_t durtoloop    = envtotaldursmpl - SampleLenPreLengthen; //entry.splitsmplinf[curindex].loopbeg;
-                            //const size_t resultinglength  = envtotaldursmpl + ( durofunloopedenv % entry.splitsmplinf[curindex].looplen );
                             
                             if( ( durtoloop % entry.splitsmplinf[curindex].looplen ) != 0 )
                                 nbextraloops = (durtoloop / entry.splitsmplinf[curindex].looplen) + 1;
                             else
                                 nbextraloops = (durtoloop / entry.splitsmplinf[curindex].looplen);
 
-                            LenghtenByNbLoops( entry.splitsamples[curindex], nbextraloops, postconvloop );
+                            render.nbextraloops = nbextraloops;
+                            smpllen += LenghtenByNbLoopsLen( smpllen, nbextraloops, postconvloop );
 
                             //Make sure the sample ends only after fully completing its last loop, this will keep 
                             // the sample from clicking/abruptly cutting to the loop.
                         }
 
                         //Save the length of the sample after making it longer, since it differ from "envtotaldursmpl"
-                        const size_t actualnewloopbeg = entry.splitsamples[curindex].size();
+                        const size_t actualnewloopbeg = smpllen;
 
                         //We copy one loop to the end, render the envelope, Move the loop to the end past the decay phase, and keep looping on.
-                        LenghtenByNbLoops( entry.splitsamples[curindex], 1, postconvloop );
-                        ApplyEnveloppe( entry.splitsamples[curindex], split.env, psmplinf->smplrate, volumeFactor );
-
-
-                        ////!###Test release###
-                        //size_t    releasebeg     = entry.splitsamples[curindex].size();
-                        //size_t    nbreleaselp    = 0;
-                        //const int releasenbsmpls = MsecToNbSamples( psmplinf->smplrate,
-                        //                                            DSEEnveloppeDurationToMSec( static_cast<int8_t>(split.env.release), 
-                        //                                                                        static_cast<int8_t>(split.env.envmulti)));
-                        //if( ( releasenbsmpls % entry.splitsmplinf[curindex].looplen ) != 0 )
-                        //    nbreleaselp = (releasenbsmpls / entry.splitsmplinf[curindex].looplen) + 1;
-                        //else
-                        //    nbreleaselp = (releasenbsmpls / entry.splitsmplinf[curindex].looplen);
-                        //
-                        //LenghtenByNbLoops( entry.splitsamples[curindex], nbreleaselp, postconvloop );
-
-                        //const double sustainlvl   = ( ( (static_cast<double>(split.env.sustain) * 100.0 ) / 128.0 ) / 100.0) * split.env.envmulti;
-                        //if( split.env.decay2 == 0x7F )
-                        //    LerpVol( releasebeg, releasenbsmpls, sustainlvl, 0.0, entry.splitsamples[curindex] ); 
-                        ////!###Test release###
-
-
-            ////!###TEST####
-            //const bool bispcm16                   = (psmplinf->smplfmt == eDSESmplFmt::pcm16);
-            //uint32_t   presmplrate                = psmplinf->smplrate;
-            //double     oldratio                   = static_cast<double>(SampleLenPreLengthen)                / static_cast<double>(presmplrate);
-            //double     newratio                   = static_cast<double>(entry.splitsamples[curindex].size()) / static_cast<double>(presmplrate);
-            //uint32_t   Newsmplrate                = std::lround(( static_cast<double>(entry.splitsamples[curindex].size())) *  fabs( oldratio ) );
-            //if( bispcm16 )
-            //    entry.splitsmplinf[curindex].smplrate = Newsmplrate;
-            ////!###TEST####
+                        render.bloopatend = true;
+                        render.bapplyenv  = true;
+                        smpllen += LenghtenByNbLoopsLen( smpllen, 1, postconvloop );
 
                         //Move the loop to the end
                         entry.splitsmplinf[curindex].loopbeg = (actualnewloopbeg > SampleLenPreLengthen)? actualnewloopbeg : SampleLenPreLengthen;
@@ -234,7 +277,7 @@ namespace DSE
                 else
                 {
                     //Render envelope only
-                    ApplyEnveloppe( entry.splitsamples[curindex], split.env, psmplinf->smplrate, volumeFactor );
+                    render.bapplyenv = true;
                 }
 
                 //Set envelope paramters to disabled, except the release, so we don't end up applying the SF2 envelope over the sample!
@@ -251,51 +294,10 @@ namespace DSE
             }
 
             // ---- Extra Processing ----
-            if( ShouldResample() && m_desiredsmplrate != psmplinf->smplrate )
-            {
-                const size_t smplszbefresample = entry.splitsamples[curindex].size();
-                DSESampleConvertionInfo postresampleloop;
-                postresampleloop.loopbeg_ = entry.splitsmplinf[curindex].loopbeg;
-                postresampleloop.loopend_ = (entry.splitsmplinf[curindex].loopbeg + entry.splitsmplinf[curindex].looplen);
+            render.finalsmplrate = entry.splitsmplinf[curindex].smplrate;
 
-                if( Resample( entry.splitsamples[curindex], psmplinf->smplrate, m_desiredsmplrate, postresampleloop ) )
-                {
-                    //Update loop points
-                    entry.splitsmplinf[curindex].loopbeg = postresampleloop.loopbeg_;
-
-                    if( postresampleloop.loopend_ > entry.splitsamples[curindex].size() )
-                        postresampleloop.loopend_ = entry.splitsamples[curindex].size();
-
-                    entry.splitsmplinf[curindex].looplen = (postresampleloop.loopend_ - postresampleloop.loopbeg_);
-
-                    const size_t szafterfix = ( entry.splitsmplinf[curindex].looplen + entry.splitsmplinf[curindex].loopbeg );
-
-#ifdef DEBUG
-                    assert( ( szafterfix < entry.splitsamples[curindex].size() ) );
-#endif
-
-                    //Update sample rate info
-                    entry.splitsmplinf[curindex].smplrate = m_desiredsmplrate;
-                }
-            }
-            if( ShouldApplyFilters() )
-            {
-                ApplyFilters( entry.splitsamples[curindex], entry.splitsmplinf[curindex].smplrate );
-            }
-            if( ShouldApplyFx() )
-            {
-                ApplyFx( entry.splitsamples[curindex], entry.splitsmplinf[curindex].smplrate, lfos );
-            }
-        }
-
-        /*
-        */
-        vector<int16_t> ConvertSample( const vector<uint8_t> & srcsmpl, int16_t smplty, size_t origloopbeg, DSESampleConvertionInfo & newloop )
-        {
-            vector<int16_t> result;
-            //Depending on sample format, convert to pcm16 !
-            ConvertDSESample( smplty, origloopbeg, srcsmpl, newloop, result );
-            return std::move(result);
+            entry.splitsamples.push_back( std::move(render) );
+            entry.splitsmpllens.push_back( smpllen );
         }
 
         /*
@@ -313,7 +315,7 @@ namespace DSE
         /*
             Make the sample the length of the entire envelope.
         */
-        void Lenghten( vector<int16_t> & smpl, size_t destlen, const DSESampleConvertionInfo & loopinf )
+        static void Lenghten( vector<int16_t> & smpl, size_t destlen, const DSESampleConvertionInfo & loopinf )
         {
             //Pre-alloc
             smpl.reserve( destlen );
@@ -338,7 +340,7 @@ namespace DSE
         /*
             Add the loop to the end of the sample the specified amount of times!
         */
-        void LenghtenByNbLoops( vector<int16_t> & smpl, int nbloops, const DSESampleConvertionInfo & loopinf )
+        static void LenghtenByNbLoops( vector<int16_t> & smpl, int nbloops, const DSESampleConvertionInfo & loopinf )
         {
             const size_t looplen     = (loopinf.loopend_ - loopinf.loopbeg_);
             const size_t targetlen   = loopinf.loopbeg_ + ( (nbloops+1) * looplen );
@@ -375,7 +377,7 @@ namespace DSE
         /*
             Apply the envelope phases over time on the sample
         */
-        void ApplyEnveloppe( vector<int16_t> & smpl, const DSE::DSEEnvelope & env, int smplrate, double volmul )
+        static void ApplyEnveloppe( vector<int16_t> & smpl, const DSE::DSEEnvelope & env, int smplrate, double volmul )
         {
             const double MaxVol        = volmul * 1.0;
             double       lastvolumelvl = MaxVol;
@@ -421,7 +423,7 @@ namespace DSE
             //Release is left to the sampler to process
         }
 
-        void LerpVol( size_t begsmpl, size_t endsmpl, double initvol, double destvol, vector<int16_t> & smpl )
+        static void LerpVol( size_t begsmpl, size_t endsmpl, double initvol, double destvol, vector<int16_t> & smpl )
         {
             if( initvol != destvol )
             {
@@ -465,7 +467,7 @@ namespace DSE
         /*
             Resample the sample.
         */
-        bool Resample( vector<int16_t> & smpl, int origsamplrte, int destsamplrte, DSESampleConvertionInfo & inout_newloop )
+        static bool Resample( vector<int16_t> & smpl, int origsamplrte, int destsamplrte, DSESampleConvertionInfo & inout_newloop )
         { return false; }
     //        r8b::CDSPResampler16 resampler( origsamplrte, destsamplrte, smpl.size() );
     //        vector<double>       tempbuf;
@@ -542,14 +544,14 @@ namespace DSE
 
         /*
         */
-        void ApplyFilters( vector<int16_t> & smpl, int smplrate )
+        static void ApplyFilters( vector<int16_t> & smpl, int smplrate )
         {
             //#TODO: Add smoothing filters
         }
 
         /*
         */
-        void ApplyFx( vector<int16_t> & smpl, int smplrate, const std::vector<DSE::LFOTblEntry> & lfos )
+        static void ApplyFx( vector<int16_t> & smpl, int smplrate, const std::vector<DSE::LFOTblEntry> & lfos )
         {
             //#TODO: Add LFO processing
         }
@@ -573,11 +575,12 @@ namespace DSE
         }
 
     private:
-        const SampleBank & m_srcsmpl;
-        int                m_desiredsmplrate;
-        bool               m_bshouldbakeenv;
-        bool               m_bApplyFilters;
-        bool               m_bApplyFx;
+        const SampleBank                    & m_srcsmpl;
+        std::shared_ptr<DecodedSampleCache>   m_cache;
+        int                                   m_desiredsmplrate;
+        bool                                  m_bshouldbakeenv;
+        bool                                  m_bApplyFilters;
+        bool                                  m_bApplyFx;
     };
 
 
@@ -586,9 +589,9 @@ namespace DSE
 //  Functions
 //=========================================================================================
 
-    DSE::ProcessedPresets ProcessDSESamples( const DSE::SampleBank &srcsmpl, const DSE::ProgramBank & prestoproc, int desiredsmplrate, bool bakeenv )
+    DSE::ProcessedPresets ProcessDSESamples( const DSE::SampleBank &srcsmpl, const DSE::ProgramBank & prestoproc, std::shared_ptr<DSE::DecodedSampleCache> cache, int desiredsmplrate, bool bakeenv )
     {
-        return move( SampleProcessor( srcsmpl, desiredsmplrate, bakeenv ).Process(prestoproc) );
+        return move( SampleProcessor( srcsmpl, cache, desiredsmplrate, bakeenv ).Process(prestoproc) );
     }
 
 };
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include <utils/handymath.hpp>
 #include <png++/png.hpp>
 #include <iostream>
+#include <fstream>
+#include <algorithm>
 using namespace std;
 
 namespace utils{ namespace io
@@ -134,6 +136,92 @@ namespace utils{ namespace io
         }
     }
 
+//
+// Write a tiled indexed image straight to a PNG file
+//
+    /*
+        Writes the [begpixX, endpixX) x [begpixY, endpixY) area of the tiled image to an indexed png, 
+        without making a png::image first.
+        Each row of tiles is untiled into a buffer holding as many scanlines as a tile is high, already packed at the 
+        png's bit depth. Then the scanlines are handed to libpng one at a time. Tiles are read whole, in the order 
+        they're stored, instead of looking up the tile of every single pixel.
+        Throws on error.
+    */
+    template<class _pngimagepixel, class _TImg>
+        void WriteTiledIndexedPNG( const _TImg       & in_indexed,
+                                   const std::string & filepath,
+                                   unsigned int        begpixX,
+                                   unsigned int        begpixY,
+                                   unsigned int        endpixX,
+                                   unsigned int        endpixY )
+    {
+        typedef typename _TImg::tile_t tile_t;
+        const unsigned int BitDepth   = static_cast<unsigned int>( png::pixel_traits<_pngimagepixel>::get_bit_depth() );
+        const unsigned int PixPerByte = 8 / BitDepth;
+        const uint8_t      PixMask    = static_cast<uint8_t>( (1u << BitDepth) - 1u );
+
+        const unsigned int outwidth  = endpixX - begpixX;
+        const unsigned int outheight = endpixY - begpixY;
+        const size_t       rowbytes  = ( (outwidth * BitDepth) + 7 ) / 8;
+
+        std::ofstream outf( filepath, std::ios::out | std::ios::binary );
+        if( !outf.is_open() )
+            throw std::runtime_error( "Couldn't open file for writing!" );
+
+        png::writer<std::ofstream> wr(outf);
+        png::image_info            info = png::make_image_info<_pngimagepixel>();
+        info.set_width  ( outwidth );
+        info.set_height ( outheight );
+        info.set_palette( PalToPngPal(in_indexed.getPalette()) );
+        wr.set_image_info( info );
+        wr.write_info();
+
+        std::vector<png::byte> scanlines( rowbytes * tile_t::HEIGHT );
+        const unsigned int     begtilecol = begpixX / tile_t::WIDTH;
+        const unsigned int     endtilecol = (endpixX + tile_t::WIDTH  - 1) / tile_t::WIDTH;
+        const unsigned int     begtilerow = begpixY / tile_t::HEIGHT;
+        const unsigned int     endtilerow = (endpixY + tile_t::HEIGHT - 1) / tile_t::HEIGHT;
+
+        for( unsigned int tilerow = begtilerow; tilerow < endtilerow; ++tilerow )
+        {
+            //Lines of this row of tiles that are within the area to write
+            const unsigned int tilepixY = tilerow * tile_t::HEIGHT;
+            const unsigned int begline  = std::max( begpixY, tilepixY ) - tilepixY;
+            const unsigned int endline  = std::min( endpixY, tilepixY + tile_t::HEIGHT ) - tilepixY;
+
+            if( BitDepth < 8 )
+                std::fill( scanlines.begin(), scanlines.end(), 0 ); //Packed pixels are OR-ed in
+
+            for( unsigned int tilecol = begtilecol; tilecol < endtilecol; ++tilecol )
+            {
+                const tile_t     & curtile  = in_indexed.getTile( tilecol, tilerow );
+                const unsigned int tilepixX = tilecol * tile_t::WIDTH;
+                const unsigned int begcol   = std::max( begpixX, tilepixX ) - tilepixX;
+                const unsigned int endcol   = std::min( endpixX, tilepixX + tile_t::WIDTH ) - tilepixX;
+
+                for( unsigned int line = begline; line < endline; ++line )
+                {
+                    png::byte    * pline = scanlines.data() + (line * rowbytes);
+                    unsigned int   outx  = (tilepixX + begcol) - begpixX;
+
+                    for( unsigned int col = begcol; col < endcol; ++col, ++outx )
+                    {
+                        const uint8_t pixval = static_cast<uint8_t>( curtile.getPixel( col, line ).getWholePixelData() ) & PixMask;
+                        if( PixPerByte == 1 )
+                            pline[outx] = pixval;
+                        else //Leftmost pixel goes in the highest bits
+                            pline[outx / PixPerByte] |= pixval << ( BitDepth * ( (PixPerByte - 1) - (outx % PixPerByte) ) );
+                    }
+                }
+            }
+
+            for( unsigned int line = begline; line < endline; ++line )
+                wr.write_row( scanlines.data() + (line * rowbytes) );
+        }
+
+        wr.write_end_info();
+    }
+
 //==============================================================================================
 //  Import/Export from/to 4bpp
 //==============================================================================================
@@ -179,35 +267,9 @@ namespace utils{ namespace io
     bool ExportTo4bppPNG( const gimg::tiled_image_i4bpp  & in_indexed,
                           const std::string              & filepath )
     {
-        png::image<png::index_pixel_4> output;
-        //png::palette                   palette(in_indexed.getNbColors());
-
-        ////copy palette
-        //for( unsigned int i = 0; i < palette.size(); ++i )
-        //{
-        //    palette[i].red   = in_indexed.getPalette()[i].red;
-        //    palette[i].green = in_indexed.getPalette()[i].green;
-        //    palette[i].blue  = in_indexed.getPalette()[i].blue;
-        //}
-        output.set_palette( PalToPngPal(in_indexed.getPalette()) );
-
-        //Copy image
-        output.resize( in_indexed.getNbPixelWidth(), in_indexed.getNbPixelHeight() );
-
-        for( unsigned int i = 0; i < output.get_width(); ++i )
-        {
-            for( unsigned int j = 0; j < output.get_height(); ++j )
-            {
-                auto &  refpixel = in_indexed.getPixel( i, j );
-                uint8_t temp     = static_cast<uint8_t>( refpixel.getWholePixelData() );
-                //output[j][i] = png::index_pixel_4( temp );
-                output.set_pixel( i,j, temp ); //If only one component returns the entire pixel data
-            }
-        }
-
         try
         {
-            output.write( filepath );
+            WriteTiledIndexedPNG<png::index_pixel_4>( in_indexed, filepath, 0, 0, in_indexed.getNbPixelWidth(), in_indexed.getNbPixelHeight() );
         }
         catch( const std::exception & e )
         {
@@ -251,21 +313,9 @@ namespace utils{ namespace io
     bool ExportTo8bppPNG( const gimg::tiled_image_i8bpp & in_indexed,
                           const std::string             & filepath )
     {
-        png::image<png::index_pixel> output;
-        output.set_palette( PalToPngPal(in_indexed.getPalette()) );
-
-        //Copy image
-        output.resize( in_indexed.getNbPixelWidth(), in_indexed.getNbPixelHeight() );
-
-        for( unsigned int i = 0; i < output.get_width(); ++i )
-        {
-            for( unsigned int j = 0; j < output.get_height(); ++j )
-                output.set_pixel( i,j, static_cast<uint8_t>( in_indexed.getPixel( i, j ).getWholePixelData() ) ); //If only one component returns the entire pixel data
-        }
-
         try
         {
-            output.write( filepath );
+            WriteTiledIndexedPNG<png::index_pixel>( in_indexed, filepath, 0, 0, in_indexed.getNbPixelWidth(), in_indexed.getNbPixelHeight() );
         }
         catch( const std::exception & e )
         {
@@ -286,31 +336,12 @@ namespace utils{ namespace io
                           unsigned int                    endpixX,
                           unsigned int                    endpixY )
     {
-        png::image<png::index_pixel> output;
-        output.set_palette( PalToPngPal(in_indexed.getPalette()) );
         const size_t srcMaxX = in_indexed.getNbPixelWidth()  - endpixX;
         const size_t srcMaxY = in_indexed.getNbPixelHeight() - endpixY;
 
-        //Copy image
-        output.resize( (srcMaxX - begpixX), (srcMaxY - begpixY) );
-
-        for( unsigned int i = 0; i < output.get_width(); ++i )
-        {
-            for( unsigned int j = 0; j < output.get_height(); ++j )
-            {
-                size_t srcX = i + begpixX;
-                size_t srcY = j + begpixY;
-
-                if( srcX < srcMaxX && srcY < srcMaxY )
-                    output.set_pixel( i,j, static_cast<uint8_t>( in_indexed.getPixel( srcX, srcY ).getWholePixelData() ) );
-                else 
-                    break;
-            }
-        }
-
         try
         {
-            output.write( filepath );
+            WriteTiledIndexedPNG<png::index_pixel>( in_indexed, filepath, begpixX, begpixY, srcMaxX, srcMaxY );
         }
         catch( const std::exception & e )
         {
@@ -4,7 +4,7 @@
 //#include <ppmdu/pmd2/pmd2_sprites.hpp>
 #include <ppmdu/pmd2/pmd2_filetypes.hpp>
 #include <ppmdu/containers/sprite_data.hpp>
-#include <utils/multiple_task_handler.hpp>
+#include <utils/parallel_tasks.hpp>
 #include <utils/library_wide.hpp>
 #include <ppmdu/fmts/wan.hpp>
 #include <ppmdu/fmts/pack_file.hpp>
@@ -61,7 +61,6 @@ namespace gfx_util
     //static const int                  HPBar_NB_Bars        = 65u;
     //static const int                  HPBar_UpdateMSecs    = 80; //Updates at every HPBar_UpdateMSecs mseconds
     static const uint32_t             ForcedPokeSpritePack = 0x1300; //The offset where pack files containing pokemon sprites are forced to begin at
-    static const chrono::milliseconds ProgressUpdThWait    = chrono::milliseconds(100);
 
     static const int                  RETVAL_GenericFail  = -1;
     static const int                  RETVAL_InvalidOp    = -2;
@@ -141,17 +140,12 @@ namespace gfx_util
         return false;
     }
 
-    void PrintProgressLoop( atomic<uint32_t> & completed, uint32_t total, atomic<bool> & bDoUpdate )
+    /*
+        Progress hook for the parallel algorithms. Prints a percentage of "nbdone" on "total".
+    */
+    void PrintProgress( size_t nbdone, size_t total )
     {
-        while( bDoUpdate )
-        {
-            if( completed.load() <= total )
-            {
-                uint32_t percent = ( (100 * completed.load()) / total );
-                cout << "\r" <<setw(3) <<setfill(' ') <<percent <<"%" <<setw(15) <<setfill(' ') <<" ";
-            }
-            this_thread::sleep_for( ProgressUpdThWait );
-        }
+        cout << "\r" <<setw(3) <<setfill(' ') <<((100 * nbdone) / total) <<"%" <<setw(15) <<setfill(' ') <<" ";
     }
 
     /*
@@ -741,134 +735,68 @@ namespace gfx_util
         Poco::File                   infileinfo(m_inputPath);
         Poco::Path                   inputPath( m_inputPath );
         Poco::Path                   outpath;
-        future<void>                 updtProgress;
-        atomic<bool>                 shouldUpdtProgress = true;
-        multitask::CMultiTaskHandler taskmanager;
-        atomic<uint32_t>             completed = 1;
 
         //Currently, we do not support raw image export on sprites !
         ChkAndHndlUnsupportedRawOutput();
 
-        auto lambdaExpSpriteWrap = [&]( const graphics::BaseSprite * srcspr, const std::string & outpath )->bool
-        {
-            graphics::ExportSpriteToDirectoryPtr(srcspr, outpath, m_PrefOutFormat);
-            ++completed;
-            return true;
-        };
-        auto lambdaWriteFileByVec = [&completed](const std::string & path, const std::vector<uint8_t> & filedata)->bool
-        {
-            utils::io::WriteByteVectorToFile( path, filedata );
-            ++completed;
-            return true;
-        };
-
-        
         if( m_outputPath.empty() )
             m_outputPath = inputPath.parent().append( Poco::Path(inputPath).makeFile().getBaseName() ).toString();
 
         outpath = m_outputPath;
 
-        try
-        {
-            //#1 - Check if its one of the 3, uniquely named, special pack file. If not issue a warning, and continue.
-            bool           isPokeSpriteFile = MatchesPokeSpritePackFileName( inputPath.getBaseName() );
-            vector<string> pokesprnames;
+        //#1 - Check if its one of the 3, uniquely named, special pack file. If not issue a warning, and continue.
+        bool           isPokeSpriteFile = MatchesPokeSpritePackFileName( inputPath.getBaseName() );
+        vector<string> pokesprnames;
 
-            if( isPokeSpriteFile )
-            {
-                cout << "<!>-This pack is named after one of the three that contains pokemon sprite files!\n\tNaming sub-folders based on the content of \"" 
-                     <<m_pathToPokeSprNamesFile <<"\"!\n";
-                pokesprnames = utils::io::ReadTextFileLineByLine( m_pathToPokeSprNamesFile );
-            }
-            else
-            {
-                cout << "<!>-This file may or may not be a pack file that contains pokemon sprites!\n\tSub-folders won't be named!\n";
-            }
-
-            //#2 - Unpack files to raw data vector.
-            auto inpack = UnpackPackFile( inputPath );
+        if( isPokeSpriteFile )
+        {
+            cout << "<!>-This pack is named after one of the three that contains pokemon sprite files!\n\tNaming sub-folders based on the content of \"" 
+                 <<m_pathToPokeSprNamesFile <<"\"!\n";
+            pokesprnames = utils::io::ReadTextFileLineByLine( m_pathToPokeSprNamesFile );
+        }
+        else
+        {
+            cout << "<!>-This file may or may not be a pack file that contains pokemon sprites!\n\tSub-folders won't be named!\n";
+        }
 
-            //#3 - Run a check to find files that must be decompressed. And decompress them on the spot, replacing the raw data in the vector.
-            vector<unique_ptr<graphics::BaseSprite>> mysprites(inpack.getNbSubFiles());
-            TurnPackContentToSpriteData( inpack, mysprites );
+        //#2 - Unpack files to raw data vector.
+        auto inpack = UnpackPackFile( inputPath );
 
-            //Create output directory
-            Poco::File outdir( outpath );
-            if( ! outdir.exists() )
-                outdir.createDirectory();
+        //#3 - Run a check to find files that must be decompressed. And decompress them on the spot, replacing the raw data in the vector.
+        vector<unique_ptr<graphics::BaseSprite>> mysprites(inpack.getNbSubFiles());
+        TurnPackContentToSpriteData( inpack, mysprites );
 
-            //#4 - Run the sprite export code on every sprites, and export to output folder in its own named sub-folder.
-            //     Use the pokemon name list if its one of the 3 special files.
-            cout<<"\nWriting sprites to directories..\n";
+        //Create output directory
+        Poco::File outdir( outpath );
+        if( ! outdir.exists() )
+            outdir.createDirectory();
 
-            for( unsigned int i = 0; i < mysprites.size(); )
+        //#4 - Run the sprite export code on every sprites, and export to output folder in its own named sub-folder.
+        //     Use the pokemon name list if its one of the 3 special files.
+        cout<<"\nWriting sprites to directories..\n";
+        utils::parallel_ctrl progress(PrintProgress);
+        utils::parallel_for( 0, mysprites.size(), 1, [&]( size_t i )
+        {
+            stringstream sstr;
+            if( mysprites[i] == nullptr )
             {
-                if( mysprites[i] == nullptr )
-                {
-                    //Output the packed file's content as is
-                    auto & cursubf = inpack.getSubFile(i);
-                    stringstream sstr;
-                    sstr << inputPath.getBaseName()
-                         <<"_" <<setw(4) <<setfill('0') <<i <<"." 
-                         << GetAppropriateFileExtension( cursubf.begin(), cursubf.end() );                   
-
-                    taskmanager.AddTask( 
-                        multitask::pktask_t( 
-                            std::bind(lambdaWriteFileByVec, Poco::Path(outpath).append(sstr.str()).toString(), std::ref(inpack.getSubFile(i)) ) ) );
-                }
-                else 
-                {
-                    //Build the sub-folder name
-                    stringstream sstr;
-                    BaseSprite * curspr = mysprites[i].get();
-
-                    if( isPokeSpriteFile && pokesprnames.size() > i )
-                    {
-                        sstr <<setw(4) <<setfill('0') <<i <<"_" << pokesprnames[i];
-                    }
-                    else
-                    {
-                        sstr << inputPath.getBaseName()
-                             <<"_" <<setw(4) <<setfill('0') <<i;   
-                    }
-
-                    taskmanager.AddTask( 
-                        multitask::pktask_t( 
-                            std::bind(lambdaExpSpriteWrap, (mysprites[i].get()), Poco::Path(outpath).append(sstr.str()).toString() ) ) );
-                }
-                ++i;
+                //Output the packed file's content as is
+                const auto & cursubf = inpack.getSubFile(i);
+                sstr << inputPath.getBaseName()
+                     <<"_" <<setw(4) <<setfill('0') <<i <<"." 
+                     << GetAppropriateFileExtension( cursubf.begin(), cursubf.end() );
+                utils::io::WriteByteVectorToFile( Poco::Path(outpath).append(sstr.str()).toString(), cursubf );
             }
-
-            updtProgress = std::async( std::launch::async, PrintProgressLoop, std::ref(completed), mysprites.size(), std::ref(shouldUpdtProgress) );
-            
-            taskmanager.Execute();
-            taskmanager.BlockUntilTaskQueueEmpty();
-            taskmanager.StopExecute();
-
-            shouldUpdtProgress = false;
-            if( updtProgress.valid() )
-                updtProgress.get();
-
-            cout<<"\r100%";
-        }
-        catch( Poco::Exception e )
-        {
-            shouldUpdtProgress = false;
-            if( updtProgress.valid() )
-                updtProgress.get();
-
-            //rethrow
-            throw e;
-        }
-        catch( exception e )
-        {
-            shouldUpdtProgress = false;
-            if( updtProgress.valid() )
-                updtProgress.get();
-
-            //rethrow
-            throw e;
-        }
+            else 
+            {
+                //Build the sub-folder name
+                if( isPokeSpriteFile && pokesprnames.size() > i )
+                    sstr <<setw(4) <<setfill('0') <<i <<"_" << pokesprnames[i];
+                else
+                    sstr << inputPath.getBaseName() <<"_" <<setw(4) <<setfill('0') <<i;
+                graphics::ExportSpriteToDirectoryPtr( mysprites[i].get(), Poco::Path(outpath).append(sstr.str()).toString(), m_PrefOutFormat );
+            }
+        }, &progress );
         cout<<"\n";
         return 0;
     }
@@ -928,19 +856,7 @@ namespace gfx_util
         Poco::Path                   outpath;
         Poco::DirectoryIterator      itDirCount( infileinfo );
         Poco::DirectoryIterator      itDirEnd;
-        CPack                        mypack;
         vector<Poco::File>           validDirs;
-        future<void>                 updtProgress;
-        atomic<bool>                 shouldUpdtProgress = true;
-        multitask::CMultiTaskHandler taskmanager;
-        atomic<uint32_t>             completed = 0;
-
-        auto lambdaWrapBuildSpr = [&]( vector<uint8_t> & out_sprRaw, const Poco::File & infile, bool importByIndex, bool bShouldCompress )->bool
-        {
-            BuildSprFromDirAndInsert(out_sprRaw, infile.path(), importByIndex, bShouldCompress, m_bNoResAutoFix);
-            ++completed;
-            return true;
-        };
 
         //Count valid directories
         cout <<"\nGathering valid sprite sub-directories...\n";
@@ -960,80 +876,6 @@ namespace gfx_util
         }
         cout <<"\rFound " <<validDirs.size() <<" valid sprites sub-directories!\n";
 
-        cout <<"\nReading sprite data...\n";
-        //Resize the file container
-        mypack.SubFiles().resize( validDirs.size() );
-
-
-        //if( m_ImportByIndex )
-        //{
-        //    //Iterate the directory's content and get only the extracted sprites
-        //    for( unsigned int i = 0; i < validDirs.size(); ++i )
-        //    {
-        //        Poco::File & curDir = validDirs[i];
-
-        //        uint32_t     insertat = 0;
-        //        stringstream sstrindex;
-        //        sstrindex << (Poco::Path( curDir.path() ).makeFile().getFileName()); //Get the name of the directory
-        //        sstrindex >> insertat;  //Extract the index # prefix from the folder name!
-
-        //        if( insertat < validDirs.size() )
-        //        {
-        //            taskmanager.AddTask(
-        //                multitask::pktask_t(
-        //                std::bind( lambdaWrapBuildSpr, ref(mypack.SubFiles()[insertat]), ref(validDirs[i]), m_ImportByIndex, m_compressToPKDPX ) ) );
-        //        }
-        //        else
-        //            cerr<< "<!>-Warning file \"" <<curDir.path() <<"\" has an index number higher than the amount of sprite folders to pack!\nSkipping!";
-        //    }
-        //}
-        //else
-        //{
-            //Iterate the directory's content and get only the extracted sprites
-            for( unsigned int i = 0; i < validDirs.size(); ++i )
-            {
-                Poco::File & curDir = validDirs[i];
-                taskmanager.AddTask(
-                    multitask::pktask_t(
-                    std::bind( lambdaWrapBuildSpr, ref(mypack.SubFiles()[i]), ref(validDirs[i]), m_ImportByIndex, m_compressToPKDPX ) ) );
-            }
-        //}
-
-        try
-        {
-            updtProgress = std::async( std::launch::async, PrintProgressLoop, std::ref(completed), validDirs.size(), std::ref(shouldUpdtProgress) );
-            taskmanager.Execute();
-            taskmanager.BlockUntilTaskQueueEmpty();
-            taskmanager.StopExecute();
-
-            shouldUpdtProgress = false;
-            if( updtProgress.valid() )
-                updtProgress.get();
-            cout<<"\r100%"; //Can't be bothered to make another drawing update
-        }
-        catch( Poco::Exception & )
-        {
-            shouldUpdtProgress = false;
-            if( updtProgress.valid() )
-                updtProgress.get();
-
-            //rethrow
-            rethrow_exception( current_exception() );
-        }
-        catch( exception & )
-        {
-            shouldUpdtProgress = false;
-            if( updtProgress.valid() )
-                updtProgress.get();
-
-            //rethrow
-            rethrow_exception( current_exception() );
-        }
-        cout<<"\n";
-
-        //Don't forget to force the starting offset to this 
-        mypack.setForceFirstFilePosition( ForcedPokeSpritePack );
-
         //If we don't have an output path, use the input path's parent, and create a file with the same name as the folder!
         if( m_outputPath.empty() )
             m_outputPath = Poco::Path(inpath).makeFile().setExtension(PACK_FILEX).toString();
@@ -1041,8 +883,22 @@ namespace gfx_util
         outpath = m_outputPath;
 
         string outfilepath = outpath.toString();
-        cout <<"\n\nBuilding \"" <<outfilepath <<"\"...\n";
-        utils::io::WriteByteVectorToFile( outfilepath, mypack.OutputPack() );
+
+        //Each sprite is built and compressed on the thread pool, while the ones before it are written straight to the pack file.
+        // Don't forget to force the starting offset!
+        cout <<"\nBuilding \"" <<outfilepath <<"\"...\n";
+        WritePackFromProducer( outfilepath, validDirs.size(), [&]( uint32_t i )->vector<uint8_t>
+        {
+            vector<uint8_t> sprraw;
+            BuildSprFromDirAndInsert( sprraw, validDirs[i].path(), m_ImportByIndex, false, m_bNoResAutoFix );
+
+            if( !m_compressToPKDPX )
+                return std::move(sprraw);
+
+            vector<uint8_t> compressed;
+            CompressToPKDPX( sprraw.begin(), sprraw.end(), compressed, ::compression::ePXCompLevel::LEVEL_3, true );
+            return std::move(compressed);
+        }, ForcedPokeSpritePack, 0, PrintProgress );
         cout <<"\nDone!\n";
 
         return 0;
@@ -1920,107 +1776,41 @@ namespace gfx_util
 
     void ExportASpritePackFile( const std::string & fpath, const std::string & outdir, utils::io::eSUPPORT_IMG_IO imgty, const std::vector<string> & pokesprnames )
     {
-        future<void>                 updtProgress;
-        atomic<bool>                 shouldUpdtProgress = true;
-        multitask::CMultiTaskHandler taskmanager;
-        atomic<uint32_t>             completed = 1;
         Poco::Path inputPath(fpath);
 
-        try
-        {
-            //Unpack files to raw data vector.
-            auto inpack = UnpackPackFile( fpath );
+        //Unpack files to raw data vector.
+        auto inpack = UnpackPackFile( fpath );
 
-            //Run a check to find files that must be decompressed. And decompress them on the spot, replacing the raw data in the vector.
-            vector<unique_ptr<graphics::BaseSprite>> mysprites(inpack.getNbSubFiles());
-            TurnPackContentToSpriteData( inpack, mysprites );
+        //Run a check to find files that must be decompressed. And decompress them on the spot, replacing the raw data in the vector.
+        vector<unique_ptr<graphics::BaseSprite>> mysprites(inpack.getNbSubFiles());
+        TurnPackContentToSpriteData( inpack, mysprites );
 
-            auto lambdaExpSpriteWrap = [&]( const graphics::BaseSprite * srcspr, const std::string & outpath )->bool
-            {
-                graphics::ExportSpriteToDirectoryPtr(srcspr, outpath, imgty);
-                ++completed;
-                return true;
-            };
-            auto lambdaWriteFileByVec = [&completed](const std::string & path, const std::vector<uint8_t> & filedata)->bool
+        //#4 - Run the sprite export code on every sprites, and export to output folder in its own named sub-folder.
+        //     Use the pokemon name list if its one of the 3 special files.
+        cout<<"\nWriting sprites to directories..\n";
+        utils::parallel_ctrl progress(PrintProgress);
+        utils::parallel_for( 0, mysprites.size(), 1, [&]( size_t i )
+        {
+            stringstream sstr;
+            if( mysprites[i] == nullptr )
             {
-                utils::io::WriteByteVectorToFile( path, filedata );
-                ++completed;
-                return true;
-            };
-
-
-            //#4 - Run the sprite export code on every sprites, and export to output folder in its own named sub-folder.
-            //     Use the pokemon name list if its one of the 3 special files.
-            cout<<"\nWriting sprites to directories..\n";
-
-            for( unsigned int i = 0; i < mysprites.size(); )
+                //Output the packed file's content as is
+                const auto & cursubf = inpack.getSubFile(i);
+                sstr << inputPath.getBaseName()
+                     <<"_" <<setw(4) <<setfill('0') <<i <<"." 
+                     << GetAppropriateFileExtension( cursubf.begin(), cursubf.end() );
+                utils::io::WriteByteVectorToFile( Poco::Path(outdir).append(sstr.str()).toString(), cursubf );
+            }
+            else 
             {
-                if( mysprites[i] == nullptr )
-                {
-                    //Output the packed file's content as is
-                    auto & cursubf = inpack.getSubFile(i);
-                    stringstream sstr;
-                    sstr << inputPath.getBaseName()
-                         <<"_" <<setw(4) <<setfill('0') <<i <<"." 
-                         << GetAppropriateFileExtension( cursubf.begin(), cursubf.end() );                   
-
-                    taskmanager.AddTask( 
-                        multitask::pktask_t( 
-                            std::bind(lambdaWriteFileByVec, Poco::Path(outdir).append(sstr.str()).toString(), std::ref(inpack.getSubFile(i)) ) ) );
-                }
-                else 
-                {
-                    //Build the sub-folder name
-                    stringstream sstr;
-                    BaseSprite * curspr = mysprites[i].get();
-
-                    if( pokesprnames.size() > i )
-                    {
-                        sstr <<setw(4) <<setfill('0') <<i <<"_" << pokesprnames[i];
-                    }
-                    else
-                    {
-                        sstr << inputPath.getBaseName()
-                             <<"_" <<setw(4) <<setfill('0') <<i;   
-                    }
-
-                    taskmanager.AddTask( 
-                        multitask::pktask_t( 
-                            std::bind(lambdaExpSpriteWrap, (mysprites[i].get()), Poco::Path(outdir).append(sstr.str()).toString() ) ) );
-                }
-                ++i;
+                //Build the sub-folder name
+                if( pokesprnames.size() > i )
+                    sstr <<setw(4) <<setfill('0') <<i <<"_" << pokesprnames[i];
+                else
+                    sstr << inputPath.getBaseName() <<"_" <<setw(4) <<setfill('0') <<i;
+                graphics::ExportSpriteToDirectoryPtr( mysprites[i].get(), Poco::Path(outdir).append(sstr.str()).toString(), imgty );
             }
-
-            updtProgress = std::async( std::launch::async, PrintProgressLoop, std::ref(completed), mysprites.size(), std::ref(shouldUpdtProgress) );
-            
-            taskmanager.Execute();
-            taskmanager.BlockUntilTaskQueueEmpty();
-            taskmanager.StopExecute();
-
-            shouldUpdtProgress = false;
-            if( updtProgress.valid() )
-                updtProgress.get();
-
-            cout<<"\r100%";
-        }
-        catch( const Poco::Exception & )
-        {
-            shouldUpdtProgress = false;
-            if( updtProgress.valid() )
-                updtProgress.get();
-
-            //rethrow
-            std::rethrow_exception(current_exception());
-        }
-        catch( const exception & )
-        {
-            shouldUpdtProgress = false;
-            if( updtProgress.valid() )
-                updtProgress.get();
-
-            //rethrow
-            std::rethrow_exception(current_exception());
-        }
+        }, &progress );
         cout<<"\n";
     }
 
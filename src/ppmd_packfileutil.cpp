@@ -17,6 +17,8 @@ Description:
 #include <fstream>
 #include <iostream>
 #include <Poco/Path.h>
+#include <Poco/File.h>
+#include <Poco/DirectoryIterator.h>
 using namespace ::std;
 using namespace ::pmd2;
 using namespace ::utils::io;
@@ -44,34 +46,43 @@ namespace ppmd_packfileutil
 //=================================================================================================
     void DoUnpack( string inpath, string outpath )
     {
-        CPack pack;
-        vector<uint8_t> filedata;
-        ReadFileToByteVector( inpath, filedata );
-
         cout << "\nUnpacking file : \n" 
             << "   " << inpath <<"\n"
 		    <<"into:\n" 
             << "   " <<outpath <<"\n" <<endl;
 
-        pack.LoadPack( filedata.begin(), filedata.end() );
+        //Map the file instead of loading it, so sub-files are only copied one at a time while being written
+        PackView pack( inpath );
         pack.OutputToFolder( outpath );
     }
 
     void DoPack( string inpath, string outpath, unsigned int forcedoffset )
     {
-        CPack pack;
-        vector<uint8_t> outfiledata;
+        vector<string> subfiles;
 
 	    cout << "\nPacking Directory : \n" 
                 << "   " << inpath <<"\n"
 			    <<"into:\n" 
                 << "   " <<outpath <<"\n" <<endl;
 
-        pack.LoadFolder( inpath );
-        pack.setForceFirstFilePosition( forcedoffset );
-        outfiledata = std::move( pack.OutputPack() ); //Explicit move constructor
+        if( !utils::isFolder(inpath) )
+            throw runtime_error("DoPack(): Invalid input path !");
+
+        //Same files, in the same order as CPack::LoadFolder() would pick
+        for( Poco::DirectoryIterator itdir(inpath), itdirend; itdir != itdirend; ++itdir )
+        {
+            if( itdir->isFile() && !(itdir->isHidden()) )
+                subfiles.push_back( itdir->path() );
+        }
+
+        if( subfiles.empty() )
+            throw runtime_error("DoPack(): No files to pack in the input directory!");
 
-        WriteByteVectorToFile( outpath, outfiledata );
+        //Files are read ahead on the thread pool while the previous ones are being written, so only a few are ever in memory
+        WritePackFromProducer( outpath, subfiles.size(), [&subfiles]( uint32_t i )
+        {
+            return ReadFileToByteVector( subfiles[i] );
+        }, forcedoffset );
     }
 
 
@@ -3,6 +3,7 @@
 #include <utils/pugixml_utils.hpp>
 #include <utils/library_wide.hpp>
 #include <utils/utility.hpp>
+#include <utils/parallel_tasks.hpp>
 #include <pugixml.hpp>
 #include <string>
 #include <iostream>
@@ -10,6 +11,9 @@
 #include <iomanip>
 #include <locale>
 #include <vector>
+#include <algorithm>
+#include <tuple>
+#include <exception>
 #include <Poco/DirectoryIterator.h>
 #include <Poco/File.h>
 #include <Poco/Path.h>
@@ -101,42 +105,48 @@ namespace pmd2 { namespace stats
                 throw runtime_error( sstr.str() );
             }
             
+            //Every item goes into its own document, so they're built and saved over several threads.
             const string dirprefix = utils::TryAppendSlash( destdir );
+            utils::parallel_for( 0, m_items.size(), NbEntriesPerChunk, [this,&dirprefix]( size_t cntitem )
+            {
+                WriteItem( dirprefix, static_cast<unsigned int>(cntitem) );
+            });
+        }
+
+    private:
+
+        void WriteItem( const string & dirprefix, unsigned int cntitem )
+        {
+            using namespace itemxml;
             stringstream fname;
+            xml_document doc;
+            xml_node     itemdata = doc.append_child( ROOT_Item.c_str() );
+            bool         isEoS    = m_items[cntitem].Get_EoTD_ItemData() == nullptr;
 
-            for( size_t cntitem = 0; cntitem < m_items.size(); ++cntitem )
+            if( isEoS )
             {
-                fname.str(string()); //Purge stringstream
-                xml_document doc;
-                xml_node     itemdata = doc.append_child( ROOT_Item.c_str() );
-                bool         isEoS    = m_items[cntitem].Get_EoTD_ItemData() == nullptr;
-
-                if( isEoS )
-                {
-                    AppendAttribute( itemdata, ATTR_GameVer, ATTR_GameVerEoS );
-                    WriteCommentNode( itemdata, CMT_EoS );
-                }
-                else
-                {
-                    AppendAttribute( itemdata, ATTR_GameVer, ATTR_GameVerEoTD );
-                    WriteCommentNode( itemdata, CMT_EoTD );
-                }
+                AppendAttribute( itemdata, ATTR_GameVer, ATTR_GameVerEoS );
+                WriteCommentNode( itemdata, CMT_EoS );
+            }
+            else
+            {
+                AppendAttribute( itemdata, ATTR_GameVer, ATTR_GameVerEoTD );
+                WriteCommentNode( itemdata, CMT_EoTD );
+            }
 
-                if(!m_bNoStrings)
-                    WriteStrings( itemdata, cntitem );
-                WriteCommentNode( itemdata, CMT_Data );
-                _WriteItemData( itemdata, m_items[cntitem] );
+            if(!m_bNoStrings)
+                WriteStrings( itemdata, cntitem );
+            WriteCommentNode( itemdata, CMT_Data );
+            _WriteItemData( itemdata, m_items[cntitem] );
 
-                MakeFilename( fname, dirprefix, cntitem );
+            MakeFilename( fname, dirprefix, cntitem );
 
-                if( ! doc.save_file( fname.str().c_str() ) )
-                {
-                    stringstream strerr;
-                    strerr << "ItemXMLWriter::Write(): Pugixml couldn't write file \"" <<fname.str() <<"\"!";
-                    throw runtime_error(strerr.str());
-                }
+            if( ! doc.save_file( fname.str().c_str() ) )
+            {
+                stringstream strerr;
+                strerr << "ItemXMLWriter::Write(): Pugixml couldn't write file \"" <<fname.str() <<"\"!";
+                throw runtime_error(strerr.str());
             }
-
         }
 
     private:
@@ -262,6 +272,8 @@ namespace pmd2 { namespace stats
         }
 
     private:
+        static const size_t            NbEntriesPerChunk = 4;
+
         const ItemsDB                & m_items;
         const GameText               * m_pgametext;
         bool                           m_bNoStrings;
@@ -272,6 +284,16 @@ namespace pmd2 { namespace stats
     **********************************************************************/
     class ItemXMLParser
     {
+        //A string read from a file, to be written to the GameText once all files were read. (language, string block, string)
+        typedef std::tuple<eGameLanguages, eStringBlocks, std::string> pendingstr_t;
+
+        //What was read from a single item XML file, besides the item itself
+        struct itemfileentry
+        {
+            vector<pendingstr_t> strings;
+            std::exception_ptr   perror;
+        };
+
     public:
         ItemXMLParser( GameText* pgtext )
             :m_pgametext(pgtext), m_bNoStrings(false)
@@ -279,7 +301,7 @@ namespace pmd2 { namespace stats
 
         ItemsDB Parse( const string & srcdir )
         {
-            if( !m_pgametext || m_pgametext->AreStringsLoaded() )
+            if( !m_pgametext || !m_pgametext->AreStringsLoaded() )
             {
                 clog << "<!>- ItemXMLParser::Parse(): No strings loaded, ignoring everything text related! (Names, descriptions, etc..)\n";
                 m_bNoStrings = true;
@@ -297,6 +319,8 @@ namespace pmd2 { namespace stats
                         filelst.push_back( Poco::Path::transcode(itDir.path().absolute().toString()) );
                 }
 
+                //The directory order isn't the same on every platforms, and the file names begin with the item's index
+                std::sort( filelst.begin(), filelst.end() );
                 return std::move( _ParseAllItems(filelst) );
             }
             catch( exception & e )
@@ -309,34 +333,69 @@ namespace pmd2 { namespace stats
 
     private:
 
-        ItemsDB _ParseAllItems( const vector<string> filelst )
+        ItemsDB _ParseAllItems( const vector<string> & filelst )
         {
-            using namespace itemxml;
             ItemsDB resitems;
-
             resitems.resize(filelst.size());
-            auto ititem = resitems.begin();
 
-            for( auto & item : filelst )
+            //Each thread loads and reads a single file at a time. Errors are kept until everything is put together.
+            vector<itemfileentry> entries(filelst.size());
+            utils::parallel_for( 0, filelst.size(), 1, [&]( size_t cntfile )
             {
-                xml_document     doc;
-                xml_parse_result loadres = doc.load_file( item.c_str() );
-                if( ! loadres )
+                try
                 {
-                    stringstream sstr;
-                    sstr <<"Can't load XML document \"" <<filelst.front() <<"\"! Pugixml returned an error : \"" << loadres.description() <<"\"";
-                    throw std::runtime_error(sstr.str());
+                    _ParseItemFile( filelst[cntfile], resitems[cntfile], entries[cntfile].strings );
                 }
+                catch(...)
+                {
+                    entries[cntfile].perror = std::current_exception();
+                }
+            });
 
-                _ParseItem( doc.first_child(), *ititem, item );
-
-                ++ititem;
+            //Strings are written in file order, so if two files have the same item id, the last one wins like before
+            for( size_t cntfile = 0; cntfile < entries.size(); ++cntfile )
+            {
+                if( entries[cntfile].perror )
+                    std::rethrow_exception(entries[cntfile].perror);
+                WriteStrings( entries[cntfile].strings, resitems[cntfile].itemID );
             }
 
             return std::move( resitems );
         }
 
-        void ReadStrings( xml_node & strnode, uint32_t itemID )
+        /*
+            Runs on a worker thread. Must not touch anything shared besides reading from the GameText.
+        */
+        void _ParseItemFile( const string & fpath, stats::itemdata & out_item, vector<pendingstr_t> & out_strings )
+        {
+            xml_document     doc;
+            xml_parse_result loadres = doc.load_file( fpath.c_str() );
+            if( ! loadres )
+            {
+                stringstream sstr;
+                sstr <<"Can't load XML document \"" <<fpath <<"\"! Pugixml returned an error : \"" << loadres.description() <<"\"";
+                throw std::runtime_error(sstr.str());
+            }
+
+            _ParseItem( doc.first_child(), out_item, fpath, out_strings );
+        }
+
+        /*
+            Writes the strings read from an item's file.
+        */
+        void WriteStrings( const vector<pendingstr_t> & strs, uint32_t itemID )
+        {
+            for( const auto & pending : strs )
+            {
+                const eStringBlocks blk  = std::get<1>(pending);
+                string            * pstr = m_pgametext->GetStrings(std::get<0>(pending))->second.GetStringIfBlockExists( blk, itemID );
+                if(!pstr)
+                    throw std::runtime_error("ItemXMLParser::WriteStrings(): Couldn't access the " + StringBlocksNames[static_cast<unsigned int>(blk)] + " string block!");
+                *(pstr) = std::get<2>(pending);
+            }
+        }
+
+        void ReadStrings( xml_node & strnode, vector<pendingstr_t> & out_strings )
         {
             using namespace itemxml;
             for( auto & curnode : strnode.children() )
@@ -345,18 +404,18 @@ namespace pmd2 { namespace stats
                 if( glang != eGameLanguages::Invalid )
                 {
                     //Parse multi-language strings
-                    ReadLangStrings(curnode, glang, itemID);
+                    ReadLangStrings(curnode, glang, out_strings);
                 }
                 else
                 {
                     //If the game isn't multi-lingual, just parse the strings for english
                     clog<<"<!>- ItemXMLParser::ReadStrings() : Found a non language named node!\n";
-                    ReadLangStrings(curnode, eGameLanguages::english, itemID);
+                    ReadLangStrings(curnode, eGameLanguages::english, out_strings);
                 }
             }
         }
 
-        void ReadLangStrings( xml_node & langnode, eGameLanguages lang, uint32_t itemID )
+        void ReadLangStrings( xml_node & langnode, eGameLanguages lang, vector<pendingstr_t> & out_strings )
         {
             auto langstr = m_pgametext->GetStrings(lang);
             if( langstr == m_pgametext->end() )
@@ -369,36 +428,15 @@ namespace pmd2 { namespace stats
             for( auto & curnode : langnode.children() )
             {
                 if( curnode.name() == PROP_Name )
-                {
-                    string itemname = curnode.child_value();
-                    itemname += "\\0"; //put back the \0
-                    string * pstr = langstr->second.GetStringIfBlockExists(eStringBlocks::ItemNames, itemID);
-                    if(!pstr)
-                        throw std::runtime_error("ItemXMLParser::ReadLangStrings(): Couldn't access the item names string block!");
-                    *(pstr) = itemname;
-                }
+                    out_strings.emplace_back( lang, eStringBlocks::ItemNames, string(curnode.child_value()) + "\\0" ); //put back the \0
                 else if( curnode.name() == PROP_ShortDesc )
-                {
-                    string itemdescsh = curnode.child_value();
-                    itemdescsh += "\\0"; //put back the \0
-                    string * pstr = langstr->second.GetStringIfBlockExists(eStringBlocks::ItemDescS, itemID);
-                    if(!pstr)
-                        throw std::runtime_error("ItemXMLParser::ReadLangStrings(): Couldn't access the item short description string block!");
-                    *(pstr) = itemdescsh;
-                }
+                    out_strings.emplace_back( lang, eStringBlocks::ItemDescS, string(curnode.child_value()) + "\\0" ); //put back the \0
                 else if( curnode.name() == PROP_LongDesc )
-                {
-                    string itemdescl = curnode.child_value();
-                    itemdescl += "\\0"; //put back the \0
-                    string * pstr = langstr->second.GetStringIfBlockExists(eStringBlocks::ItemDescL, itemID);
-                    if(!pstr)
-                        throw std::runtime_error("ItemXMLParser::ReadLangStrings(): Couldn't access the item long description string block!");
-                    *(pstr) = itemdescl;
-                }
+                    out_strings.emplace_back( lang, eStringBlocks::ItemDescL, string(curnode.child_value()) + "\\0" ); //put back the \0
             }
         }
 
-        void _ParseItem( const pugi::xml_node & itemnode, stats::itemdata & item, const string & itemname )
+        void _ParseItem( const pugi::xml_node & itemnode, stats::itemdata & item, const string & itemname, vector<pendingstr_t> & out_strings )
         {
             using namespace itemxml;
             //Check the game version of the data
@@ -409,11 +447,11 @@ namespace pmd2 { namespace stats
             {
                 if( gvs == ATTR_GameVerEoS )
                 {
-                    _ParseEoSData( itemnode, item );
+                    _ParseEoSData( itemnode, item, out_strings );
                 }
                 else if( gvs == ATTR_GameVerEoTD )
                 {
-                    _ParseEoTDData( itemnode, item );
+                    _ParseEoTDData( itemnode, item, out_strings );
                 }
                 else
                 {
@@ -430,7 +468,7 @@ namespace pmd2 { namespace stats
             }
         }
 
-        void _ParseEoSData( const pugi::xml_node & itemnode, stats::itemdata & item )
+        void _ParseEoSData( const pugi::xml_node & itemnode, stats::itemdata & item, vector<pendingstr_t> & out_strings )
         {
             using namespace itemxml;
             //xml_node        strnode;
@@ -464,7 +502,7 @@ namespace pmd2 { namespace stats
             for( auto & curnode : itemnode.children() )
             {
                 if( curnode.name() == NODE_Strings )
-                    ReadStrings( curnode, item.itemID );
+                    ReadStrings( curnode, out_strings );
             }
         }
 
@@ -518,7 +556,7 @@ namespace pmd2 { namespace stats
             }
         }
 
-        void _ParseEoTDData( const pugi::xml_node & itemnode, stats::itemdata & item )
+        void _ParseEoTDData( const pugi::xml_node & itemnode, stats::itemdata & item, vector<pendingstr_t> & out_strings )
         {
             //#TODO: Finish _ParseEoTDData !
             cerr <<"\nExplorers of Time and Darkness data parsing not implemented yet!!!\n";
@@ -540,7 +578,7 @@ namespace pmd2 { namespace stats
             }
 
             //
-            ReadStrings( strnode, item.itemID );
+            ReadStrings( strnode, out_strings );
         }
 
     private:
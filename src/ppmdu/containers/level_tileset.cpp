@@ -107,8 +107,10 @@ namespace pmd2
                 ofstream ofimg(curimgname.str() + ".4bpp", ios::binary | ios::out );
                 ofimg.exceptions(ios::badbit);
                 ostreambuf_iterator<char> itoutimg(ofimg);
-                for( const auto & tile : layer.Tiles() )
+                //Tile 0 is the game's empty tile, which isn't stored in the BPC, so leave it out of the dump too
+                for( auto ittile = layer.Tiles().begin() + ((layer.Tiles().empty())? 0 : 1); ittile != layer.Tiles().end(); ++ittile )
                 {
+                    const auto & tile = *ittile;
                     for( size_t cntpix = 0; cntpix < (tile.size()-1); ++cntpix )
                     {
                         uint8_t pixel4bpp = tile[cntpix] | static_cast<uint8_t>(tile[cntpix + 1]) << 4;
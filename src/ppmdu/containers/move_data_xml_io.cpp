@@ -3,6 +3,7 @@
 #include <utils/pugixml_utils.hpp>
 #include <utils/library_wide.hpp>
 #include <utils/utility.hpp>
+#include <utils/parallel_tasks.hpp>
 #include <pugixml.hpp>
 #include <string>
 #include <iostream>
@@ -12,6 +13,9 @@
 #include <vector>
 #include <utility>
 #include <functional>
+#include <algorithm>
+#include <tuple>
+#include <exception>
 #include <Poco/DirectoryIterator.h>
 #include <Poco/File.h>
 #include <Poco/Path.h>
@@ -125,72 +129,83 @@ namespace pmd2 { namespace stats
         }
 
 
+        /*
+            Every move goes into its own document, so they're built and saved over several threads.
+        */
         void WriteEoS( const std::string & destdir )
         {
-            using namespace movesXML;
             const string dirprefix = utils::TryAppendSlash( destdir );
-            stringstream fname;
 
             if( m_src1.size() != m_psrc2->size() )
                 throw runtime_error("Size mismatch between the two move data lists! One list of moves is longer than the other!");
 
-            for( unsigned int cntmv = 0; cntmv < m_src1.size(); ++cntmv/*, ++itcurname, ++itcurdesc*/ )
+            utils::parallel_for( 0, m_src1.size(), NbEntriesPerChunk, [this,&dirprefix]( size_t cntmv )
             {
-                fname.str(string());
-                xml_document doc;
-                xml_node     movedata = doc.append_child( ROOT_Move.c_str() );
-                AppendAttribute( movedata, ATTR_GameVer, pmd2::GetGameVersionName( eGameVersion::EoS ) );
-                WriteCommentNode( movedata, "Pokemon Mystery Dungeon: Explorers of Sky move data" );
+                WriteMoveEoS( dirprefix, static_cast<unsigned int>(cntmv) );
+            });
+        }
+
+        void WriteMoveEoS( const std::string & dirprefix, unsigned int cntmv )
+        {
+            using namespace movesXML;
+            stringstream fname;
+            xml_document doc;
+            xml_node     movedata = doc.append_child( ROOT_Move.c_str() );
+            AppendAttribute( movedata, ATTR_GameVer, pmd2::GetGameVersionName( eGameVersion::EoS ) );
+            WriteCommentNode( movedata, "Pokemon Mystery Dungeon: Explorers of Sky move data" );
 
-                if( !m_bNoStrings )
-                    WriteStrings( movedata, cntmv );
+            if( !m_bNoStrings )
+                WriteStrings( movedata, cntmv );
 
-                WriteCommentNode( movedata, "Move data from waza_p.bin" );
-                WriteMove( movedata, m_src1[cntmv] );
-                WriteCommentNode( movedata, "Move data from waza_p2.bin" );
-                WriteMove( movedata, (*m_psrc2)[cntmv] );
+            WriteCommentNode( movedata, "Move data from waza_p.bin" );
+            WriteMove( movedata, m_src1[cntmv] );
+            WriteCommentNode( movedata, "Move data from waza_p2.bin" );
+            WriteMove( movedata, (*m_psrc2)[cntmv] );
 
-                MakeFilename(fname, dirprefix, cntmv);
+            MakeFilename(fname, dirprefix, cntmv);
 
-                if( ! doc.save_file( fname.str().c_str() ) )
-                {
-                    stringstream strerr;
-                    strerr << "Pugixml couldn't write file \"" <<fname.str() <<"\"!";
-                    throw runtime_error(strerr.str());
-                }
+            if( ! doc.save_file( fname.str().c_str() ) )
+            {
+                stringstream strerr;
+                strerr << "Pugixml couldn't write file \"" <<fname.str() <<"\"!";
+                throw runtime_error(strerr.str());
             }
         }
 
         void WriteEoTD( const std::string & destdir )
         {
-            using namespace movesXML;
             const string dirprefix = utils::TryAppendSlash( destdir );
-            stringstream fname;
 
-            for( unsigned int cntmv = 0; cntmv < m_src1.size(); ++cntmv/*, ++itcurname, ++itcurdesc*/ )
+            utils::parallel_for( 0, m_src1.size(), NbEntriesPerChunk, [this,&dirprefix]( size_t cntmv )
             {
-                fname.str(string());
-                xml_document doc;
-                xml_node     movedata = doc.append_child( ROOT_Move.c_str() );
-                AppendAttribute( movedata, ATTR_GameVer, pmd2::GetGameVersionName( eGameVersion::EoT ) );
-                AppendAttribute( movedata, ATTR_GameVer, pmd2::GetGameVersionName( eGameVersion::EoD ) );
-                WriteCommentNode( movedata, "Pokemon Mystery Dungeon: Explorers of Time/Darkness move data" );
+                WriteMoveEoTD( dirprefix, static_cast<unsigned int>(cntmv) );
+            });
+        }
+
+        void WriteMoveEoTD( const std::string & dirprefix, unsigned int cntmv )
+        {
+            using namespace movesXML;
+            stringstream fname;
+            xml_document doc;
+            xml_node     movedata = doc.append_child( ROOT_Move.c_str() );
+            AppendAttribute( movedata, ATTR_GameVer, pmd2::GetGameVersionName( eGameVersion::EoT ) );
+            AppendAttribute( movedata, ATTR_GameVer, pmd2::GetGameVersionName( eGameVersion::EoD ) );
+            WriteCommentNode( movedata, "Pokemon Mystery Dungeon: Explorers of Time/Darkness move data" );
 
-                if( !m_bNoStrings )
-                    WriteStrings( movedata, cntmv );
+            if( !m_bNoStrings )
+                WriteStrings( movedata, cntmv );
 
-                WriteCommentNode( movedata, "Move data from waza_p.bin" );
-                WriteMove   ( movedata, m_src1[cntmv] );
+            WriteCommentNode( movedata, "Move data from waza_p.bin" );
+            WriteMove   ( movedata, m_src1[cntmv] );
 
-                MakeFilename(fname, dirprefix, cntmv);
-                //fname <<dirprefix <<setw(4) <<setfill('0') <<dec <<i <<"_" << PrepareMvNameFName(*itcurname) <<".xml";
+            MakeFilename(fname, dirprefix, cntmv);
+            //fname <<dirprefix <<setw(4) <<setfill('0') <<dec <<i <<"_" << PrepareMvNameFName(*itcurname) <<".xml";
 
-                if( ! doc.save_file( fname.str().c_str() ) )
-                {
-                    stringstream strerr;
-                    strerr << "Pugixml couldn't write file \"" <<fname.str() <<"\"!";
-                    throw runtime_error(strerr.str());
-                }
+            if( ! doc.save_file( fname.str().c_str() ) )
+            {
+                stringstream strerr;
+                strerr << "Pugixml couldn't write file \"" <<fname.str() <<"\"!";
+                throw runtime_error(strerr.str());
             }
         }
 
@@ -243,6 +258,8 @@ namespace pmd2 { namespace stats
         }
 
     private:
+        static const size_t             NbEntriesPerChunk = 4;
+
         const MoveDB                   &m_src1;
         const MoveDB                   *m_psrc2;
         const GameText                 *m_pgametext;
@@ -254,6 +271,23 @@ namespace pmd2 { namespace stats
     **********************************************************************/
     class MoveDB_XMLParser
     {
+        //A string read from a file, to be written to the GameText once the move's id is known. (language, string block, string)
+        typedef std::tuple<eGameLanguages, eStringBlocks, std::string> pendingstr_t;
+
+        //What was read from a single move XML file
+        struct movefileentry
+        {
+            movefileentry()
+                :bhasdata(false), gamever(eGameVersion::Invalid)
+            {}
+            bool                 bhasdata;
+            eGameVersion         gamever;
+            vector<MoveData>     data1;
+            vector<MoveData>     data2;
+            vector<pendingstr_t> strings;
+            std::exception_ptr   perror;
+        };
+
     public:
         typedef pair<vector<string>::iterator,vector<string>::iterator> range_t;
 
@@ -288,6 +322,9 @@ namespace pmd2 { namespace stats
                 if(filelst.empty())
                     throw runtime_error( "MoveDB_XMLParser::Parse(): Found no move files to parse!" );
 
+                //The directory order isn't the same on every platforms, and the file names begin with the move's index
+                std::sort( filelst.begin(), filelst.end() );
+
                 ReadAllMoves(filelst);
             }
             catch( exception & e )
@@ -326,7 +363,21 @@ namespace pmd2 { namespace stats
         */
         void ReadAllMoves( const vector<string> & files )
         {
-            using namespace movesXML;
+            //Each thread loads and reads a single file at a time. Errors are kept until everything is put together.
+            vector<movefileentry> entries(files.size());
+            utils::parallel_for( 0, files.size(), 1, [&]( size_t cntfile )
+            {
+                try
+                {
+                    ReadMoveFile( files[cntfile], entries[cntfile] );
+                }
+                catch(...)
+                {
+                    entries[cntfile].perror = std::current_exception();
+                }
+            });
+
+            //Put everything together in file order, so the result doesn't depend on which thread finished first
             MoveDB result1;
             MoveDB result2;
 
@@ -335,39 +386,29 @@ namespace pmd2 { namespace stats
             if( !m_pout2 )
                 result2.reserve(files.size());
 
-            //Parse files
             uint32_t cntmv = 0;
-            for( auto & mv : files )
+            for( size_t cntfile = 0; cntfile < files.size(); ++cntfile )
             {
-                uint32_t         moveid = GetCurrentMoveId( mv, cntmv );
-                xml_document     doc;
-                xml_parse_result loadres = doc.load_file(mv.c_str());
-                if( ! loadres )
-                {
-                    stringstream sstr;
-                    sstr <<"Can't load XML document \"" <<mv <<"\"! Pugixml returned an error : \"" << loadres.description() <<"\"";
-                    throw std::runtime_error(sstr.str());
-                }
+                movefileentry & entry = entries[cntfile];
+                if( entry.perror )
+                    std::rethrow_exception(entry.perror);
 
-                pugi::xml_node movenode  = doc.child(ROOT_Move.c_str());
-                if( !movenode )
+                if( !entry.bhasdata )
                 {
-                    clog <<"<!>- MoveDB_XML_Parser::ReadAllMoves(): No move data found in XML file \"" <<mv <<"\". Skipping..\n";
+                    clog <<"<!>- MoveDB_XML_Parser::ReadAllMoves(): No move data found in XML file \"" <<files[cntfile] <<"\". Skipping..\n";
                     continue;
                 }
-
-                eGameVersion gamever = DetectGameVersion(movenode);
-
-                if( gamever == eGameVersion::EoS )
-                    HandleMoveEoS( movenode, moveid, result1, result2 );
-                else if( gamever == eGameVersion::EoT || gamever == eGameVersion::EoD )
-                    HandleMoveEoTD( movenode, moveid, result1 );
-                else
+                else if( entry.gamever != eGameVersion::EoS && entry.gamever != eGameVersion::EoT && entry.gamever != eGameVersion::EoD )
                 {
                     clog <<"<!>- MoveDB_XML_Parser::ReadAllMoves(): Got move with invalid game version.. Skipping..\n";
                     continue;
                 }
 
+                WriteStrings( entry.strings, GetCurrentMoveId( files[cntfile], cntmv ) );
+                for( auto & mvdata : entry.data1 )
+                    result1.push_back( std::move(mvdata) );
+                for( auto & mvdata : entry.data2 )
+                    result2.push_back( std::move(mvdata) );
                 ++cntmv;
             }
 
@@ -380,6 +421,49 @@ namespace pmd2 { namespace stats
             }
         }
 
+        /*
+            Runs on a worker thread. Must not touch anything shared besides reading from the GameText.
+        */
+        void ReadMoveFile( const string & fpath, movefileentry & out_entry )
+        {
+            using namespace movesXML;
+            xml_document     doc;
+            xml_parse_result loadres = doc.load_file(fpath.c_str());
+            if( ! loadres )
+            {
+                stringstream sstr;
+                sstr <<"Can't load XML document \"" <<fpath <<"\"! Pugixml returned an error : \"" << loadres.description() <<"\"";
+                throw std::runtime_error(sstr.str());
+            }
+
+            pugi::xml_node movenode  = doc.child(ROOT_Move.c_str());
+            if( !movenode )
+                return;
+
+            out_entry.bhasdata = true;
+            out_entry.gamever  = DetectGameVersion(movenode);
+
+            if( out_entry.gamever == eGameVersion::EoS )
+                HandleMoveEoS( movenode, out_entry );
+            else if( out_entry.gamever == eGameVersion::EoT || out_entry.gamever == eGameVersion::EoD )
+                HandleMoveEoTD( movenode, out_entry );
+        }
+
+        /*
+            Writes the strings read from a move's file, now that we know its id.
+        */
+        void WriteStrings( const vector<pendingstr_t> & strs, uint32_t moveid )
+        {
+            for( const auto & pending : strs )
+            {
+                const eStringBlocks blk  = std::get<1>(pending);
+                string            * pstr = m_pgametext->GetStrings(std::get<0>(pending))->second.GetStringIfBlockExists( blk, moveid );
+                if(!pstr)
+                    throw std::runtime_error("MoveDB_XML_Parser::WriteStrings(): Couldn't access the " + StringBlocksNames[static_cast<unsigned int>(blk)] + " string block!");
+                *(pstr) = std::get<2>(pending);
+            }
+        }
+
         /*
         */
         eGameVersion DetectGameVersion( xml_node & movenode )
@@ -404,24 +488,24 @@ namespace pmd2 { namespace stats
 
         /*
         */
-        void HandleMoveEoS( xml_node & pn, uint32_t moveid, MoveDB & result1, MoveDB & result2 )
+        void HandleMoveEoS( xml_node & pn, movefileentry & out_entry )
         {
             using namespace movesXML;
             bool breadData1 = false; //This is to alternate between data entry 1 and 2
             for( auto & cnode : pn.children() )
             {
                 if( !m_bNoStrings && cnode.name() == NODE_Strings )
-                    ReadStrings( cnode, moveid );
+                    ReadStrings( cnode, out_entry.strings );
                 else if( cnode.name() == NODE_Data )
                 {
                     if( !breadData1 )
                     {
-                        result1.push_back(ReadMoveData( cnode ));
+                        out_entry.data1.push_back(ReadMoveData( cnode ));
                         breadData1 = true;
                     }
                     else
                     {
-                        result2.push_back(ReadMoveData( cnode ));
+                        out_entry.data2.push_back(ReadMoveData( cnode ));
                         breadData1 = false;
                     }
                 }
@@ -430,21 +514,21 @@ namespace pmd2 { namespace stats
 
         /*
         */
-        void HandleMoveEoTD( xml_node & pn, uint32_t moveid, MoveDB & result1 )
+        void HandleMoveEoTD( xml_node & pn, movefileentry & out_entry )
         {
             using namespace movesXML;
             for( auto & cnode : pn.children() )
             {
                 if( !m_bNoStrings && cnode.name() == NODE_Strings )
-                    ReadStrings( cnode, moveid );
+                    ReadStrings( cnode, out_entry.strings );
                 else if( cnode.name() == NODE_Data )
-                    result1.push_back(ReadMoveData( cnode ));
+                    out_entry.data1.push_back(ReadMoveData( cnode ));
             }
         }
 
         /*
         */
-        void ReadStrings( xml_node & pn, uint32_t moveid )
+        void ReadStrings( xml_node & pn, vector<pendingstr_t> & out_strings )
         {
             using namespace movesXML;
             for( auto & curnode : pn.children() )
@@ -453,20 +537,20 @@ namespace pmd2 { namespace stats
                 if( glang != eGameLanguages::Invalid )
                 {
                     //Parse multi-language strings
-                    ReadLangStrings(curnode, glang, moveid);
+                    ReadLangStrings(curnode, glang, out_strings);
                 }
                 else
                 {
                     //If the game isn't multi-lingual, just parse the strings for english
                     clog<<"<!>- MoveDB_XML_Parser::ReadStrings() : Found a non language named node!\n";
-                    ReadLangStrings(curnode, eGameLanguages::english, moveid);
+                    ReadLangStrings(curnode, eGameLanguages::english, out_strings);
                 }
             }
         }
 
         /*
         */
-        void ReadLangStrings( xml_node & langnode, eGameLanguages lang, uint32_t moveid )
+        void ReadLangStrings( xml_node & langnode, eGameLanguages lang, vector<pendingstr_t> & out_strings )
         {
             using namespace movesXML;
             auto langstr = m_pgametext->GetStrings(lang);
@@ -479,23 +563,9 @@ namespace pmd2 { namespace stats
             for( auto & curnode : langnode.children() )
             {
                 if( curnode.name() == PROP_Name )
-                {
-                    string name = curnode.child_value();
-                    name += "\\0"; //put back the \0
-                    string * pstr = langstr->second.GetStringIfBlockExists(eStringBlocks::MvNames, moveid);
-                    if(!pstr)
-                        throw std::runtime_error("MoveDB_XML_Parser::ReadLangStrings(): Couldn't access the move name string block!");
-                    *(pstr) = name;
-                }
+                    out_strings.emplace_back( lang, eStringBlocks::MvNames, string(curnode.child_value()) + "\\0" ); //put back the \0
                 else if( curnode.name() == PROP_Desc )
-                {
-                    string desc = curnode.child_value();
-                    desc += "\\0"; //put back the \0
-                    string * pstr = langstr->second.GetStringIfBlockExists(eStringBlocks::MvDesc, moveid);
-                    if(!pstr)
-                        throw std::runtime_error("MoveDB_XML_Parser::ReadLangStrings(): Couldn't access the move description string block!");
-                    *(pstr) = desc;
-                }
+                    out_strings.emplace_back( lang, eStringBlocks::MvDesc,  string(curnode.child_value()) + "\\0" ); //put back the \0
             }
         }
 
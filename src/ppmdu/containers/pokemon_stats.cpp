@@ -6,6 +6,8 @@
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <limits>
 using namespace std;
 
 namespace pmd2{ namespace stats
@@ -194,4 +196,262 @@ namespace pmd2{ namespace stats
         }
     }
 
+
+//==========================================================================================
+//  PokemonDBColumns
+//==========================================================================================
+    void PokemonDBColumns::Build( const PokemonDB & pdb )
+    {
+        const size_t nbpkmn = pdb.size();
+        if( nbpkmn > std::numeric_limits<uint16_t>::max() )
+            throw runtime_error("PokemonDBColumns::Build(): Too many pokemon in the PokemonDB!");
+
+        m_nbpkmn = nbpkmn;
+        m_pokeID     .resize(nbpkmn);
+        m_natPkdexNb .resize(nbpkmn);
+        m_basePkmn   .resize(nbpkmn);
+        m_preEvoIndex.resize(nbpkmn);
+        m_primaryTy  .resize(nbpkmn);
+        m_secondaryTy.resize(nbpkmn);
+        m_primAbility.resize(nbpkmn);
+        m_secAbility .resize(nbpkmn);
+        m_IQGrp      .resize(nbpkmn);
+        m_expYield   .resize(nbpkmn);
+        m_weight     .resize(nbpkmn);
+        m_baseHP     .resize(nbpkmn);
+        m_baseAtk    .resize(nbpkmn);
+        m_baseSpAtk  .resize(nbpkmn);
+        m_baseDef    .resize(nbpkmn);
+        m_baseSpDef  .resize(nbpkmn);
+        m_hasGrowth  .resize(nbpkmn);
+
+        for( size_t i = 0; i < nbpkmn; ++i )
+        {
+            const PokeMonsterData & md = pdb[i].MonsterDataGender1();
+            m_pokeID[i]      = md.pokeID;
+            m_natPkdexNb[i]  = md.natPkdexNb;
+            m_basePkmn[i]    = md.BasePkmn;
+            m_preEvoIndex[i] = md.evoData.preEvoIndex;
+            m_primaryTy[i]   = md.primaryTy;
+            m_secondaryTy[i] = md.secondaryTy;
+            m_primAbility[i] = md.primAbility;
+            m_secAbility[i]  = md.secAbility;
+            m_IQGrp[i]       = md.IQGrp;
+            m_expYield[i]    = md.expYield;
+            m_weight[i]      = md.weight;
+            m_baseHP[i]      = md.baseHP;
+            m_baseAtk[i]     = md.baseAtk;
+            m_baseSpAtk[i]   = md.baseSpAtk;
+            m_baseDef[i]     = md.baseDef;
+            m_baseSpDef[i]   = md.baseSpDef;
+            m_hasGrowth[i]   = (pdb[i].StatsGrowth().empty())? 0 : 1;
+        }
+
+        BuildStatsGrowth(pdb);
+        for( unsigned int mvset = 0; mvset < NbMoveSets; ++mvset )
+            BuildLearnsets( pdb, mvset );
+    }
+
+    /*
+        Accumulates the stats increases level by level, so looking up the stats at a level is a single read.
+        Levels past the end of a pokemon's growth data keep the last values.
+    */
+    void PokemonDBColumns::BuildStatsGrowth( const PokemonDB & pdb )
+    {
+        const size_t nbvals = m_nbpkmn * PkmnMaxLevel;
+        m_reqExp.assign( nbvals, 0 );
+        m_totHP .assign( nbvals, 0 );
+        m_totAtk.assign( nbvals, 0 );
+        m_totSpA.assign( nbvals, 0 );
+        m_totDef.assign( nbvals, 0 );
+        m_totSpD.assign( nbvals, 0 );
+
+        for( size_t i = 0; i < m_nbpkmn; ++i )
+        {
+            const PokeStatsGrowth & growth = pdb[i].StatsGrowth();
+            uint32_t reqexp = 0;
+            uint32_t hp     = m_baseHP[i];
+            uint32_t atk    = m_baseAtk[i];
+            uint32_t spa    = m_baseSpAtk[i];
+            uint32_t def    = m_baseDef[i];
+            uint32_t spd    = m_baseSpDef[i];
+
+            for( size_t lvlindex = 0; lvlindex < PkmnMaxLevel; ++lvlindex )
+            {
+                if( lvlindex < growth.size() )
+                {
+                    const PokeStats & incr = growth[lvlindex].second;
+                    reqexp = growth[lvlindex].first;
+                    hp    += incr.HP;
+                    atk   += incr.Atk;
+                    spa   += incr.SpA;
+                    def   += incr.Def;
+                    spd   += incr.SpD;
+                }
+                const size_t pos = (lvlindex * m_nbpkmn) + i;
+                m_reqExp[pos] = reqexp;
+                m_totHP [pos] = hp;
+                m_totAtk[pos] = atk;
+                m_totSpA[pos] = spa;
+                m_totDef[pos] = def;
+                m_totSpD[pos] = spd;
+            }
+        }
+    }
+
+    /*
+        Fills the learnsets from one of the 2 movesets, and builds the reverse index for each learn method.
+    */
+    void PokemonDBColumns::BuildLearnsets( const PokemonDB & pdb, unsigned int mvset )
+    {
+        learnsetcols & dest = m_learnsets[mvset];
+        auto lambdaGetMvSet = [&]( size_t i )->const PokeMoveSet &
+        {
+            return (mvset == 0)? pdb[i].MoveSet1() : pdb[i].MoveSet2();
+        };
+
+        //#1 - Count, and allocate
+        csrlist<moveid_t> & lvlup = dest.moves[static_cast<size_t>(eLearnMethod::LevelUp)];
+        csrlist<moveid_t> & hmtm  = dest.moves[static_cast<size_t>(eLearnMethod::HmTm)];
+        csrlist<moveid_t> & egg   = dest.moves[static_cast<size_t>(eLearnMethod::Egg)];
+        for( auto & method : dest.moves )
+            method.offsets.assign( m_nbpkmn + 1, 0 );
+
+        for( size_t i = 0; i < m_nbpkmn; ++i )
+        {
+            const PokeMoveSet & mvs = lambdaGetMvSet(i);
+            lvlup.offsets[i+1] = lvlup.offsets[i] + static_cast<uint32_t>(mvs.lvlUpMoveSet.size());
+            hmtm .offsets[i+1] = hmtm .offsets[i] + static_cast<uint32_t>(mvs.teachableHMTMs.size());
+            egg  .offsets[i+1] = egg  .offsets[i] + static_cast<uint32_t>(mvs.eggmoves.size());
+        }
+
+        //#2 - Copy the moves
+        lvlup.values.resize( lvlup.offsets.back() );
+        hmtm .values.resize( hmtm .offsets.back() );
+        egg  .values.resize( egg  .offsets.back() );
+        dest.lvlupLevels.resize( lvlup.offsets.back() );
+
+        for( size_t i = 0; i < m_nbpkmn; ++i )
+        {
+            const PokeMoveSet & mvs = lambdaGetMvSet(i);
+            size_t lvlpos = lvlup.offsets[i];
+            for( const auto & lvlmv : mvs.lvlUpMoveSet )
+            {
+                dest.lvlupLevels[lvlpos] = lvlmv.first;
+                lvlup.values[lvlpos]     = lvlmv.second;
+                ++lvlpos;
+            }
+            std::copy( mvs.teachableHMTMs.begin(), mvs.teachableHMTMs.end(), hmtm.values.begin() + hmtm.offsets[i] );
+            std::copy( mvs.eggmoves.begin(),       mvs.eggmoves.end(),       egg.values.begin()  + egg.offsets[i] );
+        }
+
+        //#3 - Build the reverse index. Visiting the pokemon in order leaves each move's learner list sorted.
+        for( size_t method = 0; method < dest.moves.size(); ++method )
+        {
+            const csrlist<moveid_t> & fwd = dest.moves[method];
+            csrlist<uint16_t>       & rev = dest.learners[method];
+
+            moveid_t maxmove = 0;
+            for( moveid_t mv : fwd.values )
+                maxmove = std::max( maxmove, mv );
+
+            //A pokemon can learn the same move at several levels, so remove duplicates within each row first
+            vector<moveid_t> uniquemvs;
+            uniquemvs.reserve( fwd.values.size() );
+            vector<uint32_t> uniqueoffsets( m_nbpkmn + 1, 0 );
+            for( size_t i = 0; i < m_nbpkmn; ++i )
+            {
+                const size_t rowbeg = uniquemvs.size();
+                uniquemvs.insert( uniquemvs.end(), fwd.values.begin() + fwd.offsets[i], fwd.values.begin() + fwd.offsets[i+1] );
+                std::sort( uniquemvs.begin() + rowbeg, uniquemvs.end() );
+                uniquemvs.erase( std::unique( uniquemvs.begin() + rowbeg, uniquemvs.end() ), uniquemvs.end() );
+                uniqueoffsets[i+1] = static_cast<uint32_t>(uniquemvs.size());
+            }
+
+            const size_t nbrows = (fwd.values.empty())? 0 : static_cast<size_t>(maxmove) + 1;
+            rev.offsets.assign( nbrows + 1, 0 );
+            for( moveid_t mv : uniquemvs )
+                ++rev.offsets[mv + 1];
+            for( size_t row = 0; row < nbrows; ++row )
+                rev.offsets[row + 1] += rev.offsets[row];
+
+            rev.values.resize( uniquemvs.size() );
+            vector<uint32_t> inspos( rev.offsets.begin(), rev.offsets.end() - 1 );
+            for( size_t i = 0; i < m_nbpkmn; ++i )
+            {
+                for( size_t j = uniqueoffsets[i]; j < uniqueoffsets[i+1]; ++j )
+                    rev.values[ inspos[uniquemvs[j]]++ ] = static_cast<uint16_t>(i);
+            }
+        }
+    }
+
+    ColumnView<uint32_t> PokemonDBColumns::ReqExpAtLevel( unsigned int level )const
+    {
+        if( level < CPokemon::MinLevel || level > PkmnMaxLevel )
+            throw out_of_range("PokemonDBColumns::ReqExpAtLevel(): Level out of range!");
+        const uint32_t * beg = m_reqExp.data() + ((level - 1) * m_nbpkmn);
+        return ColumnView<uint32_t>( beg, beg + m_nbpkmn );
+    }
+
+    PokemonDBColumns::levelstatscols PokemonDBColumns::StatsAtLevel( unsigned int level )const
+    {
+        if( level < CPokemon::MinLevel || level > PkmnMaxLevel )
+            throw out_of_range("PokemonDBColumns::StatsAtLevel(): Level out of range!");
+        const size_t   rowbeg = (level - 1) * m_nbpkmn;
+        levelstatscols cols;
+        cols.HP  = ColumnView<uint32_t>( m_totHP .data() + rowbeg, m_totHP .data() + rowbeg + m_nbpkmn );
+        cols.Atk = ColumnView<uint32_t>( m_totAtk.data() + rowbeg, m_totAtk.data() + rowbeg + m_nbpkmn );
+        cols.SpA = ColumnView<uint32_t>( m_totSpA.data() + rowbeg, m_totSpA.data() + rowbeg + m_nbpkmn );
+        cols.Def = ColumnView<uint32_t>( m_totDef.data() + rowbeg, m_totDef.data() + rowbeg + m_nbpkmn );
+        cols.SpD = ColumnView<uint32_t>( m_totSpD.data() + rowbeg, m_totSpD.data() + rowbeg + m_nbpkmn );
+        return cols;
+    }
+
+    PokemonDBColumns::levelstats PokemonDBColumns::StatsAtLevel( size_t pkindex, unsigned int level )const
+    {
+        if( level < CPokemon::MinLevel || level > PkmnMaxLevel )
+            throw out_of_range("PokemonDBColumns::StatsAtLevel(): Level out of range!");
+        if( pkindex >= m_nbpkmn )
+            throw out_of_range("PokemonDBColumns::StatsAtLevel(): Pokemon index out of range!");
+        const size_t pos = ((level - 1) * m_nbpkmn) + pkindex;
+        levelstats stats;
+        stats.HP  = m_totHP [pos];
+        stats.Atk = m_totAtk[pos];
+        stats.SpA = m_totSpA[pos];
+        stats.Def = m_totDef[pos];
+        stats.SpD = m_totSpD[pos];
+        return stats;
+    }
+
+    ColumnView<moveid_t> PokemonDBColumns::Moves( size_t pkindex, eLearnMethod method, unsigned int mvset )const
+    {
+        if( mvset >= NbMoveSets || method >= eLearnMethod::NbMethods )
+            throw out_of_range("PokemonDBColumns::Moves(): Invalid moveset or learn method!");
+        return m_learnsets[mvset].moves[static_cast<size_t>(method)].Row(pkindex);
+    }
+
+    ColumnView<level_t> PokemonDBColumns::LevelUpMoveLevels( size_t pkindex, unsigned int mvset )const
+    {
+        if( mvset >= NbMoveSets )
+            throw out_of_range("PokemonDBColumns::LevelUpMoveLevels(): Invalid moveset!");
+        const learnsetcols & ls      = m_learnsets[mvset];
+        const auto         & offsets = ls.moves[static_cast<size_t>(eLearnMethod::LevelUp)].offsets;
+        if( pkindex + 1 >= offsets.size() )
+            return ColumnView<level_t>();
+        return ColumnView<level_t>( ls.lvlupLevels.data() + offsets[pkindex], ls.lvlupLevels.data() + offsets[pkindex+1] );
+    }
+
+    ColumnView<uint16_t> PokemonDBColumns::Learners( moveid_t move, eLearnMethod method, unsigned int mvset )const
+    {
+        if( mvset >= NbMoveSets || method >= eLearnMethod::NbMethods )
+            throw out_of_range("PokemonDBColumns::Learners(): Invalid moveset or learn method!");
+        return m_learnsets[mvset].learners[static_cast<size_t>(method)].Row(move);
+    }
+
+    bool PokemonDBColumns::LearnsMove( size_t pkindex, moveid_t move, eLearnMethod method, unsigned int mvset )const
+    {
+        ColumnView<uint16_t> learners = Learners( move, method, mvset );
+        return std::binary_search( learners.begin(), learners.end(), pkindex );
+    }
+
 };};
\ No newline at end of file
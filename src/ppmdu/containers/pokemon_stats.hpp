@@ -445,6 +445,223 @@ namespace pmd2 { namespace stats
     };
 
 
+    /*************************************************************************************
+        ColumnView
+            A read-only range over a contiguous part of one of the PokemonDBColumns arrays.
+            Only valid as long as the PokemonDBColumns object it came from is.
+    *************************************************************************************/
+    template<class T>
+        class ColumnView
+    {
+    public:
+        typedef const T * const_iterator;
+
+        ColumnView()
+            :m_beg(nullptr), m_end(nullptr)
+        {}
+
+        ColumnView( const T * beg, const T * end )
+            :m_beg(beg), m_end(end)
+        {}
+
+        inline const_iterator begin()const                  { return m_beg; }
+        inline const_iterator end  ()const                  { return m_end; }
+        inline std::size_t    size ()const                  { return static_cast<std::size_t>(m_end - m_beg); }
+        inline bool           empty()const                  { return m_beg == m_end; }
+        inline const T &      operator[]( size_t index )const { return m_beg[index]; }
+
+    private:
+        const T * m_beg;
+        const T * m_end;
+    };
+
+    /*************************************************************************************
+        PokemonDBColumns
+            A read-only copy of a PokemonDB's data, laid out for queries over all pokemon at once,
+            like getting the stats of every pokemon at a given level, or finding which pokemon
+            learn a given move.
+
+            Each field is stored in its own array, indexed by the pokemon's index in the PokemonDB.
+            The stats growth is stored level by level, so the values for all pokemon at a single
+            level are next to each other.
+
+            Learnsets are stored as one array of moves for all pokemon, with an array of offsets
+            where pokemon i's moves are [offsets[i], offsets[i+1]). The reverse index from a move
+            to the pokemon that learn it is stored the same way.
+
+            The object must be rebuilt if the PokemonDB it was built from is modified.
+    *************************************************************************************/
+    class PokemonDBColumns
+    {
+    public:
+        enum struct eLearnMethod : unsigned int
+        {
+            LevelUp = 0,
+            HmTm,
+            Egg,
+            NbMethods,
+        };
+
+        static const unsigned int NbMoveSets = 2;   //waza_p.bin and waza_p2.bin
+
+        /*
+            Total stats for a single pokemon at a given level.
+        */
+        struct levelstats
+        {
+            uint32_t HP  = 0;
+            uint32_t Atk = 0;
+            uint32_t SpA = 0;
+            uint32_t Def = 0;
+            uint32_t SpD = 0;
+        };
+
+        /*
+            The total stats of every pokemon at a single level. Indexed by pokemon index.
+        */
+        struct levelstatscols
+        {
+            ColumnView<uint32_t> HP;
+            ColumnView<uint32_t> Atk;
+            ColumnView<uint32_t> SpA;
+            ColumnView<uint32_t> Def;
+            ColumnView<uint32_t> SpD;
+        };
+
+    public:
+        PokemonDBColumns()
+            :m_nbpkmn(0)
+        {}
+
+        explicit PokemonDBColumns( const PokemonDB & pdb )
+            :m_nbpkmn(0)
+        {
+            Build(pdb);
+        }
+
+        /*
+            Replaces the current content with a copy of the data from the PokemonDB.
+        */
+        void Build( const PokemonDB & pdb );
+
+        inline std::size_t size()const  { return m_nbpkmn; }
+        inline bool        empty()const { return m_nbpkmn == 0; }
+
+        //Fields from the first gender's monster.md entry. Indexed by pokemon index.
+        inline ColumnView<uint16_t> PokeIDs()       const { return MakeView(m_pokeID);      }
+        inline ColumnView<uint16_t> NatPkdexNbs()   const { return MakeView(m_natPkdexNb);  }
+        inline ColumnView<uint16_t> BasePkmn()      const { return MakeView(m_basePkmn);    }
+        inline ColumnView<uint16_t> PreEvoIndices() const { return MakeView(m_preEvoIndex); }
+        inline ColumnView<uint8_t>  PrimaryTypes()  const { return MakeView(m_primaryTy);   }
+        inline ColumnView<uint8_t>  SecondaryTypes()const { return MakeView(m_secondaryTy); }
+        inline ColumnView<uint8_t>  PrimAbilities() const { return MakeView(m_primAbility); }
+        inline ColumnView<uint8_t>  SecAbilities()  const { return MakeView(m_secAbility);  }
+        inline ColumnView<uint8_t>  IQGrps()        const { return MakeView(m_IQGrp);       }
+        inline ColumnView<uint16_t> ExpYields()     const { return MakeView(m_expYield);    }
+        inline ColumnView<uint16_t> Weights()       const { return MakeView(m_weight);      }
+        inline ColumnView<uint16_t> BaseHP()        const { return MakeView(m_baseHP);      }
+        inline ColumnView<uint8_t>  BaseAtk()       const { return MakeView(m_baseAtk);     }
+        inline ColumnView<uint8_t>  BaseSpAtk()     const { return MakeView(m_baseSpAtk);   }
+        inline ColumnView<uint8_t>  BaseDef()       const { return MakeView(m_baseDef);     }
+        inline ColumnView<uint8_t>  BaseSpDef()     const { return MakeView(m_baseSpDef);   }
+
+        //Whether the pokemon has stats growth data. Pokemon without any have their base stats at every level.
+        inline bool HasStatsGrowth( size_t pkindex )const { return m_hasGrowth[pkindex] != 0; }
+
+        /*
+            The experience required by every pokemon to reach the level. Level is 1 to 100.
+        */
+        ColumnView<uint32_t> ReqExpAtLevel( unsigned int level )const;
+
+        /*
+            The total stats of every pokemon at the level, which is the base stats plus all the
+            stats increases up to and including that level. Level is 1 to 100.
+        */
+        levelstatscols       StatsAtLevel( unsigned int level )const;
+        levelstats           StatsAtLevel( size_t pkindex, unsigned int level )const;
+
+        /*
+            The moves the pokemon learns with the method, from the specified moveset(0 or 1).
+            Level-up moves are sorted by level, in the same order as LevelUpMoveLevels.
+            The others are in the order from the moveset.
+        */
+        ColumnView<moveid_t> Moves( size_t pkindex, eLearnMethod method, unsigned int mvset = 0 )const;
+        ColumnView<level_t>  LevelUpMoveLevels( size_t pkindex, unsigned int mvset = 0 )const;
+
+        /*
+            The indices of the pokemon that learn the move with the method, from the specified moveset,
+            in increasing order, and without duplicates.
+        */
+        ColumnView<uint16_t> Learners( moveid_t move, eLearnMethod method, unsigned int mvset = 0 )const;
+        bool                 LearnsMove( size_t pkindex, moveid_t move, eLearnMethod method, unsigned int mvset = 0 )const;
+
+    private:
+        /*
+            An adjacency list. Row i's values are [offsets[i], offsets[i+1]).
+        */
+        template<class T>
+            struct csrlist
+        {
+            std::vector<uint32_t> offsets;
+            std::vector<T>        values;
+
+            inline ColumnView<T> Row( size_t row )const
+            {
+                if( row + 1 >= offsets.size() )
+                    return ColumnView<T>();
+                return ColumnView<T>( values.data() + offsets[row], values.data() + offsets[row+1] );
+            }
+        };
+
+        struct learnsetcols
+        {
+            std::array<csrlist<moveid_t>, static_cast<size_t>(eLearnMethod::NbMethods)> moves;     //Indexed by pokemon index
+            std::array<csrlist<uint16_t>, static_cast<size_t>(eLearnMethod::NbMethods)> learners;  //Indexed by move id
+            std::vector<level_t>                                                         lvlupLevels; //Parallel to moves[LevelUp].values
+        };
+
+        template<class T>
+            static inline ColumnView<T> MakeView( const std::vector<T> & col )
+        {
+            return ColumnView<T>( col.data(), col.data() + col.size() );
+        }
+
+        void BuildLearnsets( const PokemonDB & pdb, unsigned int mvset );
+        void BuildStatsGrowth( const PokemonDB & pdb );
+
+    private:
+        size_t                m_nbpkmn;
+
+        std::vector<uint16_t> m_pokeID;
+        std::vector<uint16_t> m_natPkdexNb;
+        std::vector<uint16_t> m_basePkmn;
+        std::vector<uint16_t> m_preEvoIndex;
+        std::vector<uint8_t>  m_primaryTy;
+        std::vector<uint8_t>  m_secondaryTy;
+        std::vector<uint8_t>  m_primAbility;
+        std::vector<uint8_t>  m_secAbility;
+        std::vector<uint8_t>  m_IQGrp;
+        std::vector<uint16_t> m_expYield;
+        std::vector<uint16_t> m_weight;
+        std::vector<uint16_t> m_baseHP;
+        std::vector<uint8_t>  m_baseAtk;
+        std::vector<uint8_t>  m_baseSpAtk;
+        std::vector<uint8_t>  m_baseDef;
+        std::vector<uint8_t>  m_baseSpDef;
+        std::vector<uint8_t>  m_hasGrowth;
+
+        //Level major: the value for pokemon i at level l is at ((l-1) * m_nbpkmn) + i
+        std::vector<uint32_t> m_reqExp;
+        std::vector<uint32_t> m_totHP;
+        std::vector<uint32_t> m_totAtk;
+        std::vector<uint32_t> m_totSpA;
+        std::vector<uint32_t> m_totDef;
+        std::vector<uint32_t> m_totSpD;
+
+        std::array<learnsetcols, NbMoveSets> m_learnsets;
+    };
+
+
 //======================================================================================================
 //  Functions
 //======================================================================================================
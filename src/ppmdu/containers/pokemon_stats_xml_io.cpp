@@ -5,6 +5,7 @@
 #include "pokemon_stats.hpp"
 #include <utils/parse_utils.hpp>
 #include <utils/pugixml_utils.hpp>
+#include <utils/parallel_tasks.hpp>
 #include <pugixml.hpp>
 #include <sstream>
 #include <iostream>
@@ -12,6 +13,9 @@
 #include <fstream>
 #include <memory>
 #include <functional>
+#include <algorithm>
+#include <tuple>
+#include <exception>
 #include <Poco/DirectoryIterator.h>
 #include <Poco/File.h>
 #include <Poco/Path.h>
@@ -191,40 +195,40 @@ namespace pmd2 {namespace stats
             return out_fname;
         }
 
+        /*
+            Every Pokemon goes into its own document, so they're built and saved over several threads.
+            Each chunk works on a copy of the writer, as the conversion buffers can't be shared.
+        */
         void WriteAllEntries( const string & outdir )
         {
-            using namespace pkmnXML;
-            stringstream sstrfname;
             const string outpathpre = utils::TryAppendSlash(outdir);
 
-            for( unsigned int cntpkmn = 0; cntpkmn < m_src.size(); ++cntpkmn )
+            utils::RunChunked( 0, m_src.size(), NbEntriesPerChunk, [this,&outpathpre]( size_t chunkbeg, size_t chunkend )
             {
-                sstrfname.str(string());
-                MakeFilename(sstrfname, outpathpre, cntpkmn);
-                //if( !m_bNoStrings )
-                //{
-                //    const string * pfstr = m_pgametext->begin()->second.GetStringInBlock( eStringBlocks::PkmnNames, cntpkmn );
-                //    if( pfstr )
-                //        sstrfname <<outpathpre <<setw(4) <<setfill('0') <<cntpkmn <<"_" <<PreparePokeNameFName(*pfstr, m_pgametext->begin()->first) <<".xml";
-                //    else
-                //        sstrfname <<outpathpre <<setw(4) <<setfill('0') <<cntpkmn <<".xml";
-                //}
-                //else
-                //    sstrfname <<outpathpre <<setw(4) <<setfill('0') <<cntpkmn <<".xml";
-
-                xml_document doc;
-                xml_node     pknode = doc.append_child( ROOT_Pkmn.c_str() );
-
-                if( m_src.isEoSData() )
-                    AppendAttribute( pknode, ATTR_GameVer, GameVersion_EoS );
-                else
-                    AppendAttribute( pknode, ATTR_GameVer, GameVersion_EoTD );
+                PokemonDB_XMLWriter chunkwriter(*this);
+                for( size_t cntpkmn = chunkbeg; cntpkmn < chunkend; ++cntpkmn )
+                    chunkwriter.WriteEntry( outpathpre, static_cast<unsigned int>(cntpkmn) );
+            });
+        }
 
-                WriteAPokemon( m_src[cntpkmn], pknode, cntpkmn );
+        void WriteEntry( const string & outpathpre, unsigned int cntpkmn )
+        {
+            using namespace pkmnXML;
+            stringstream sstrfname;
+            MakeFilename(sstrfname, outpathpre, cntpkmn);
 
-                if( ! doc.save_file( sstrfname.str().c_str() ) )
-                    throw std::runtime_error("Can't write xml file " + sstrfname.str());
-            }
+            xml_document doc;
+            xml_node     pknode = doc.append_child( ROOT_Pkmn.c_str() );
+
+            if( m_src.isEoSData() )
+                AppendAttribute( pknode, ATTR_GameVer, GameVersion_EoS );
+            else
+                AppendAttribute( pknode, ATTR_GameVer, GameVersion_EoTD );
+
+            WriteAPokemon( m_src[cntpkmn], pknode, cntpkmn );
+
+            if( ! doc.save_file( sstrfname.str().c_str() ) )
+                throw std::runtime_error("Can't write xml file " + sstrfname.str());
         }
 
         void WriteAPokemon( const CPokemon & pkmn, xml_node & pknode, unsigned int pkindex )
@@ -413,6 +417,7 @@ namespace pmd2 {namespace stats
     private:
         //Length of the conversion buffer
         static const int                          CBuffSZ = (sizeof(int)*8+1);
+        static const size_t                       NbEntriesPerChunk = 4;
 
         const PokemonDB                         & m_src;
         const GameText                          * m_pgametext;
@@ -435,6 +440,22 @@ namespace pmd2 {namespace stats
     {
         //Lets hide that ginormous type plz
         typedef std::pair<std::vector<std::string>::iterator,std::vector<std::string>::iterator> strbounds_t;
+
+        //A string read from a file, to be written to the GameText once the pokemon's index is known. (language, string block, string)
+        typedef std::tuple<eGameLanguages, eStringBlocks, std::string> pendingstr_t;
+
+        //What was read from a single Pokemon XML file
+        struct pkmnfileentry
+        {
+            pkmnfileentry()
+                :bhasdata(false), bisEoS(false)
+            {}
+            bool                 bhasdata;
+            bool                 bisEoS;
+            CPokemon             pkmn;
+            vector<pendingstr_t> strings;
+            std::exception_ptr   perror;
+        };
     public:
 
         /*
@@ -456,7 +477,7 @@ namespace pmd2 {namespace stats
         /*
         */
         PokemonDB_XMLParser( PokemonDB & out_pkdb, GameText  * inout_gtext )
-            :m_out(out_pkdb), m_isEoS(false), m_pgametext(inout_gtext), m_bParsePokemonId(false)
+            :m_out(out_pkdb), m_isEoS(false), m_pgametext(inout_gtext), m_bNoStrings(false), m_bParsePokemonId(false)
         {
         }
         
@@ -522,35 +543,45 @@ namespace pmd2 {namespace stats
             if( filelst.empty() )
                 throw std::runtime_error( "PokemonDB_XMLParser::ReadAllPokemon(): Couldn't find any xml files under the path \"" + srcdir + "\"!" );
 
+            //The directory order isn't the same on every platforms, and the file names begin with the pokemon's index
+            std::sort( filelst.begin(), filelst.end() );
+
+            //Each thread loads and reads a single file at a time. Errors are kept until everything is put together.
+            vector<pkmnfileentry> entries(filelst.size());
+            utils::parallel_for( 0, filelst.size(), 1, [&]( size_t cntfile )
+            {
+                try
+                {
+                    ReadPokemonFile( filelst[cntfile], static_cast<uint32_t>(cntfile), entries[cntfile] );
+                }
+                catch(...)
+                {
+                    entries[cntfile].perror = std::current_exception();
+                }
+            });
+
+            //Put everything together in file order, so the result doesn't depend on which thread finished first
             vector<CPokemon> result;
             result.reserve(filelst.size());
 
             uint32_t cntEoSPk = 0;
             uint32_t cntPkmn  = 0;
-            for( auto & pkmn : filelst )
+            for( auto & entry : entries )
             {
-                uint32_t         pkid = GetCurrentPokemonID(pkmn,cntPkmn);
-                xml_document     doc;
-                xml_parse_result loadres = doc.load_file(pkmn.c_str());
-                if( ! loadres )
-                {
-                    stringstream sstr;
-                    sstr <<"Can't load XML document \"" <<pkmn <<"\"! Pugixml returned an error : \"" << loadres.description() <<"\"";
-                    throw std::runtime_error(sstr.str());
-                }
+                if( entry.perror )
+                    std::rethrow_exception(entry.perror);
 
-                bool     hadEoSAttribute = false;
-                xml_node rootnode        = doc.child(ROOT_Pkmn.c_str());
-                if( rootnode )
-                    result.push_back( ReadPokemon( rootnode, cntPkmn, hadEoSAttribute ) );
-                else
+                if( !entry.bhasdata )
                 {
                     clog << "<!>- PokemonDB_XMLParser::ReadAllPokemon(): Skipping XML file with no pokemon data..\n";
                     continue;
                 }
 
+                WriteStrings( entry.strings, cntPkmn );
+                result.push_back( std::move(entry.pkmn) );
+
                 //Count EoS pokes
-                if( hadEoSAttribute )
+                if( entry.bisEoS )
                     ++cntEoSPk;
 
                 ++cntPkmn;
@@ -570,6 +601,43 @@ namespace pmd2 {namespace stats
             return std::move(result);
         }
 
+        /*
+            Runs on a worker thread. Must not touch anything shared besides reading from the GameText.
+        */
+        void ReadPokemonFile( const string & fpath, uint32_t cntfile, pkmnfileentry & out_entry )
+        {
+            using namespace pkmnXML;
+            xml_document     doc;
+            xml_parse_result loadres = doc.load_file(fpath.c_str());
+            if( ! loadres )
+            {
+                stringstream sstr;
+                sstr <<"Can't load XML document \"" <<fpath <<"\"! Pugixml returned an error : \"" << loadres.description() <<"\"";
+                throw std::runtime_error(sstr.str());
+            }
+
+            xml_node rootnode = doc.child(ROOT_Pkmn.c_str());
+            if( !rootnode )
+                return;
+            out_entry.pkmn     = ReadPokemon( rootnode, cntfile, out_entry.bisEoS, out_entry.strings );
+            out_entry.bhasdata = true;
+        }
+
+        /*
+            Writes the strings read from a Pokemon's file, now that we know its index.
+        */
+        void WriteStrings( const vector<pendingstr_t> & strs, uint32_t cntpkmn )
+        {
+            for( const auto & pending : strs )
+            {
+                const eStringBlocks blk  = std::get<1>(pending);
+                string            * pstr = m_pgametext->GetStrings(std::get<0>(pending))->second.GetStringIfBlockExists( blk, cntpkmn );
+                if(!pstr)
+                    throw std::runtime_error("PokemonDB_XMLParser::WriteStrings(): Couldn't access the " + StringBlocksNames[static_cast<unsigned int>(blk)] + " string block!");
+                *(pstr) = std::get<2>(pending);
+            }
+        }
+
         ////Get pokemon name string reference
         //std::string & GetStringRefPkmn( uint32_t index )
         //{
@@ -598,7 +666,7 @@ namespace pmd2 {namespace stats
         //    }
         //}
 
-        CPokemon ReadPokemon( xml_node & pknode, uint32_t cntpokemon, bool & isEoS )
+        CPokemon ReadPokemon( xml_node & pknode, uint32_t cntpokemon, bool & isEoS, vector<pendingstr_t> & out_strings )
         {
             using namespace pkmnXML;
             //CPokemon curpoke;
@@ -641,7 +709,7 @@ namespace pmd2 {namespace stats
             {
                 if( !m_bNoStrings && curnode.name() == NODE_Strings )
                 {
-                    ReadStrings(curnode,cntpokemon);
+                    ReadStrings(curnode,out_strings);
                 }
                 else if( curnode.name() == NODE_SGrowth )
                 {
@@ -687,7 +755,7 @@ namespace pmd2 {namespace stats
                 return CPokemon( move(gen1), move(sg), move(mvset1), move(mvset2) );
         }
 
-        void ReadStrings( xml_node & strnode, uint32_t cntpkmn )
+        void ReadStrings( xml_node & strnode, vector<pendingstr_t> & out_strings )
         {
             using namespace pkmnXML;
             for( auto & curnode : strnode.children() )
@@ -696,18 +764,18 @@ namespace pmd2 {namespace stats
                 if( glang != eGameLanguages::Invalid )
                 {
                     //Parse multi-language strings
-                    ReadLangStrings(curnode, glang, cntpkmn);
+                    ReadLangStrings(curnode, glang, out_strings);
                 }
                 else
                 {
                     //If the game isn't multi-lingual, just parse the strings for english
                     clog<<"<!>- PokemonDB_XMLParser::ReadStrings() : Found a non language named node!\n";
-                    ReadLangStrings(curnode, eGameLanguages::english, cntpkmn);
+                    ReadLangStrings(curnode, eGameLanguages::english, out_strings);
                 }
             }
         }
 
-        void ReadLangStrings( xml_node & langnode, eGameLanguages lang, uint32_t cntpkmn )
+        void ReadLangStrings( xml_node & langnode, eGameLanguages lang, vector<pendingstr_t> & out_strings )
         {
             auto langstr = m_pgametext->GetStrings(lang);
             if( langstr == m_pgametext->end() )
@@ -720,23 +788,9 @@ namespace pmd2 {namespace stats
             for( auto & curnode : langnode.children() )
             {
                 if( curnode.name() == PROP_Name )
-                {
-                    string pkname = curnode.child_value();
-                    pkname += "\\0"; //put back the \0
-                    string * pstr = langstr->second.GetStringIfBlockExists( eStringBlocks::PkmnNames, cntpkmn );
-                    if(!pstr)
-                        throw std::runtime_error("PokemonDB_XMLParser::ReadLangStrings(): Couldn't access the pokemon name string block!");
-                    *(pstr) = pkname;
-                }
+                    out_strings.emplace_back( lang, eStringBlocks::PkmnNames, string(curnode.child_value()) + "\\0" ); //put back the \0
                 else if( curnode.name() == PROP_Category )
-                {
-                    string pkcat = curnode.child_value();
-                    pkcat += "\\0"; //put back the \0
-                    string * pstr = langstr->second.GetStringIfBlockExists( eStringBlocks::PkmnCats, cntpkmn );
-                    if(!pstr)
-                        throw std::runtime_error("PokemonDB_XMLParser::ReadLangStrings(): Couldn't access the pokemon category name string block!");
-                    *(pstr) = pkcat;
-                }
+                    out_strings.emplace_back( lang, eStringBlocks::PkmnCats,  string(curnode.child_value()) + "\\0" ); //put back the \0
             }
         }
 
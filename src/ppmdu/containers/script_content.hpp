@@ -14,6 +14,8 @@ psycommando@gmail.com
 #include <unordered_map>
 #include <vector>
 #include <deque>
+#include <algorithm>
+#include <stdexcept>
 
 namespace pmd2
 {
@@ -80,6 +82,164 @@ namespace pmd2
 //==========================================================================================================
 //  Script Instructions
 //==========================================================================================================
+    /***********************************************************************************************
+        ScriptInstrParams
+            Compact container for the parameters of a single instruction.
+
+            Nearly all commands take only a handful of parameters, so up to "NbInline" of them
+            are stored directly inside the instruction. Only the few variable length commands
+            going over that allocate a buffer on the heap. This keeps the instructions of a 
+            routine contiguous in memory, and avoids one allocation per instruction when 
+            loading a script.
+
+            Implements the subset of the std::vector interface the script compiler, 
+            decompiler, and xml I/O use.
+    ***********************************************************************************************/
+    class ScriptInstrParams
+    {
+    public:
+        typedef uint16_t        value_type;
+        typedef size_t          size_type;
+        typedef uint16_t      & reference;
+        typedef const uint16_t& const_reference;
+        typedef uint16_t      * iterator;
+        typedef const uint16_t* const_iterator;
+
+        static const uint16_t NbInline = 8;     //Nb of parameters that fit without a heap allocation
+        static const uint16_t MaxSize  = 0xFFFF;//Parameter counts are stored in a single script word
+
+        ScriptInstrParams()noexcept
+            :m_size(0), m_cap(NbInline)
+        {}
+
+        ScriptInstrParams(const ScriptInstrParams & cp)
+            :m_size(0), m_cap(NbInline)
+        {
+            assign(cp.begin(), cp.end());
+        }
+
+        ScriptInstrParams(ScriptInstrParams && mv)noexcept
+            :m_size(0), m_cap(NbInline)
+        {
+            Steal(mv);
+        }
+
+        ~ScriptInstrParams()
+        {
+            if(IsOnHeap())
+                delete[] m_heap;
+        }
+
+        ScriptInstrParams & operator=(const ScriptInstrParams & cp)
+        {
+            if(this != &cp)
+                assign(cp.begin(), cp.end());
+            return *this;
+        }
+
+        ScriptInstrParams & operator=(ScriptInstrParams && mv)noexcept
+        {
+            if(this != &mv)
+            {
+                if(IsOnHeap())
+                    delete[] m_heap;
+                m_cap = NbInline;
+                Steal(mv);
+            }
+            return *this;
+        }
+
+        void assign(const_iterator itbeg, const_iterator itend)
+        {
+            const size_t cnt = static_cast<size_t>(itend - itbeg);
+            m_size = 0;
+            reserve(cnt);
+            std::copy(itbeg, itend, data());
+            m_size = static_cast<uint16_t>(cnt);
+        }
+
+        inline void push_back(uint16_t val)
+        {
+            if(m_size == m_cap)
+                Grow( (m_cap > (MaxSize / 2))? MaxSize : (m_cap * 2) );
+            data()[m_size++] = val;
+        }
+
+        inline void pop_back()      { --m_size; }
+        inline void clear()         { m_size = 0; }
+
+        void reserve(size_t cnt)
+        {
+            if(cnt > m_cap)
+                Grow(cnt);
+        }
+
+        inline size_t          size    ()const { return m_size; }
+        inline bool            empty   ()const { return m_size == 0; }
+        inline size_t          capacity()const { return m_cap; }
+
+        inline uint16_t       * data()         { return IsOnHeap()? m_heap : m_inline; }
+        inline const uint16_t * data()const    { return IsOnHeap()? m_heap : m_inline; }
+
+        inline iterator         begin()        { return data(); }
+        inline const_iterator   begin()const   { return data(); }
+        inline iterator         end  ()        { return data() + m_size; }
+        inline const_iterator   end  ()const   { return data() + m_size; }
+
+        inline uint16_t       & operator[](size_t idx)       { return data()[idx]; }
+        inline const uint16_t & operator[](size_t idx)const  { return data()[idx]; }
+
+        inline uint16_t       & front()        { return data()[0]; }
+        inline const uint16_t & front()const   { return data()[0]; }
+        inline uint16_t       & back ()        { return data()[m_size - 1]; }
+        inline const uint16_t & back ()const   { return data()[m_size - 1]; }
+
+        inline bool operator==(const ScriptInstrParams & other)const
+        {
+            return m_size == other.m_size && std::equal(begin(), end(), other.begin());
+        }
+        inline bool operator!=(const ScriptInstrParams & other)const { return !operator==(other); }
+
+    private:
+        inline bool IsOnHeap()const { return m_cap > NbInline; }
+
+        void Grow(size_t newcap)
+        {
+            if(newcap > MaxSize || newcap <= m_size)
+                throw std::length_error("ScriptInstrParams::Grow(): Instruction has too many parameters!");
+            uint16_t * pnew = new uint16_t[newcap];
+            std::copy_n(data(), m_size, pnew);
+            if(IsOnHeap())
+                delete[] m_heap;
+            m_heap = pnew;
+            m_cap  = static_cast<uint16_t>(newcap);
+        }
+
+        //Expects this object to not own a heap buffer
+        inline void Steal(ScriptInstrParams & mv)noexcept
+        {
+            if(mv.IsOnHeap())
+            {
+                m_heap     = mv.m_heap;
+                m_cap      = mv.m_cap;
+                mv.m_cap   = NbInline;
+            }
+            else
+                std::copy_n(mv.m_inline, mv.m_size, m_inline);
+            m_size    = mv.m_size;
+            mv.m_size = 0;
+        }
+
+    private:
+        union
+        {
+            uint16_t   m_inline[NbInline];
+            uint16_t * m_heap;
+        };
+        uint16_t m_size;
+        uint16_t m_cap;
+    };
+
     //! #TODO: Make this a single class, and get rid of inheritance. We could just make a wrapper around the instruction that contains both and instruction and a list of sub instruction, to remedy the problem.
     /***********************************************************************************************
         ScriptInstruction
@@ -90,7 +250,7 @@ namespace pmd2
     ***********************************************************************************************/
     struct ScriptBaseInstruction
     {
-        typedef std::deque<uint16_t>          paramcnt_t;
+        typedef ScriptInstrParams             paramcnt_t;
         uint16_t            value;          //Depends on the value of "type". Can be opcode, data, or ID.
         paramcnt_t          parameters;     //The parameters for the instruction
         eInstructionType    type;           //How to handle the instruction
@@ -99,7 +259,7 @@ namespace pmd2
     struct ScriptInstruction : public ScriptBaseInstruction
     {
         //typedef std::deque<uint16_t>             paramcnt_t;
-        typedef std::deque<ScriptBaseInstruction> subinst_t;
+        typedef std::vector<ScriptBaseInstruction> subinst_t;
         //uint16_t            value;          //Depends on the value of "type". Can be opcode, data, or ID.
         //paramcnt_t          parameters;     //The parameters for the instruction
         //eInstructionType    type;           //How to handle the instruction
@@ -108,13 +268,13 @@ namespace pmd2
         ScriptInstruction():ScriptBaseInstruction::ScriptBaseInstruction()
         {}
 
-        ScriptInstruction(ScriptInstruction && mv)
+        ScriptInstruction(ScriptInstruction && mv)noexcept
         {this->operator=(std::forward<ScriptInstruction>(mv));}
 
         ScriptInstruction(const ScriptInstruction & cp)
         {this->operator=(cp);}
 
-        ScriptInstruction(ScriptBaseInstruction && mv)
+        ScriptInstruction(ScriptBaseInstruction && mv)noexcept
         {this->operator=(std::forward<ScriptBaseInstruction>(mv));}
 
         ScriptInstruction(const ScriptBaseInstruction & cp)
@@ -130,7 +290,7 @@ namespace pmd2
             return *this;
         }
 
-        ScriptInstruction & operator=(ScriptInstruction && mv)
+        ScriptInstruction & operator=(ScriptInstruction && mv)noexcept
         {
             subinst     = std::move(mv.subinst);
             type        = mv.type;
@@ -149,7 +309,7 @@ namespace pmd2
             return *this;
         }
 
-        ScriptInstruction & operator=(ScriptBaseInstruction && mv)
+        ScriptInstruction & operator=(ScriptBaseInstruction && mv)noexcept
         {
             type        = mv.type;
             parameters  = std::move(mv.parameters);
@@ -180,7 +340,7 @@ namespace pmd2
     ***********************************************************************************************/
     struct ScriptRoutine
     {
-        typedef std::deque<ScriptInstruction>   cnt_t;
+        typedef std::vector<ScriptInstruction>  cnt_t;
         typedef cnt_t::iterator                 iterator;
         typedef cnt_t::const_iterator           const_iterator;
 
@@ -214,7 +374,7 @@ namespace pmd2
         static const size_t                                     NbLang = static_cast<size_t>(eGameLanguages::NbLang);
         typedef std::vector<std::string>                        strtbl_t;
         typedef std::vector<std::string>                        consttbl_t;
-        typedef std::deque<ScriptRoutine>                       grptbl_t;
+        typedef std::vector<ScriptRoutine>                      grptbl_t;
         typedef std::unordered_map<eGameLanguages, strtbl_t>    strtblset_t;
 
         Script(){}
@@ -2,6 +2,9 @@
 #include <ppmdu/fmts/bpc_compression.hpp>
 #include <types/contentid_generator.hpp>
 #include <cassert>
+#include <unordered_map>
+#include <iomanip>
+#include <limits>
 using namespace std;
 
 namespace filetypes
@@ -77,11 +80,6 @@ namespace filetypes
             std::vector<uint8_t> decout4bppbuff;
             auto itbackins = back_inserter(decout4bppbuff);//tset.Tiles());
 
-            //
-            //First, put 16 bytes of zeros since the first tile is always empty
-            //
-            //std::fill_n(itbackins,64,0);
-
             //
             //Decompress the image
             //
@@ -90,13 +88,13 @@ namespace filetypes
             //
             //Move the decompressed data to our tiles
             //
+            //The first tile is always empty, and isn't stored in the file. Insert it, so the tile mapping table's indices can be used as-is.
             size_t nbtiles = (decout4bppbuff.size() % NbBytesPerTilesRaw != 0)? 1 : 0;
             nbtiles += (decout4bppbuff.size() / NbBytesPerTilesRaw);
-            layer.Tiles().resize(nbtiles);
-            //layer.Tiles().resize(nbtiles + 1);
-            //layer.Tiles().front().resize(NbPixelsPerTile); //Resize the first empty tile
+            layer.Tiles().resize(nbtiles + 1);
+            layer.Tiles().front().resize(NbPixelsPerTile); //Resize the first empty tile
 
-            size_t cntdestpixel = 0; //NbPixelsPerTile; //Start placing pixels after the first empty tile!
+            size_t cntdestpixel = NbPixelsPerTile; //Start placing pixels after the first empty tile!
             for( size_t cntpixel = 0; cntpixel < decout4bppbuff.size(); ++cntpixel )
             {
                 auto & curtile = layer.Tiles()[cntdestpixel/NbPixelsPerTile];
@@ -140,15 +138,232 @@ namespace filetypes
 
     /*
         BPCWriter
+            Writes the layers of a tileset to a BPC file.
+            
+            Identical tiles are only written once. Each tile referred to by the tile mapping table is 
+            looked up in a hash index along with its horizontally, vertically and both ways flipped
+            versions, so a tile that's only a mirror of one already written is reused with the 
+            appropriate flip flags set in its tile mapping entry.
     */
     class BPCWriter
     {
+        static const size_t   NbBytesPerTilesRaw = 32; //In 4bpp we output 32 bytes per tile!
+        static const size_t   NbPixelsPerTile    = 64;
+        static const size_t   TileWidth          = 8;
+        static const size_t   NbTilesPerTMapGrp  = 9;  //The tile mapping table is made of groups of 3x3 tiles
+        static const size_t   MaxNbTiles         = 0x3FF + 1; //Including the empty tile
+        static const uint16_t NullTileIndex      = 0;         //The empty tile the game always has at index 0
+
+        typedef std::array<uint8_t, NbPixelsPerTile>    tilepixels_t;
+        typedef std::array<uint8_t, NbBytesPerTilesRaw> rawtile_t;
+
+        struct rawtilehash
+        {
+            size_t operator()( const rawtile_t & tile )const
+            {
+                return static_cast<size_t>(utils::HashBytesFNV1a(tile.begin(), tile.end()));
+            }
+        };
+        typedef std::unordered_map<rawtile_t, uint16_t, rawtilehash> tileindex_t;
+
     public:
-        BPCWriter()
+        BPCWriter( const pmd2::TilesetLayers & layers )
+            :m_layers(layers)
+        {}
+
+        void operator()( const std::string & destfpath )
+        {
+            if( m_layers.size() > 2 )
+                throw std::runtime_error("BPCWriter::operator(): A BPC file can only contain up to 2 layers!");
+
+            bpc_header           hdr;
+            std::vector<uint8_t> layersdata;
+            std::vector<size_t>  layeroffsets;
+            hdr.tilesetsinfo.resize(m_layers.size());
+            const size_t hdrlen = hdr.rawsize();
+
+            for( size_t cntlayer = 0; cntlayer < m_layers.size(); ++cntlayer )
+            {
+                layeroffsets.push_back(hdrlen + layersdata.size());
+                WriteALayer( m_layers[cntlayer], cntlayer, hdr.tilesetsinfo[cntlayer], layersdata );
+            }
+
+            if( layeroffsets.size() > 1 && layeroffsets[1] > std::numeric_limits<uint16_t>::max() )
+                throw std::runtime_error("BPCWriter::operator(): The second layer begins past the range of the 16 bits offset in the header!");
+            hdr.offsuprscr  = (layeroffsets.size() > 0)? static_cast<uint16_t>(layeroffsets[0]) : 0;
+            hdr.offslowrscr = (layeroffsets.size() > 1)? static_cast<uint16_t>(layeroffsets[1]) : 0;
+
+            std::vector<uint8_t> outdata;
+            outdata.reserve(hdrlen + layersdata.size());
+            hdr.Write(std::back_inserter(outdata));
+            outdata.insert( outdata.end(), layersdata.begin(), layersdata.end() );
+            utils::io::WriteByteVectorToFile(destfpath, outdata);
+        }
+
+    private:
+
+        void WriteALayer( const pmd2::TilesetLayer & layer, size_t layerid, bpc_header::indexentry & entry, std::vector<uint8_t> & out )
         {
+            std::vector<rawtile_t> tiles;
+            std::vector<uint16_t>  tmap;
+            DedupTiles( layer, tiles, tmap );
+
+            clog <<"<D>- BPCWriter::WriteALayer(): Layer #" <<layerid <<", wrote " <<tiles.size() <<" unique tiles out of "
+                 <<layer.Tiles().size() <<" tiles, for " <<layer.TileMap().size() <<" tile mapping entries. Dedup ratio " 
+                 <<std::fixed <<std::setprecision(2) 
+                 <<((layer.Tiles().empty())? 1.0 : (static_cast<double>(tiles.size()) / static_cast<double>(layer.Tiles().size())) )
+                 <<"\n";
+
+            //Keep whatever was parsed for the unknown values
+            if( layerid < m_layers.layerasmdata.size() )
+            {
+                const pmd2::TilesetLayers::LayerAsmData & asmdata = m_layers.layerasmdata[layerid];
+                entry.unk2 = asmdata.unk2;
+                entry.unk3 = asmdata.unk3;
+                entry.unk4 = asmdata.unk4;
+                entry.unk5 = asmdata.unk5;
+            }
+            else
+                entry.unk2 = entry.unk3 = entry.unk4 = entry.unk5 = 0;
+
+            //The game counts the empty tile at index 0, and an extra tile mapping group, that aren't stored in the file
+            entry.nbtiles    = static_cast<uint16_t>(tiles.size() + 1);
+            entry.tmapdeclen = static_cast<uint16_t>((tmap.size() / NbTilesPerTMapGrp) + 1);
+
+            //Compress the image
+            std::vector<uint8_t> rawimg;
+            rawimg.reserve(tiles.size() * NbBytesPerTilesRaw);
+            for( const auto & tile : tiles )
+                rawimg.insert( rawimg.end(), tile.begin(), tile.end() );
+
+            auto itbackins = std::back_inserter(out);
+            bpc_compression::BPCImgCompressor<std::vector<uint8_t>::const_iterator, decltype(itbackins)> imgcomp(rawimg.begin(), rawimg.end());
+            imgcomp(itbackins);
+
+            //Compress the tile mapping table
+            bpc_compression::BPC_TileMapCompressor<decltype(itbackins)> tmapcomp(tmap);
+            tmapcomp(itbackins);
+
+            //Keep the next layer aligned on 2 bytes
+            if( (out.size() % 2) != 0 )
+                out.push_back(0);
+        }
+
+        /*
+            Fills "outtiles" with the unique tiles, and "outtmap" with the tile mapping entries pointing to them.
+            Index 0 is the game's empty tile, which isn't stored in the file. So layer.Tiles()[0] is never written, 
+            entries refering to it are left as-is, and the stored tiles are numbered from 1.
+        */
+        void DedupTiles( const pmd2::TilesetLayer & layer, std::vector<rawtile_t> & outtiles, std::vector<uint16_t> & outtmap )
+        {
+            const auto & srctiles = layer.Tiles();
+            const auto & srctmap  = layer.TileMap();
+            tileindex_t  tindex;
+            std::vector<size_t> outoftiles; //Entries refering to tiles past the tile data, like the ones from BPAs
+            tindex.reserve(srctiles.size());
+            outtiles.reserve(srctiles.size());
+
+            //Blank tiles can just use the empty tile
+            tindex.emplace( PackTile(tilepixels_t{}), NullTileIndex );
+
+            //Pad the tile mapping table to a whole nb of groups
+            outtmap.reserve( srctmap.size() + NbTilesPerTMapGrp );
+            for( const auto & tprop : srctmap )
+            {
+                pmd2::tileproperties dest(tprop);
+                if( tprop.tileindex == NullTileIndex )
+                {
+                    outtmap.push_back(dest);
+                    continue;
+                }
+                else if( tprop.tileindex >= srctiles.size() )
+                {
+                    outoftiles.push_back(outtmap.size());
+                    outtmap.push_back(dest);
+                    continue;
+                }
+
+                //Look for what's displayed on screen, including the flip from the original entry
+                const tilepixels_t displayed = FlipTile( UnpackTile(srctiles[tprop.tileindex]), tprop.hflip, tprop.vflip );
+                bool bfound = false;
+                for( int flip = 0; flip < 4 && !bfound; ++flip )
+                {
+                    const bool hflip = (flip & 1) != 0;
+                    const bool vflip = (flip & 2) != 0;
+                    auto itf = tindex.find( PackTile(FlipTile(displayed, hflip, vflip)) );
+                    if( itf != tindex.end() )
+                    {
+                        dest.tileindex = itf->second;
+                        dest.hflip     = hflip;
+                        dest.vflip     = vflip;
+                        bfound         = true;
+                    }
+                }
+
+                if( !bfound )
+                {
+                    if( (outtiles.size() + 1) >= MaxNbTiles )
+                        throw std::runtime_error("BPCWriter::DedupTiles(): Too many unique tiles for the 10 bits tile index of the tile mapping table!");
+                    rawtile_t packed = PackTile(displayed);
+                    dest.tileindex = static_cast<uint16_t>(outtiles.size() + 1);
+                    dest.hflip     = false;
+                    dest.vflip     = false;
+                    tindex.emplace( packed, dest.tileindex );
+                    outtiles.push_back(packed);
+                }
+                outtmap.push_back(dest);
+            }
+
+            //Tiles that are never used are dropped, so the index of anything past the tile data has to be moved too
+            for( size_t idx : outoftiles )
+            {
+                pmd2::tileproperties tprop(outtmap[idx]);
+                tprop.tileindex = static_cast<uint16_t>((tprop.tileindex - srctiles.size()) + outtiles.size() + 1);
+                if( tprop.tileindex >= MaxNbTiles )
+                    throw std::runtime_error("BPCWriter::DedupTiles(): Tile index past the tile data is out of range after removing duplicate tiles!");
+                outtmap[idx] = tprop;
+            }
+
+            if( (outtmap.size() % NbTilesPerTMapGrp) != 0 )
+                outtmap.resize( outtmap.size() + (NbTilesPerTMapGrp - (outtmap.size() % NbTilesPerTMapGrp)), 0 );
+        }
+
+        static tilepixels_t UnpackTile( const std::vector<gimg::pixel_indexed_4bpp> & tile )
+        {
+            tilepixels_t pixels;
+            pixels.fill(0);
+            for( size_t cntpix = 0; cntpix < tile.size() && cntpix < NbPixelsPerTile; ++cntpix )
+                pixels[cntpix] = static_cast<uint8_t>(tile[cntpix]) & 0x0F;
+            return pixels;
+        }
+
+        static rawtile_t PackTile( const tilepixels_t & pixels )
+        {
+            rawtile_t raw;
+            for( size_t cntby = 0; cntby < NbBytesPerTilesRaw; ++cntby )
+                raw[cntby] = pixels[cntby * 2] | (pixels[(cntby * 2) + 1] << 4);
+            return raw;
+        }
+
+        static tilepixels_t FlipTile( const tilepixels_t & pixels, bool hflip, bool vflip )
+        {
+            if( !hflip && !vflip )
+                return pixels;
+            tilepixels_t flipped;
+            for( size_t y = 0; y < TileWidth; ++y )
+            {
+                const size_t srcy = vflip? (TileWidth - 1) - y : y;
+                for( size_t x = 0; x < TileWidth; ++x )
+                {
+                    const size_t srcx = hflip? (TileWidth - 1) - x : x;
+                    flipped[(y * TileWidth) + x] = pixels[(srcy * TileWidth) + srcx];
+                }
+            }
+            return flipped;
         }
 
     private:
+        const pmd2::TilesetLayers & m_layers;
     };
 
 //============================================================================================
@@ -166,8 +381,10 @@ namespace filetypes
         return std::move(BPCParser<decltype(data.begin())>(data.begin(), data.end())());
     }
 
-    void WriteBPC(const std::string & destfpath, const pmd2::Tileset & srcupscr, const pmd2::Tileset & srcbotscr)
+    void WriteBPC(const std::string & destfpath, const pmd2::TilesetLayers & layers)
     {
+        BPCWriter writer(layers);
+        writer(destfpath);
     }
 
 
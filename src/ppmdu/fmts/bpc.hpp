@@ -107,7 +107,12 @@ namespace filetypes
 //============================================================================================
     //std::pair<pmd2::Tileset,pmd2::Tileset>  ParseBPC( const std::string & fpath );
     pmd2::TilesetLayers ParseBPC( const std::string & fpath );
-    void                WriteBPC( const std::string & destfpath, const pmd2::Tileset & srcupscr, const pmd2::Tileset & srcbotscr );
+
+    /*
+        WriteBPC
+            Writes the layers to a BPC file. Duplicate tiles, including flipped ones, are only written once.
+    */
+    void                WriteBPC( const std::string & destfpath, const pmd2::TilesetLayers & layers );
 
 };
 
@@ -11,6 +11,7 @@ Description:
 #include <cstdint>
 #include <stdexcept>
 #include <iterator>
+#include <utility>
 #include <deque>
 
 namespace bpc_compression
@@ -229,84 +230,183 @@ namespace bpc_compression
 
     /*
         BPCImgCompressor
+            Compresses 4bpp tile data so that BPCImgDecompressor outputs it back.
+
+            The data is handled one word at a time. Every command copies an odd nb of bytes as 
+            encoded in the command, so the decompressor always outputs a whole nb of words and 
+            never has a leftover word to complete with the next command.
+
+            Words made of twice the same byte are written as pattern commands. Those use the 2
+            pattern bytes the decompressor keeps, so a pattern that was just used, or the one used
+            before it, costs a single command byte. Everything else is copied as-is.
     */
-    template<class _intit, class _outit>
+    template<class _init, class _outit>
         class BPCImgCompressor
     {
-        typedef _outit outit_t;
-        typedef _intit init_t;
+        static const uint8_t CMD_CyclePatternAndCp                      = 0xE0;
+        static const uint8_t CMD_CyclePatternAndCp_NbCpNextByte         = 0xFF;
 
-        /*
-        */
-        enum struct eOpType
-        {
-            Invalid,
-            SequenceCopy,   //Copy a sequence of words as-is
-            ByteCopy,       //Copy a single byte over several words
-        };
+        static const uint8_t CMD_UseLastPatternAndCp                    = 0xC0;
+        static const uint8_t CMD_UseLastPatternAndCp_NbCpNextByte       = 0xDF;
 
-        /*
-        */
-        enum struct ePatternBuffOp
-        {
-            UseCurrentByte, //Uses the current pattern byte (r7)
-            UseLastByte,    //Swap the current pattern byte with the one used that was used before the current one (r7 <-> [r13,14h])
-            SetNewByte,     //Load the next byte after the len to copy as the new current pattern byte, and keep track of the old one. (r7 -> [r13,14h], then load into r7)
-        };
+        static const uint8_t CMD_LoadByteAsPatternAndCp                 = 0x80;
+        static const uint8_t CMD_LoadByteAsPatternAndCp_NbCpNextByte    = 0xBF;
+
+        static const uint8_t CMD_LoadNextByteAsNbToCopy = 0x7E;
+        static const uint8_t CMD_LoadNextWordAsNbToCopy = 0x7F;
+
+        //Max nb of words a single command can output, for each way of storing the length
+        static const size_t MaxWordsCopyInCmd       = CMD_LoadNextByteAsNbToCopy / 2;                                       //63
+        static const size_t MaxWordsNbCpByte        = (0xFF + 1) / 2;                                                       //128
+        static const size_t MaxWordsNbCpWord        = (0xFFFF + 1) / 2;                                                     //32768
+        static const size_t MaxWordsLoadPatInCmd    = (CMD_LoadByteAsPatternAndCp_NbCpNextByte - CMD_LoadByteAsPatternAndCp) / 2;   //31
+        static const size_t MaxWordsPatInCmd        = (CMD_UseLastPatternAndCp_NbCpNextByte - CMD_UseLastPatternAndCp) / 2;         //15
+
+    public:
+        typedef _init  init_t;
+        typedef _outit outit_t;
+
+        BPCImgCompressor( init_t itbeg, init_t itend )
+            :m_itbeg(itbeg), m_itend(itend), m_hbyte(0), m_cachedhby(0), m_byteswritten(0)
+        {}
 
         /*
+            Returns the nb of bytes that were written, padding included.
         */
-        struct Operation
+        size_t operator()(outit_t & itout)
         {
-            eOpType         type;
-
-            //Sequence info
-            init_t          itbegs;     //The start of the sequence of bytes to copy
-            init_t          itends;     //The end of the sequence of bytes to copy
-            size_t          seqlen;     //The length of the sequence to be copied. The distance between "itends" and "itbegs".
-                                        // If odd, the "differed" variable will be used to fill in, as the game always copies an even nb of bytes.
-            uint8_t         differed;   //If the sequence of similar bytes' "seqlen" is odd, this will contains the value of the byte that differed.
+            m_pitw         = &itout;
+            m_hbyte        = 0;
+            m_cachedhby    = 0;
+            m_byteswritten = 0;
 
-            //Byte Patterns stuff
-            ePatternBuffOp patop;       //This will be set according to what the currently buffered pattern byte is.
-            uint8_t        newpatbyte;  //If the "patop" is "SetNewByte" this will contain the new byte to set!
+            const size_t srclen = std::distance(m_itbeg, m_itend);
+            if( (srclen % 2) != 0 )
+                throw std::runtime_error("BPCImgCompressor::operator()(): The data to compress must be made of whole words!");
 
-            Operation()
-                :seqlen(0),type(eOpType::Invalid), patop(ePatternBuffOp::UseCurrentByte)
-            {}
+            m_words.resize(0);
+            m_words.reserve(srclen / 2);
+            for( init_t itr = m_itbeg; itr != m_itend; )
+                m_words.push_back( utils::ReadIntFromBytes<uint16_t>(itr, m_itend) );
 
-            inline bool HasLeftover()const
+            for( size_t cntw = 0; cntw < m_words.size(); )
             {
-                return (seqlen % 2 != 0);
+                const size_t runlen = CountSameWords(cntw);
+                if( IsPatternWord(m_words[cntw]) && ( runlen > 1 || IsBufferedPattern(m_words[cntw] & 0xFF) ) )
+                    cntw += WritePatternOp( static_cast<uint8_t>(m_words[cntw] & 0xFF), runlen );
+                else
+                    cntw += WriteCopyOp( cntw, CountWordsToCopy(cntw) );
             }
-        };
 
-    public:
-        BPCImgCompressor( init_t itbeg, init_t itend )
-            :m_itbeg(itbeg), m_itend(itend)
-        {}
+            //The decompressor skips a byte after odd lengths of compressed data
+            if( (m_byteswritten % 2) != 0 )
+                WriteByte(0);
+            return m_byteswritten;
+        }
+
+    private:
+        inline bool IsPatternWord    ( uint16_t w )const { return (w & 0xFF) == (w >> 8); }
+        inline bool IsBufferedPattern( uint8_t by )const { return by == m_hbyte || by == m_cachedhby; }
 
-        void operator()(outit_t itout)
+        inline void WriteByte( uint8_t by )
         {
-            m_itw = itout;
+            (*(*m_pitw)) = by;
+            ++(*m_pitw);
+            ++m_byteswritten;
         }
 
-    private:
+        size_t CountSameWords( size_t from )const
+        {
+            size_t cnt = from + 1;
+            for( ; cnt < m_words.size() && m_words[cnt] == m_words[from]; ++cnt );
+            return cnt - from;
+        }
 
-        //#1- We want to take small 128 bytes chunks and try to see what is the 2 most common bytes, so we can set those as patterns in those locations
+        //Copy words as-is up to the next word that's worth writing as a pattern
+        size_t CountWordsToCopy( size_t from )const
+        {
+            size_t cnt = from + 1;
+            for( ; cnt < m_words.size() && cnt - from < MaxWordsNbCpWord; ++cnt )
+            {
+                if( IsPatternWord(m_words[cnt]) && 
+                    ( IsBufferedPattern(m_words[cnt] & 0xFF) || (cnt + 1 < m_words.size() && m_words[cnt + 1] == m_words[cnt]) ) )
+                    break;
+            }
+            return cnt - from;
+        }
+
+        //Returns the nb of words handled
+        size_t WritePatternOp( uint8_t pattern, size_t nbwords )
+        {
+            if( nbwords > MaxWordsNbCpByte )
+                nbwords = MaxWordsNbCpByte;
+
+            if( pattern == m_hbyte )
+            {
+                WriteCmdWithLen( CMD_UseLastPatternAndCp, CMD_UseLastPatternAndCp_NbCpNextByte, MaxWordsPatInCmd, nbwords );
+            }
+            else if( pattern == m_cachedhby )
+            {
+                WriteCmdWithLen( CMD_CyclePatternAndCp, CMD_CyclePatternAndCp_NbCpNextByte, MaxWordsPatInCmd, nbwords );
+                std::swap( m_hbyte, m_cachedhby );
+            }
+            else
+            {
+                WriteCmdWithLen( CMD_LoadByteAsPatternAndCp, CMD_LoadByteAsPatternAndCp_NbCpNextByte, MaxWordsLoadPatInCmd, nbwords );
+                WriteByte(pattern);
+                m_cachedhby = m_hbyte;
+                m_hbyte     = pattern;
+            }
+            return nbwords;
+        }
 
-        //#2- Sequences of the same byte that end on a odd number of similar bytes need to include the byte which differed at the end of the sequence!
+        //Returns the nb of words handled
+        size_t WriteCopyOp( size_t from, size_t nbwords )
+        {
+            const uint16_t lenbytes = static_cast<uint16_t>((nbwords * 2) - 1);
+            if( nbwords <= MaxWordsCopyInCmd )
+                WriteByte( static_cast<uint8_t>(lenbytes) );
+            else if( nbwords <= MaxWordsNbCpByte )
+            {
+                WriteByte( CMD_LoadNextByteAsNbToCopy );
+                WriteByte( static_cast<uint8_t>(lenbytes) );
+            }
+            else
+            {
+                WriteByte( CMD_LoadNextWordAsNbToCopy );
+                WriteByte( static_cast<uint8_t>(lenbytes & 0xFF) );
+                WriteByte( static_cast<uint8_t>(lenbytes >> 8) );
+            }
 
+            for( size_t cntw = from; cntw < (from + nbwords); ++cntw )
+            {
+                WriteByte( static_cast<uint8_t>(m_words[cntw] & 0xFF) );
+                WriteByte( static_cast<uint8_t>(m_words[cntw] >> 8) );
+            }
+            return nbwords;
+        }
 
-        std::vector<uint8_t> MakeCommandByte( const Operation & curop )
+        //The length written is the odd nb of bytes right below the nb of bytes to output
+        inline void WriteCmdWithLen( uint8_t cmdbase, uint8_t cmdlennextbyte, size_t maxwordsincmd, size_t nbwords )
         {
-            //If a sequence to copy ends with a word made of 2 different bytes, we want the sequence(minus the word made of 2 different bytes) to be written as a odd number of bytes in the command byte, 
+            const uint8_t lenbytes = static_cast<uint8_t>((nbwords * 2) - 1);
+            if( nbwords <= maxwordsincmd )
+                WriteByte( cmdbase + lenbytes );
+            else
+            {
+                WriteByte( cmdlennextbyte );
+                WriteByte( lenbytes );
+            }
         }
 
     private:
         init_t                  m_itbeg;
         init_t                  m_itend;
-        outit_t                 m_itw;
+        outit_t               * m_pitw;
+        std::vector<uint16_t>   m_words;
+        uint8_t                 m_hbyte;        //Same as the decompressor's current pattern byte
+        uint8_t                 m_cachedhby;    //Same as the decompressor's previous pattern byte
+        size_t                  m_byteswritten;
     };
 
 
@@ -457,5 +557,110 @@ namespace bpc_compression
         size_t      m_decomplen;    //The length of the decompressed output in bytes
     };
 
+    /*
+        BPC_TileMapCompressor
+            Compresses a tile mapping table so that BPC_TileMapDecompressor outputs it back.
+            The high bytes of all the words are written first, then the low bytes. Each pass
+            is made of runs of null bytes, runs of a repeated byte, and sequences of bytes copied as-is.
+    */
+    template<class _outit>
+        class BPC_TileMapCompressor
+    {
+        typedef _outit outit_t;
+
+        //Phase 1 CMD
+        static const uint8_t CMD_ZeroOutBeg    = 0x00;
+        static const uint8_t CMD_FillOutBeg    = 0x80;
+        static const uint8_t CMD_CopyBytesBeg  = 0xC0;
+
+        //Phase 2 CMD
+        static const uint8_t CMD_SeekOffsetBeg = 0x00;
+        static const uint8_t CMD_FillLowBeg    = 0x80;
+        static const uint8_t CMD_CopyLowBeg    = 0xC0;
+
+        static const size_t  MaxNullRun        = CMD_FillOutBeg;                    //128
+        static const size_t  MaxFillOrCopy     = 0x100 - CMD_CopyBytesBeg;          //64
+
+    public:
+        BPC_TileMapCompressor( const std::vector<uint16_t> & words )
+            :m_words(words)
+        {}
+
+        /*
+            Returns the nb of bytes written.
+        */
+        size_t operator()(outit_t & itout)
+        {
+            m_pitw         = &itout;
+            m_byteswritten = 0;
+            std::vector<uint8_t> bytes(m_words.size());
+
+            //Phase 1: High bytes
+            for( size_t i = 0; i < m_words.size(); ++i )
+                bytes[i] = static_cast<uint8_t>(m_words[i] >> 8);
+            WritePass( bytes, CMD_ZeroOutBeg, CMD_FillOutBeg, CMD_CopyBytesBeg );
+
+            //Phase 2: Low bytes. Null low bytes are just skipped over, since the words are already 0 there.
+            for( size_t i = 0; i < m_words.size(); ++i )
+                bytes[i] = static_cast<uint8_t>(m_words[i] & 0xFF);
+            WritePass( bytes, CMD_SeekOffsetBeg, CMD_FillLowBeg, CMD_CopyLowBeg );
+            return m_byteswritten;
+        }
+
+    private:
+        inline void WriteByte( uint8_t by )
+        {
+            (*(*m_pitw)) = by;
+            ++(*m_pitw);
+            ++m_byteswritten;
+        }
+
+        size_t CountSameBytes( const std::vector<uint8_t> & bytes, size_t from, size_t maxlen )const
+        {
+            size_t cnt = from + 1;
+            for( ; cnt < bytes.size() && (cnt - from) < maxlen && bytes[cnt] == bytes[from]; ++cnt );
+            return cnt - from;
+        }
+
+        void WritePass( const std::vector<uint8_t> & bytes, uint8_t cmdnull, uint8_t cmdfill, uint8_t cmdcopy )
+        {
+            for( size_t cnt = 0; cnt < bytes.size(); )
+            {
+                if( bytes[cnt] == 0 )
+                {
+                    const size_t runlen = CountSameBytes(bytes, cnt, MaxNullRun);
+                    WriteByte( static_cast<uint8_t>(cmdnull + (runlen - 1)) );
+                    cnt += runlen;
+                    continue;
+                }
+
+                const size_t runlen = CountSameBytes(bytes, cnt, MaxFillOrCopy);
+                if( runlen > 1 )
+                {
+                    WriteByte( static_cast<uint8_t>(cmdfill + (runlen - 1)) );
+                    WriteByte( bytes[cnt] );
+                    cnt += runlen;
+                    continue;
+                }
+
+                //Copy bytes as-is until the next run of at least 2 bytes
+                size_t endcp = cnt + 1;
+                for( ; endcp < bytes.size() && (endcp - cnt) < MaxFillOrCopy; ++endcp )
+                {
+                    if( endcp + 1 < bytes.size() && bytes[endcp + 1] == bytes[endcp] )
+                        break;
+                }
+                WriteByte( static_cast<uint8_t>(cmdcopy + ((endcp - cnt) - 1)) );
+                for( ; cnt < endcp; ++cnt )
+                    WriteByte( bytes[cnt] );
+            }
+        }
+
+    private:
+        const std::vector<uint16_t> & m_words;
+        outit_t                     * m_pitw;
+        size_t                        m_byteswritten;
+    };
+
 };
 #endif
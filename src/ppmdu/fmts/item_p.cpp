@@ -72,9 +72,9 @@ namespace pmd2 {namespace filetypes
         {
             vector<uint8_t> data = utils::io::ReadFileToByteVector( path );
 
-            //Parse header
-            sir0_header hdr;
-            hdr.ReadFromContainer(data.begin(), data.end());
+            //Parse header. The view checks the header's offsets against the file's length
+            SIR0View            sir0(data);
+            const sir0_header & hdr = sir0.getHeader();
 
             const uint32_t NbEntries = (hdr.ptrPtrOffsetLst - hdr.subheaderptr) / stats::ItemDataLen_EoS;
             auto           itCur     = (data.begin() + hdr.subheaderptr);
@@ -104,9 +104,9 @@ namespace pmd2 {namespace filetypes
         {
             vector<uint8_t> data = utils::io::ReadFileToByteVector( path );
 
-            //Parse header
-            sir0_header hdr;
-            hdr.ReadFromContainer(data.begin(), data.end());
+            //Parse header. The view checks the header's offsets against the file's length
+            SIR0View            sir0(data);
+            const sir0_header & hdr = sir0.getHeader();
 
             const uint32_t NbEntries = (hdr.ptrPtrOffsetLst - hdr.subheaderptr) / stats::ExclusiveItemDataLen; //Nb of entries in the exclusive item data file
             auto           itdatbeg  = data.begin() + hdr.subheaderptr;
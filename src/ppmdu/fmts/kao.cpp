@@ -15,6 +15,9 @@
 #include <Poco/File.h>
 #include <Poco/Path.h>
 #include <utils/gbyteutils.hpp>
+#include <utils/parallel_tasks.hpp>
+#include <unordered_map>
+#include <algorithm>
 using namespace std;
 using namespace gimg;
 using namespace pmd2;
@@ -46,6 +49,16 @@ namespace filetypes
         Poco::File myfile;
     };
 
+    //An image to import from a folder. Filled when listing the folders, and the image is decoded in parallel afterwards.
+    struct kao_import_job
+    {
+        Poco::File       myfile;
+        unsigned int     tocindex;     //The toc entry that will contain this subentry
+        std::string      foldername;   //The name of the parent directory containing the image file
+        CKaomado::data_t image;
+        std::string      error;        //If not empty, the image couldn't be loaded
+    };
+
 //========================================================================================================
 //  KaoParser
 //========================================================================================================
@@ -119,6 +132,7 @@ namespace filetypes
         imgdat.resize(nbtocentries * m_pImportTo->m_nbtocsubentries); //Reserve extra slots to avoid having to shrink/grow when modifying
                                                                    // and ensuring easier/faster rebuilding of the ToC and file, by
                                                                    // avoiding having to update all references in the ToC.
+        m_pImportTo->InitLazyDecoding(m_bLazyDecode);
 
         if(!m_bQuiet)
         {
@@ -146,7 +160,6 @@ namespace filetypes
     vector<uint8_t>::const_iterator KaoParser::ParseToCEntry( std::vector<kao_toc_entry>::size_type  & indexentry, vector<uint8_t>::const_iterator itrawtocentry )
     {
         //Make aliases
-        typedef CKaomado::data_t data_t;
         auto & toc    =  m_pImportTo->m_tableofcontent;
         auto & imgdat =  m_pImportTo->m_imgdata;
         vector<uint8_t>::const_iterator itend = m_kaomadoBuff.end();
@@ -171,33 +184,27 @@ namespace filetypes
             {
                 uint32_t entrylen       = GetLenRawPortraitData( m_itInBeg, itend, tocreadentry );
                 tocsz_t  entryinsertpos = (indexentry * DEF_KAO_TOC_ENTRY_NB_PTR) + cptsubentry; //Position to insert stuff for this entry in the data vector
-                data_t & tmpPortrait    = imgdat[entryinsertpos]; //a little reference to make things easier
                 auto     itentryread    = m_itInBeg + tocreadentry;
                 auto     itentryend     = m_itInBeg + (tocreadentry + entrylen);
-                auto     itpalend       = m_itInBeg + (tocreadentry + KAO_PORTRAIT_PAL_NB_COL * KAO_PORTRAIT_PAL_BPC);
-
-                //A. Read the palette
-                graphics::ReadRawPalette_RGB24_As_RGB24( itentryread, itpalend, tmpPortrait.getPalette() );
-
-                if(m_bVerbose)
-                    cout << " ..Pal OK!";
 
-                //B. Read the image
-                DecompressAT4PX( itpalend, itentryend, m_imgBuffer );
+                if( static_cast<size_t>(tocreadentry) + entrylen > m_kaomadoBuff.size() )
+                    throw std::out_of_range("KaoParser::ParseToCEntry(): Portrait at offset " + std::to_string(tocreadentry) + " goes past the end of the file!");
 
-                if(m_bVerbose)
-                    cout << " ..Decompress OK ("  <<m_imgBuffer.size() <<"b)!";
+                if( m_bLazyDecode )
+                {
+                    //Keep the palette and compressed image as-is, and decode only when needed
+                    m_pImportTo->m_undecoded[entryinsertpos].assign( itentryread, itentryend );
 
-                //C. Parse the image. 
-                // Image pixels seems to be in little endian, and need to be converted to big endian
-                ParseTiledImg<data_t>( m_imgBuffer.begin(), 
-                                       m_imgBuffer.end(), 
-                                       graphics::RES_PORTRAIT, 
-                                       tmpPortrait, 
-                                       KAO_PORTRAIT_PIXEL_ORDER_REVERSED );
+                    if(m_bVerbose)
+                        cout << " ..Kept compressed (" <<entrylen <<"b)!";
+                }
+                else
+                {
+                    CKaomado::DecodePortrait( itentryread, itentryend, imgdat[entryinsertpos], m_imgBuffer );
 
-                if(m_bVerbose)
-                    cout << " ..Img OK!";
+                    if(m_bVerbose)
+                        cout << " ..Decompress OK ("  <<m_imgBuffer.size() <<"b)! ..Img OK!";
+                }
 
                 //Refer to the new entry
                 m_pImportTo->registerToCEntry( indexentry, cptsubentry, entryinsertpos );
@@ -255,41 +262,50 @@ namespace filetypes
 
         imgdat.reserve( (ValidDirectories.size() * m_pImportTo->m_nbtocsubentries) + 1u );  //Reserve some space +1 for the dummy first slot !
         imgdat.resize(1u); //Skip the first entry, so the first data entry in the toc is not null ! 
+        m_pImportTo->InitLazyDecoding(false);
 
+        //#2 - List the images in all folders
+        vector<kao_import_job> jobs;
+        jobs.reserve( ValidDirectories.size() * m_pImportTo->m_nbtocsubentries );
+        for( auto & adir : ValidDirectories )
+        {
+            //Need to wrap it so we keep the header clean.. It will probably get optimized out by the compiler anyways
+            kao_file_wrapper wrapdir{ adir };
+            ListDirectoryImages( wrapdir, jobs );
+        }
+
+        //#3 - Decode all the images in parallel. Each job only touches its own image.
         if(!m_bQuiet)
-            cout<<"Reading Sub-Directories..\n";
+            cout<<"Reading " <<jobs.size() <<" images from sub-directories..\n";
 
-        //#2 - Handle all folders
-        unsigned int cptdirs = 0;
-        for( Poco::DirectoryIterator ithandledir(*m_pInputPath); ithandledir != itdirend; ++ithandledir )
+        utils::parallel_ctrl progress( [&]( size_t nbdone, size_t nbtotal )
         {
-            if(m_bVerbose)
-                cout << "Importing " <<Poco::Path(ithandledir->path()).getBaseName() <<"/..\n";
-            //Need to wrap it so we keep the header clean.. It will probably get optimized out by the compiler anyways
-            ImportDirectory( kao_file_wrapper{ (*ithandledir) } );
+            if( !m_bVerbose && !m_bQuiet )
+                cout<<"\r" << (nbdone * 100) / nbtotal <<"%";
+        });
+        utils::parallel_for( 0, jobs.size(), 4, [&jobs]( size_t i ){ LoadImageFile( jobs[i] ); }, &progress );
 
-            ++cptdirs;
-            if(!m_bVerbose)
-            {
-                if(!m_bQuiet)
-                    cout<<"\r" <<(cptdirs*100) / ValidDirectories.size() <<"%";
-            }
-        }
-        if( !m_bQuiet || m_bVerbose )
+        if( !m_bQuiet && !m_bVerbose )
+            cout<<"\n";
+
+        //#4 - Insert them in listing order, so the data vector is the same as when importing one at a time
+        for( auto & ajob : jobs )
+            ImportImage( ajob );
+
+        if( m_bVerbose )
             cout<<"\n";
     }
 
-    void KaoParser::ImportDirectory( kao_file_wrapper & foldertohandle )
+    void KaoParser::ListDirectoryImages( kao_file_wrapper & foldertohandle, vector<kao_import_job> & outjobs )
     {
         auto & toc    =  m_pImportTo->m_tableofcontent;
-        auto & imgdat =  m_pImportTo->m_imgdata;
 
         Poco::DirectoryIterator itdir(foldertohandle.myfile),
                                 itdirend;
         string                  foldername = Poco::Path(foldertohandle.myfile.path()).makeFile().getBaseName();
-        vector<Poco::File>      validImages(DEF_KAO_TOC_ENTRY_NB_PTR);
-        validImages.resize(0);
 
+        if(m_bVerbose)
+            cout << "Listing " <<foldername <<"/..\n";
 
         //#1 - Validate index value from folder name
         //Use folder names as indexes in the kaomado table, use image file names as toc subentry indexes!
@@ -307,41 +323,69 @@ namespace filetypes
             return;
         }
 
-        //#2 - Find all our valid images
+        //#2 - Add a job for all our valid images
         for(; itdir != itdirend; ++itdir ) 
         {
             if( IsSupportedImageType( itdir->path() ) )
-                validImages.push_back(*itdir);
+                outjobs.push_back( kao_import_job{ *itdir, ToCindex, foldername, CKaomado::data_t(), string() } );
         }
+    }
 
-        //#3 - Import the images
-        for( auto & animage : validImages )
-            ImportImage( kao_file_wrapper{animage}, ToCindex, foldername );
+    void KaoParser::LoadImageFile( kao_import_job & job )
+    {
+        Poco::Path imagepath( job.myfile.path() );
+
+        try
+        {
+            //Proceed to validate the file and find out what to use to handle it!
+            switch( GetSupportedImageType( imagepath.getFileName() ) )
+            {
+                case eSUPPORT_IMG_IO::PNG:
+                {
+                    ImportFromPNG( job.image, job.myfile.path() );
+                    break;
+                }
+                case eSUPPORT_IMG_IO::BMP:
+                {
+                    ImportFromBMP( job.image, job.myfile.path() );
+                    break;
+                }
+                case eSUPPORT_IMG_IO::RAW:
+                {
+                    stringstream pathtoraw;
+                    pathtoraw << imagepath.parent().toString() << imagepath.getBaseName();
+                    ImportRawImg( job.image, pathtoraw.str(), graphics::RES_PORTRAIT );
+                    break;
+                }
+                default:
+                {
+                    stringstream strserror;
+                    strserror<< "<!>-Error: Image " <<imagepath.toString() <<" doesn't look like a BMP, RAW or PNG image !";
+                    throw std::runtime_error(strserror.str());
+                }
+            };
+        }
+        catch( const exception & e )
+        {
+            //Reported when the image is inserted, so the messages come out in order
+            job.error = e.what();
+        }
     }
 
-    void KaoParser::ImportImage( kao_file_wrapper & imagefile, unsigned int tocindex, const std::string & foldername )
+    void KaoParser::ImportImage( kao_import_job & job )
     {
         auto & toc    =  m_pImportTo->m_tableofcontent;
-        auto & imgdat =  m_pImportTo->m_imgdata;
-
-        unsigned int datavecindex = 0;
-        Poco::File & animage      = imagefile.myfile; //make an alias
 
         if(m_bVerbose)
-            cout << "\tImg " << Poco::Path(animage.path()).getFileName() <<"..\n";
+            cout << "\tImg " <<job.foldername <<"/" << Poco::Path(job.myfile.path()).getFileName() <<"..\n";
 
-        try
+        if( !job.error.empty() )
         {
-            //Convert the image and store it in our data vector. And get the index in the data vector it is at.
-            datavecindex = AddImageToDataVector(imagefile); 
-        }
-        catch(exception e)
-        {
-            cerr <<"\n" <<e.what() <<"\n";
+            cerr <<"\n" <<job.error <<"\n";
             return; //We can't guaranty the image came through properly, so abort.
         }
 
-        Poco::Path   imgpath(animage.path());
+        Poco::Path   imgpath(job.myfile.path());
         stringstream sstrimgindex;
         unsigned int imgindex = 0;
 
@@ -353,54 +397,16 @@ namespace filetypes
         if( imgindex >= toc.front()._portraitsentries.size() )
         {
             stringstream strserror;
-            strserror <<"The index of " <<imgpath.getFileName() <<", in folder name " <<foldername 
+            strserror <<"The index of " <<imgpath.getFileName() <<", in folder name " <<job.foldername 
                         <<", exceeds the number of slots available, " <<(m_pImportTo->m_nbtocsubentries-1) 
                         <<" !\n"
                         <<"Please, number the images from 0 to " <<(m_pImportTo->m_nbtocsubentries-1) <<"!\n";
             throw domain_error( strserror.str() );
         }
 
-        //Add an entry in the toc refering to the image data we just put in our data vector
-        m_pImportTo->registerToCEntry( tocindex, imgindex, datavecindex );
-    }
-    
-    std::vector<kao_toc_entry>::size_type KaoParser::AddImageToDataVector( kao_file_wrapper & imagefile )
-    {
-        auto & imgdat =  m_pImportTo->m_imgdata;
-        CKaomado::data_t palimg;
-        Poco::Path imagepath( imagefile.myfile.path() );
-
-        //Proceed to validate the file and find out what to use to handle it!
-        switch( GetSupportedImageType( imagepath.getFileName() ) )
-        {
-            case eSUPPORT_IMG_IO::PNG:
-            {
-                ImportFromPNG( palimg, imagefile.myfile.path() );
-                break;
-            }
-            case eSUPPORT_IMG_IO::BMP:
-            {
-                ImportFromBMP( palimg, imagefile.myfile.path() );
-                break;
-            }
-            case eSUPPORT_IMG_IO::RAW:
-            {
-                stringstream pathtoraw;
-                pathtoraw << imagepath.parent().toString() << imagepath.getBaseName();
-                ImportRawImg( palimg, pathtoraw.str(), graphics::RES_PORTRAIT );
-                break;
-            }
-            default:
-            {
-                stringstream strserror;
-                strserror<< "<!>-Error: Image " <<imagepath.toString() <<" doesn't look like a BMP, RAW or PNG image !";
-                throw std::runtime_error(strserror.str());
-            }
-        };
-
-        //imgdat.push_back( std::move(palimg) );
-        //return imgdat.size() - 1;
-        return m_pImportTo->AddImageToDataVector( std::move( palimg ) );
+        //Store the image in our data vector, and add an entry in the toc refering to it
+        auto datavecindex = m_pImportTo->AddImageToDataVector( std::move(job.image) );
+        m_pImportTo->registerToCEntry( job.tocindex, imgindex, datavecindex );
     }
 
 //========================================================================================================
@@ -412,10 +418,9 @@ namespace filetypes
         m_pExportFrom      = nullptr;
         m_pDestination     = nullptr;
         m_exportType       = eSUPPORT_IMG_IO::PNG;
-        m_curOffTocSub     = 0;
-        m_lastNullEntryVal = 0;
-        m_imgBuff.resize(0);
         m_outBuff.resize(0);
+        m_portraitsData.clear();
+        m_dataToPortrait.clear();
     }
 
     vector<uint8_t> KaoWriter::operator()( const CKaomado & exportfrom )
@@ -461,7 +466,15 @@ namespace filetypes
         //Make aliases
         const auto & toc = m_pExportFrom->m_tableofcontent;
 
-        for( tocsz_t i = 1; i < toc.size(); )
+        //Each entry goes to its own folder, so they can be exported in parallel.
+        // In verbose mode, use a single chunk so the output stays in order.
+        utils::parallel_ctrl progress( [&]( size_t nbdone, size_t )
+        {
+            if( !m_bVerbose && !m_bQuiet )
+                cout<<"\r" << ((nbdone + 1) * 100) / toc.size() <<"%";
+        });
+
+        utils::parallel_for( 1, toc.size(), (m_bVerbose)? toc.size() : 1, [&]( size_t i )
         {
             //Create the sub-folder name
             stringstream outfoldernamess;
@@ -477,16 +490,8 @@ namespace filetypes
             }
 
             ExportAToCEntry( toc[i]._portraitsentries, outfoldernamess.str() );
+        }, &progress );
 
-            //Increment counter here, for the completion indicator to work
-            ++i;
-            if( !m_bVerbose )
-            {
-                if( !m_bQuiet )
-                    cout<<"\r" << (i*100) / toc.size() <<"%";
-            }
-
-        }
         if( !m_bQuiet || m_bVerbose )
             cout<<"\n";
     }
@@ -524,17 +529,17 @@ namespace filetypes
                 if( m_exportType == eSUPPORT_IMG_IO::RAW )
                 {
                     //Don't append an extension! We need only the filename!
-                    ExportRawImg( m_pExportFrom->m_imgdata[entry[j]], strsOutputPath.str() );
+                    ExportRawImg( m_pExportFrom->GetImage(entry[j]), strsOutputPath.str() );
                 }
                 else if( m_exportType == eSUPPORT_IMG_IO::BMP )
                 {
                     strsOutputPath <<"." << BMP_FileExtension;
-                    ExportToBMP( m_pExportFrom->m_imgdata[entry[j]], strsOutputPath.str() );
+                    ExportToBMP( m_pExportFrom->GetImage(entry[j]), strsOutputPath.str() );
                 }
                 else //If all else fail, export to PNG !
                 {
                     strsOutputPath <<"." << PNG_FileExtension;
-                    ExportToPNG( m_pExportFrom->m_imgdata[entry[j]], strsOutputPath.str() );
+                    ExportToPNG( m_pExportFrom->GetImage(entry[j]), strsOutputPath.str() );
                 }
 
                 if( m_bVerbose )
@@ -561,142 +566,202 @@ namespace filetypes
         //#0 - Gather some stats and do some checks
         const unsigned int  SzToCEntry       = m_pExportFrom->m_nbtocsubentries       * SUBENTRY_SIZE;
         const unsigned int  Expected_ToC_Len = m_pExportFrom->m_tableofcontent.size() * SzToCEntry;
-        auto                resultlenghts    = m_pExportFrom->EstimateKaoLenAndBiggestImage();
-        const unsigned int  estimatedlength  = resultlenghts.first;
-        unsigned int        szBiggestImg     = resultlenghts.second;
-        unsigned int        curoffsetToc     = 0;
-        unsigned int        cptcompletion    = 0;
-        unsigned int        nbentries        = m_pExportFrom->m_tableofcontent.size();
+
+        //#1 - Compress all the unique portraits
+        MakeUniquePortraits();
+
+        size_t totallen = Expected_ToC_Len;
+        for( const auto & portrait : m_portraitsData )
+            totallen += portrait.size();
 
         //Allocate memory
-        m_imgBuff.reserve( szBiggestImg );
-        m_outBuff.reserve( utils::CalculatePaddedLengthTotal( estimatedlength, 16u ) ); //align on 16 bytes
+        m_outBuff.reserve( utils::CalculatePaddedLengthTotal<size_t>( totallen, 16u ) ); //align on 16 bytes
 
         //Resize raw output buf to ToC lenght so we can begin inserting data afterwards
         m_outBuff.resize( Expected_ToC_Len, 0 ); 
 
-        //#2 - Skip the ToC in the output, and begin outputing portraits, writing down their offset as we go.
+        //#2 - Skip the ToC in the output, and lay out the portraits in ToC order, writing down their offset as we go.
         if( !m_bQuiet )
             cout << "Building kaomado file..\n";
 
+        vector<tocsubentry_t> portraitoffsets( m_portraitsData.size(), 0 ); //Offset each unique portrait was written at. 0 until written.
+        tocsubentry_t         lastnullentryval = 0;                          //The null value to use currently. Its the negative end offset of the last portrait written.
+        uint32_t              curofftocsub     = 0;                          //Offset to write the next pointer in the ToC at
+        size_t                nbdupes          = 0;
+
         for( const auto& tocentry : m_pExportFrom->m_tableofcontent )
         {
-            m_curOffTocSub = curoffsetToc; //Where we'll be writing our next sub-entry
-
             if( m_bVerbose )
-            {
-                cout <<"Writing ToC Entry @" <<hex <<showbase <<m_curOffTocSub <<" : \n" <<dec <<noshowbase;
-            }
+                cout <<"Writing ToC Entry @" <<hex <<showbase <<curofftocsub <<" : \n" <<dec <<noshowbase;
 
             size_t cptsubentry = 0;
             for( const auto & portrait : tocentry._portraitsentries )
             {
+                tocsubentry_t portraitpointer = lastnullentryval;
+
                 if( m_bVerbose )
-                {
                     cout <<"\tSubEntry #" <<right <<setw(3) <<setfill('0') <<cptsubentry <<" : ";
-                }
-                WriteAPortrait( portrait );
-                ++cptsubentry;
-            }
 
-            curoffsetToc += SzToCEntry; //jump to next ToC entry
+                if( CKaomado::isToCSubEntryValid( portrait ) )
+                {
+                    const size_t portraitid = m_dataToPortrait.at(portrait);
+                    if( portraitoffsets[portraitid] == 0 )
+                    {
+                        portraitoffsets[portraitid] = static_cast<tocsubentry_t>(m_outBuff.size());
+                        m_outBuff.insert( m_outBuff.end(), m_portraitsData[portraitid].begin(), m_portraitsData[portraitid].end() );
+                        vector<uint8_t>().swap(m_portraitsData[portraitid]); //Won't be needed again
+                        lastnullentryval = - (static_cast<tocsubentry_t>(m_outBuff.size())); //Change the sign to negative too
+
+                        if( m_bVerbose )
+                            cout <<hex <<showbase <<portraitoffsets[portraitid] <<dec <<noshowbase <<" ..Done!\n";
+                    }
+                    else
+                    {
+                        ++nbdupes;
+                        if( m_bVerbose )
+                            cout <<hex <<showbase <<portraitoffsets[portraitid] <<dec <<noshowbase <<" ..Same as an earlier portrait!\n";
+                    }
+                    portraitpointer = portraitoffsets[portraitid];
+                }
+                else if( m_bVerbose )
+                    cout <<" ..NULL\n";
 
-            ++cptcompletion;
-            if( !m_bVerbose )
-            {
-                if( !m_bQuiet )
-                    cout<<"\r" << (cptcompletion * 100) / nbentries <<"%";
+                //Write the ToC entry in the space we reserved at the beginning of the output buffer!
+                utils::WriteIntToBytes( portraitpointer, m_outBuff.begin() + curofftocsub );
+                curofftocsub += sizeof(portraitpointer);
+                ++cptsubentry;
             }
         }
-        if( !m_bQuiet || m_bVerbose )
-            cout<<"\n";
+
+        if( !m_bQuiet )
+            cout <<"Wrote " <<m_portraitsData.size() <<" unique portraits, " <<nbdupes <<" entries refer to an identical portrait.\n";
 
         //Align the end of the file on 16 bytes
-        const unsigned int nbpaddingbytes = utils::CalculateLengthPadding( m_outBuff.size(), 16u );
+        const unsigned int nbpaddingbytes = utils::CalculateLengthPadding<size_t>( m_outBuff.size(), 16u );
 
         //Add padding bytes
-        for( int i = 0; i < nbpaddingbytes; ++i )
+        for( unsigned int i = 0; i < nbpaddingbytes; ++i )
             m_outBuff.push_back(COMMON_PADDING_BYTE);
 
         //Doing this to avoid a copy, and make sure that in case of re-use, the state of our internal vector is still valid!
         vector<uint8_t> temp;
         std::swap( m_outBuff, temp );
+        m_portraitsData.clear();
+        m_dataToPortrait.clear();
 
         //Done, move the vector
         return std::move( temp );
     }
 
-    void KaoWriter::WriteAPortrait( const kao_toc_entry::subentry_t & portrait )
+    /*
+        MakeUniquePortraits
+            Fills m_portraitsData with the palette and compressed image of all the portraits
+            that aren't identical to another one, and m_dataToPortrait with the index of the
+            portrait data to use for each image refered to in the ToC.
+    */
+    void KaoWriter::MakeUniquePortraits()
     {
-        //First set both to the last valid end of data offset. "null" them out basically!
-        tocsubentry_t portraitpointer = m_lastNullEntryVal; //The offset from the beginning where we'll insert any new data!
+        const auto & toc    = m_pExportFrom->m_tableofcontent;
 
-        //Make sure we output a computed file offset for valid entry, and just the entry's value if the pointer value is invalid
-        if( CKaomado::isToCSubEntryValid( portrait ) )
+        //#1 - List the images refered to by the ToC, in the order they're first refered to
+        vector<tocsubentry_t>                 dataindices;
+        unordered_map<tocsubentry_t, size_t>  datatoindex;
+        for( const auto & tocentry : toc )
         {
-            //If we have data to write
-            auto & currentimg = m_pExportFrom->m_imgdata[portrait];
-            portraitpointer   = m_outBuff.size(); //Set the current size as the offset to insert our stuff!
-
-            if( m_bVerbose )
-            {
-                cout <<hex <<showbase <<portraitpointer <<dec <<noshowbase;
-            }
-
-            //#3.1 - Write palette
-            graphics::WriteRawPalette_RGB24_As_RGB24( m_itOutBuffPushBack, currentimg.getPalette().begin(), currentimg.getPalette().end() );
-
-            if( m_bVerbose )
+            for( const auto & portrait : tocentry._portraitsentries )
             {
-                cout <<" ..PalOK!";
+                if( CKaomado::isToCSubEntryValid(portrait) && datatoindex.emplace(portrait, dataindices.size()).second )
+                    dataindices.push_back(portrait);
             }
+        }
 
-            //Keep track of where the at4px begins
-            auto offsetafterpal = m_outBuff.size();
-
-            //#3.2 - Compress the image
-            unsigned int curimgmaxsz      = (currentimg.getSizeInBits() / 8u) +
-                                            ( (currentimg.getSizeInBits() % 8u != 0)? 1u : 0u); //Add one more just in case we ever overflow a byte (fat chance..)
-            unsigned int curimgszandheadr = curimgmaxsz + at4px_header::HEADER_SZ;
-
-            // Make a raw tiled image
-            m_imgBuff.resize(0);
-            WriteTiledImg( m_itImgBuffPushBack, currentimg, KAO_PORTRAIT_PIXEL_ORDER_REVERSED );
+        //#2 - Make the raw palette and tiled image of each. That's what we compare and compress.
+        //     Portraits that were never decoded since they were read from a kaomado file are compared and written as-is.
+        vector<vector<uint8_t>>        rawimgs(dataindices.size());
+        vector<size_t>                 pallens(dataindices.size());
+        vector<const vector<uint8_t>*> undecoded(dataindices.size());
+        for( size_t i = 0; i < dataindices.size(); ++i )
+            undecoded[i] = m_pExportFrom->GetUndecodedPortrait(dataindices[i]);
 
-            if( m_bVerbose )
+        utils::parallel_for( 0, dataindices.size(), 32, [&]( size_t i )
+        {
+            if( undecoded[i] != nullptr )
+                return;
+            const CKaomado::data_t & img       = m_pExportFrom->GetImage(dataindices[i]);
+            vector<uint8_t>        & raw       = rawimgs[i];
+            auto                     itbackins = std::back_inserter(raw);
+            raw.reserve( KAO_PORTRAIT_PAL_LEN + (img.getSizeInBits() / 8u) + 1u );
+            graphics::WriteRawPalette_RGB24_As_RGB24( itbackins, img.getPalette().begin(), img.getPalette().end() );
+            pallens[i] = raw.size();
+            WriteTiledImg( itbackins, img, KAO_PORTRAIT_PIXEL_ORDER_REVERSED );
+        });
+
+        //#3 - Find identical portraits, by hash, then by content. The first one in ToC order is the one kept.
+        unordered_multimap<uint64_t, size_t> hashtoportrait;
+        vector<size_t>                       uniqueraw;      //Index in rawimgs of each unique portrait
+        auto lambdaContent = [&]( size_t i )->const vector<uint8_t> & { return (undecoded[i] != nullptr)? *undecoded[i] : rawimgs[i]; };
+        for( size_t i = 0; i < rawimgs.size(); ++i )
+        {
+            const vector<uint8_t> & content    = lambdaContent(i);
+            const uint64_t          hash       = utils::HashBytesFNV1a( content.begin(), content.end() );
+            size_t                  portraitid = uniqueraw.size();
+            auto                    itrange    = hashtoportrait.equal_range(hash);
+            for( auto itf = itrange.first; itf != itrange.second; ++itf )
             {
-                cout <<" ..ImgOK!";
+                const size_t other = uniqueraw[itf->second];
+                if( (undecoded[other] != nullptr) == (undecoded[i] != nullptr) && 
+                    pallens[other] == pallens[i] && 
+                    lambdaContent(other) == content )
+                {
+                    portraitid = itf->second;
+                    break;
+                }
             }
 
-            //#3.3 - Expand the output to at least the raw image's length, then write at4px
-            compression::px_info_header pxinf = CompressToAT4PX( m_imgBuff.begin(), 
-                                                                 m_imgBuff.end(), 
-                                                                 m_itOutBuffPushBack,
-                                                                 compression::ePXCompLevel::LEVEL_3,
-                                                                 m_bZealousStrSearch );
-
-            if( m_bVerbose )
+            if( portraitid == uniqueraw.size() )
             {
-                cout <<" ..CompressOK!";
+                hashtoportrait.emplace( hash, portraitid );
+                uniqueraw.push_back(i);
             }
-
-            //Update the last valid end of data offset (We fill any subsequent invalid entry with this value!)
-            m_lastNullEntryVal = - (static_cast<tocsubentry_t>(m_outBuff.size())); //Change the sign to negative too
-
+            m_dataToPortrait.emplace( dataindices[i], portraitid );
         }
-        else if( m_bVerbose )
+
+        //#4 - Compress the unique portraits in parallel, each into its own buffer
+        if( !m_bQuiet )
         {
-            cout <<" ..NULL";
+            const size_t nbundecoded = std::count_if( uniqueraw.begin(), uniqueraw.end(), [&]( size_t i ){ return undecoded[i] != nullptr; } );
+            cout << "Compressing " <<(uniqueraw.size() - nbundecoded) <<" unique portraits out of " <<rawimgs.size() 
+                 <<", " <<nbundecoded <<" unchanged portraits are copied as-is..\n";
         }
 
-        //Write the ToC entry in the space we reserved at the beginning of the output buffer!
-        utils::WriteIntToBytes( portraitpointer, m_outBuff.begin() + m_curOffTocSub );
-        m_curOffTocSub += sizeof(portraitpointer);
+        utils::parallel_ctrl progress( [&]( size_t nbdone, size_t nbtotal )
+        {
+            if( !m_bQuiet )
+                cout<<"\r" << (nbdone * 100) / nbtotal <<"%";
+        });
 
-        if( m_bVerbose )
+        m_portraitsData.resize(uniqueraw.size());
+        utils::parallel_for( 0, uniqueraw.size(), 1, [&]( size_t i )
         {
-            cout <<" ..Done!\n";
-        }
+            if( undecoded[uniqueraw[i]] != nullptr )
+            {
+                m_portraitsData[i] = *undecoded[uniqueraw[i]];
+                return;
+            }
+            const vector<uint8_t> & raw    = rawimgs[uniqueraw[i]];
+            const size_t             pallen = pallens[uniqueraw[i]];
+            vector<uint8_t>        & out    = m_portraitsData[i];
+            out.reserve( raw.size() + at4px_header::HEADER_SZ + (raw.size() / 8u) );
+            out.assign( raw.begin(), raw.begin() + pallen );
+            CompressToAT4PX( raw.begin() + pallen, 
+                             raw.end(), 
+                             std::back_inserter(out),
+                             compression::ePXCompLevel::LEVEL_3,
+                             m_bZealousStrSearch );
+        }, &progress );
+
+        if( !m_bQuiet )
+            cout<<"\n";
     }
 
 //========================================================================================================
@@ -716,43 +781,77 @@ namespace filetypes
         return numeric_limits<tocsubentry_t>::min();
     }
 
-    pair<uint32_t,uint32_t> CKaomado::EstimateKaoLenAndBiggestImage()const
+    std::vector<kao_toc_entry>::size_type CKaomado::AddImageToDataVector( data_t && img )
     {
-        //Estimate kaomado worst case scenario length. (The size as if all images weren't compressed)
-        unsigned int estimatedlength = m_tableofcontent.size() * (m_nbtocsubentries * SUBENTRY_SIZE);
-        unsigned int szBiggestImg    = 0;
+        m_imgdata.push_back(std::move(img));
+        return m_imgdata.size() - 1;
+    }
 
-        //Use the ToC to count only valid entries!
-        for( auto & entry : m_tableofcontent )
-        {
-            for( auto & subentry : entry._portraitsentries )
-            {
-                if( isToCSubEntryValid( subentry ) )
-                {
-                    unsigned int  currentimgsz = (m_imgdata[subentry].getSizeInBits() / 8u) + 
-                                                 KAO_PORTRAIT_PAL_LEN + 
-                                                 at4px_header::HEADER_SZ;
+    std::vector<kao_toc_entry>::size_type CKaomado::AddImageToDataVector( const data_t & img )
+    {
+        m_imgdata.push_back(img);
+        return m_imgdata.size() - 1;
+    }
 
-                    if( szBiggestImg < currentimgsz ) //Keep track of the largest image, so we can avoid resizing our compression buffer later on
-                        szBiggestImg = (currentimgsz / 8u) + currentimgsz; //Reserve some extra space for command bytes just in case
 
-                    estimatedlength += (currentimgsz / 8u) + currentimgsz; //Reserve some extra space for command bytes just in case
-                }
-            }
+    const CKaomado::data_t & CKaomado::GetImage( tocsz_t dataindex )const
+    {
+        if( m_decodeonce != nullptr && dataindex < m_undecoded.size() )
+        {
+            //Each slot is decoded only once, even if several threads want it at the same time.
+            std::call_once( m_decodeonce[dataindex], [this,dataindex]()
+            {
+                vector<uint8_t> & raw = m_undecoded[dataindex];
+                if( raw.empty() )
+                    return;
+                vector<uint8_t> imgbuffer;
+                DecodePortrait( raw.begin(), raw.end(), m_imgdata[dataindex], imgbuffer );
+                vector<uint8_t>().swap(raw); //Won't be needed again
+            });
         }
-        return make_pair(estimatedlength, szBiggestImg);
+        return m_imgdata.at(dataindex);
     }
 
-    std::vector<kao_toc_entry>::size_type CKaomado::AddImageToDataVector( data_t && img )
+    const std::vector<uint8_t> * CKaomado::GetUndecodedPortrait( tocsz_t dataindex )const
     {
-        m_imgdata.push_back(img);
-        return m_imgdata.size() - 1;
+        if( dataindex < m_undecoded.size() && !m_undecoded[dataindex].empty() )
+            return &m_undecoded[dataindex];
+        return nullptr;
     }
 
-    std::vector<kao_toc_entry>::size_type CKaomado::AddImageToDataVector( const data_t & img )
+    void CKaomado::InitLazyDecoding( bool benable )
     {
-        m_imgdata.push_back(img);
-        return m_imgdata.size() - 1;
+        m_undecoded.clear();
+        m_decodeonce.reset();
+        if( !benable )
+            return;
+        m_undecoded.resize( m_imgdata.size() );
+        m_decodeonce.reset( new std::once_flag[m_imgdata.size()] );
+    }
+
+    void CKaomado::DecodePortrait( vector<uint8_t>::const_iterator itbeg, 
+                                   vector<uint8_t>::const_iterator itend, 
+                                   data_t                        & out, 
+                                   vector<uint8_t>               & imgbuffer )
+    {
+        if( std::distance( itbeg, itend ) < static_cast<ptrdiff_t>(KAO_PORTRAIT_PAL_LEN) )
+            throw std::length_error("CKaomado::DecodePortrait(): Portrait data too short to contain a palette!");
+
+        auto itpalend = itbeg + KAO_PORTRAIT_PAL_LEN;
+
+        //A. Read the palette
+        graphics::ReadRawPalette_RGB24_As_RGB24( itbeg, itpalend, out.getPalette() );
+
+        //B. Read the image
+        DecompressAT4PX( itpalend, itend, imgbuffer );
+
+        //C. Parse the image. 
+        // Image pixels seems to be in little endian, and need to be converted to big endian
+        ParseTiledImg<data_t>( imgbuffer.begin(), 
+                               imgbuffer.end(), 
+                               graphics::RES_PORTRAIT, 
+                               out, 
+                               KAO_PORTRAIT_PIXEL_ORDER_REVERSED );
     }
 
 };
\ No newline at end of file
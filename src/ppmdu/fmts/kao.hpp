@@ -21,6 +21,9 @@ https://github.com/Zhorken
 #include <vector>
 #include <string>
 #include <utility>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
 
 using namespace utils::io;
 
@@ -49,6 +52,7 @@ namespace filetypes
         Forward declare to cover up the Poco::File type from our libraries!
     */
     struct kao_file_wrapper;
+    struct kao_import_job;
 
     /*
         kao_toc_entry
@@ -86,6 +90,11 @@ namespace filetypes
             A functor for loading/importing a kaomado file into a CKaomado object
                 * If path is folder it tries to import the folder structure.
                 * If path is a kaomado.kao file it imports the file.
+
+            With blazydecode, portraits from a kaomado.kao file are kept compressed, and 
+            only decoded the first time they're accessed. Portraits that are never decoded
+            are written back as-is by KaoWriter.
+            Images imported from folders are decoded in parallel.
     ********************************************************************************/
     class KaoParser
     {
@@ -93,8 +102,8 @@ namespace filetypes
         typedef std::vector<kao_toc_entry::subentry_t>::size_type tocsz_t; 
         static const unsigned int SUBENTRY_SIZE = kao_toc_entry::SUBENTRY_SIZE;
     public:
-        KaoParser( bool bequiet = false, bool bverbose = false )
-            :m_pImportTo(nullptr), m_bQuiet(bequiet), m_bVerbose(bverbose)
+        KaoParser( bool bequiet = false, bool bverbose = false, bool blazydecode = true )
+            :m_pImportTo(nullptr), m_bQuiet(bequiet), m_bVerbose(bverbose), m_bLazyDecode(blazydecode)
         {}
 
         void operator()( const std::string & importfrom, CKaomado & importto );
@@ -109,19 +118,21 @@ namespace filetypes
                                                     tocsubentry_t                        entryoffset );
 
         void ImportFromFolders();
-        void ImportDirectory( kao_file_wrapper & foldertohandle );
 
-        //tocindex   = the toc entry that will contain this subentry
-        //foldername = the name of the parent directory containing the imagefile we're importing.
-        void ImportImage( kao_file_wrapper & imagefile, unsigned int tocindex, const std::string & foldername );
-        
-        //Parse, convert, and insert an image file into the data vector, and return the index it got inserted at!
-        std::vector<kao_toc_entry>::size_type AddImageToDataVector( kao_file_wrapper & imagefile );
+        //Adds an import job for each supported image in the directory, to the end of outjobs.
+        void ListDirectoryImages( kao_file_wrapper & foldertohandle, std::vector<kao_import_job> & outjobs );
+
+        //Parse and convert the image file of the job. Touches nothing but the job, so its safe to run in parallel.
+        static void LoadImageFile( kao_import_job & job );
+
+        //Insert the image of the job into the data vector, and refer to it in the ToC.
+        void ImportImage( kao_import_job & job );
 
     private:
         CKaomado * m_pImportTo;
         bool       m_bQuiet;
         bool       m_bVerbose;
+        bool       m_bLazyDecode;
 
         //Temporary variables - Parse Kaomado
         std::vector<uint8_t>                 m_kaomadoBuff;     //Buffer containing the kaomado file's raw data.
@@ -136,6 +147,10 @@ namespace filetypes
     /******************************************************************************** 
         KaoWriter
             A functor for writing/exporting portraits data into a kaomado.kao file!
+
+            When writing a kaomado.kao file, portraits with the exact same palette and 
+            pixels are only written once, and all the ToC entries refering to them point
+            to the same offset. The unique portraits are compressed in parallel.
     ********************************************************************************/
     class KaoWriter
     {
@@ -155,8 +170,6 @@ namespace filetypes
              m_bQuiet(bequiet),
              m_pFolderNames(pfoldernames), 
              m_pSubEntryNames(psubentrynames),
-             m_itImgBuffPushBack(std::back_inserter(m_imgBuff)),
-             m_itOutBuffPushBack(std::back_inserter(m_outBuff)),
              m_bVerbose(bverbose)
         {}
 
@@ -177,7 +190,7 @@ namespace filetypes
         void ExportAToCEntry( const std::vector<tocsubentry_t> & entry, const std::string & directoryname );
 
         std::vector<uint8_t> WriteToKaomado();
-        void                 WriteAPortrait( const kao_toc_entry::subentry_t & portrait );
+        void                 MakeUniquePortraits();
 
     private:
         //
@@ -191,11 +204,8 @@ namespace filetypes
         
         //Temporary variables - kaomado.kao output
         std::vector<uint8_t>                            m_outBuff;             //Kaomado output buffer
-        std::back_insert_iterator<std::vector<uint8_t>> m_itOutBuffPushBack;   //back_inserter on m_outBuff
-        std::vector<uint8_t>                            m_imgBuff;             //Used to compress image
-        std::back_insert_iterator<std::vector<uint8_t>> m_itImgBuffPushBack;   //back_inserter on m_imgBuff
-        tocsubentry_t                                   m_lastNullEntryVal;    //This is the null value to use currently, when writing the kaomado
-        uint32_t                                        m_curOffTocSub;        //This is the offset to write at in the output buffer the next pointer in the ToC
+        std::vector<std::vector<uint8_t>>               m_portraitsData;       //Palette and compressed image of each unique portrait, in the order they're first refered to in the ToC
+        std::unordered_map<tocsubentry_t, size_t>       m_dataToPortrait;      //Index in m_portraitsData, for each image data index refered to in the ToC
 
         //Temporary variables - folder output
         eSUPPORT_IMG_IO m_exportType;
@@ -234,19 +244,36 @@ namespace filetypes
 
         static inline bool isToCSubEntryValid( const tocsubentry_t & entry ) { return (entry > 0); }
 
-        //Value1 is toclen, value2 is biggest image len!
-        std::pair<uint32_t,uint32_t> EstimateKaoLenAndBiggestImage()const;
-
         //Return the offset where it was added in the data vector
         std::vector<kao_toc_entry>::size_type AddImageToDataVector( data_t && img ); //moves the image
         std::vector<kao_toc_entry>::size_type AddImageToDataVector( const data_t & img ); //Copy the image
 
         static tocsubentry_t GetInvalidToCEntry();
 
+        //Returns the image at the data index specified. If it was loaded lazily, its decoded on the first call.
+        // Can be called from several threads at once.
+        const data_t & GetImage( tocsz_t dataindex )const;
+
+        //Returns the palette and compressed image as they were in the kaomado file, if the image at the data index 
+        // was loaded lazily and never decoded. Otherwise returns nullptr. 
+        // Not synchronized with GetImage!
+        const std::vector<uint8_t> * GetUndecodedPortrait( tocsz_t dataindex )const;
+
+        //Prepares one undecoded slot per image in the data vector. Or drop all undecoded slots, if benable is false.
+        void InitLazyDecoding( bool benable );
+
+        //Decode a raw palette followed by an AT4PX compressed image into a portrait.
+        static void DecodePortrait( std::vector<uint8_t>::const_iterator itbeg, 
+                                    std::vector<uint8_t>::const_iterator itend, 
+                                    data_t                             & out, 
+                                    std::vector<uint8_t>               & imgbuffer );
+
         // --- Variables ---
-        uint32_t                    m_nbtocsubentries;
-        std::vector<kao_toc_entry>  m_tableofcontent;
-        std::vector<data_t>         m_imgdata;
+        uint32_t                                    m_nbtocsubentries;
+        std::vector<kao_toc_entry>                  m_tableofcontent;
+        mutable std::vector<data_t>                 m_imgdata;          //Lazily loaded images are decoded in place on first access
+        mutable std::vector<std::vector<uint8_t>>   m_undecoded;        //Palette and AT4PX data of each lazily loaded image not decoded yet
+        std::unique_ptr<std::once_flag[]>           m_decodeonce;       //One per slot in m_undecoded
     };
 
 
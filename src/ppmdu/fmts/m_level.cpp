@@ -114,21 +114,23 @@ namespace filetypes
             if( m_Pkmns.empty() )
                 throw std::runtime_error( "MLevelWriter::Write(): There are no entries to write! This should never happen!" );
 
-            //
-            vector<vector<uint8_t>> outBuff(m_Pkmns.size());
-
-            //
-            vector<uint8_t> swapbuff;
-            vector<uint8_t> pokedatbuff(PokeStatsGrowth::PkmnEntryLen);
-
             //Make all entries
+            vector<vector<uint8_t>>          entries( m_Pkmns.size(), vector<uint8_t>(PokeStatsGrowth::PkmnEntryLen) );
+            vector<compression::px_inrange_t> ranges;
+            ranges.reserve( entries.size() );
             for( unsigned int i = 0; i < m_Pkmns.size(); ++i )
             {
-                WriteEntry( m_Pkmns[i], pokedatbuff );
-                CompressToPKDPX( pokedatbuff.begin(), pokedatbuff.end(), swapbuff );
-                outBuff[i] = std::move( MakeSIR0Wrap( swapbuff, 0xAA ) );
+                WriteEntry( m_Pkmns[i], entries[i] );
+                ranges.push_back( make_pair( entries[i].cbegin(), entries[i].cend() ) );
             }
 
+            //The entries are independent, so compress them all in one batch
+            vector<vector<uint8_t>> outBuff;
+            CompressToPKDPXBatch( ranges, outBuff );
+
+            for( auto & entry : outBuff )
+                entry = std::move( MakeSIR0Wrap( entry, 0xAA ) );
+
             
             CPack myPack( std::move(outBuff) );
             //#FIXME: this might require a different offset for EoT/EoD
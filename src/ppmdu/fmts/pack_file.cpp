@@ -11,10 +11,19 @@
 #include <sstream>
 #include <iomanip>
 #include <Poco/DirectoryIterator.h>
+#include <Poco/SharedMemory.h>
+#include <Poco/File.h>
 #include <cassert>
+#include <deque>
+#include <future>
+#include <limits>
+#include <ppmdu/fmts/pkdpx.hpp>
+#include <ppmdu/fmts/at4px.hpp>
 #include <utils/gbyteutils.hpp>
 #include <utils/utility.hpp>
 #include <utils/utility.hpp>
+#include <utils/parallel_tasks.hpp>
+#include <utils/poco_wrapper.hpp>
 using namespace std;
 using namespace utils::io;
 using namespace utils;
@@ -220,6 +229,24 @@ namespace filetypes
         return std::move(result); //Implicit move constructor
     }
 
+    void CPack::OutputPack( std::ostream & out )
+    {
+        if( m_SubFiles.empty() )
+            throw std::runtime_error( "CPack::OutputPack(): No subfiles. File offset table was empty!" );
+
+        vector<uint32_t> subfilesizes;
+        subfilesizes.reserve( m_SubFiles.size() );
+        for( const auto & afile : m_SubFiles )
+            subfilesizes.push_back( afile.size() );
+
+        PackWriter writer( out, subfilesizes, m_ForcedFirstFileOffset );
+        for( const auto & afile : m_SubFiles )
+            writer.WriteSubFile( afile );
+        writer.Finish();
+
+        m_OffsetTable = writer.getFOT();
+    }
+
 
     void CPack::OutputToFolder( const std::string & pathdir )
     {
@@ -390,13 +417,11 @@ namespace filetypes
             return "." + result;
     }
 
-    void CPack::WriteSubFileToFile( vector<uint8_t>  & file,
-                                    const std::string & path, 
-                                    unsigned int        fileindex )
+    /*
+        Builds the path a sub-file is unpacked to.
+    */
+    string MakeSubFileOutputPath( const std::string & path, unsigned int fileindex, uint32_t fileoffset, const vector<uint8_t> & file )
     {
-        //static const string FILE_PREFIX = "file_";
-
-		//----- 1. Make output filename -----
 		stringstream outfilename;
         Poco::Path   outpath(path);
         outpath.makeFile();
@@ -404,11 +429,339 @@ namespace filetypes
         outfilename << utils::TryAppendSlash( path ) << (outpath.getBaseName()) <<"_"
                     <<std::setfill('0') <<std::setw(4) <<std::dec <<fileindex
                     <<"_0x" 
-                    <<std::setfill('0') <<std::setw(4) <<std::hex << m_OffsetTable[fileindex]._fileOffset
+                    <<std::setfill('0') <<std::setw(4) <<std::hex << fileoffset
                     << SubfileGetFExtension( file.begin(), file.end() );
+        return outfilename.str();
+    }
+
+    void CPack::WriteSubFileToFile( vector<uint8_t>  & file,
+                                    const std::string & path, 
+                                    unsigned int        fileindex )
+    {
+        //static const string FILE_PREFIX = "file_";
+
+		//----- 1. Make output filename -----
+        const string outfilename = MakeSubFileOutputPath( path, fileindex, m_OffsetTable[fileindex]._fileOffset, file );
 
 		//------- 2. Output -------
-        WriteByteVectorToFile( outfilename.str(), file ); 
+        WriteByteVectorToFile( outfilename, file ); 
+    }
+
+//===============================================================================
+//								PackWriter
+//===============================================================================
+    /*
+        Returns the length of the header with its padding, which is also where the first sub-file begins.
+        Follows the same rules as CPack::CalcAmountHeaderPaddingBytes().
+    */
+    uint32_t PackWriter::CalcHeaderLength( uint32_t nbsubfiles, uint32_t forcedfirstfileoffset )
+    {
+        const uint32_t hdrlen = CPack::PredictHeaderSizeWithPadding( nbsubfiles );
+        return ( forcedfirstfileoffset > hdrlen ) ? forcedfirstfileoffset : hdrlen;
+    }
+
+    PackWriter::PackWriter( std::ostream & out, const std::vector<uint32_t> & subfilesizes, uint32_t forcedfirstfileoffset )
+        :m_out(out),
+         m_startpos(out.tellp()),
+         m_nbsubfiles(subfilesizes.size()),
+         m_headerlen(CalcHeaderLength(subfilesizes.size(), forcedfirstfileoffset)),
+         m_nextoffset(m_headerlen),
+         m_bheaderwritten(false),
+         m_expectedsizes(subfilesizes)
+    {
+        if( m_nbsubfiles == 0 )
+            throw std::runtime_error( "PackWriter::PackWriter(): No subfiles. File offset table would be empty!" );
+
+        //Lay out the whole file offset table from the sizes, so the header can go out first
+        vector<fileIndex> fot;
+        fot.reserve( m_nbsubfiles );
+        uint64_t offsetsofar = m_headerlen;
+        for( const auto & sz : m_expectedsizes )
+        {
+            fot.push_back( fileIndex( static_cast<uint32_t>(offsetsofar), sz ) );
+            offsetsofar = CalculatePaddedLengthTotal<uint64_t>( offsetsofar + sz, 16u );
+        }
+
+        if( offsetsofar > std::numeric_limits<uint32_t>::max() )
+            throw std::overflow_error( "PackWriter::PackWriter(): Sub-files are too large to fit in a pack file!" );
+
+        WriteHeader( fot );
+        m_bheaderwritten = true;
+        m_OffsetTable.reserve( m_nbsubfiles );
+    }
+
+    PackWriter::PackWriter( std::ostream & out, uint32_t nbsubfiles, uint32_t forcedfirstfileoffset )
+        :m_out(out),
+         m_startpos(out.tellp()),
+         m_nbsubfiles(nbsubfiles),
+         m_headerlen(CalcHeaderLength(nbsubfiles, forcedfirstfileoffset)),
+         m_nextoffset(m_headerlen),
+         m_bheaderwritten(false)
+    {
+        if( m_nbsubfiles == 0 )
+            throw std::runtime_error( "PackWriter::PackWriter(): No subfiles. File offset table would be empty!" );
+        if( m_startpos == std::streampos(-1) )
+            throw std::runtime_error( "PackWriter::PackWriter(): Output stream must be seekable when the sub-file sizes aren't known!" );
+
+        //Reserve the room for the header. Its written over in Finish()
+        WriteHeader( vector<fileIndex>(m_nbsubfiles) );
+        m_OffsetTable.reserve( m_nbsubfiles );
+    }
+
+    void PackWriter::WriteHeader( const std::vector<fileIndex> & fot )
+    {
+        vector<uint8_t> header( m_headerlen, PF_PADDING_BYTE );
+        pfheader        mahead;
+        mahead._zeros   = 0;
+        mahead._nbfiles = fot.size();
+
+        auto itwrite = mahead.WriteToContainer( header.begin() );
+
+        for( const auto & fotentry : fot )
+            itwrite = fotentry.WriteToContainer( itwrite );
+
+        std::copy( OFFSET_TBL_DELIM.begin(), OFFSET_TBL_DELIM.end(), itwrite );
+
+        m_out.write( reinterpret_cast<const char*>(header.data()), header.size() );
+        if( m_out.fail() )
+            throw std::runtime_error( "PackWriter::WriteHeader(): Error writing the pack file header!" );
+    }
+
+    void PackWriter::WriteSubFile( const uint8_t * pbeg, const uint8_t * pend )
+    {
+        static const std::array<uint8_t,16> PaddingBytes = { PF_PADDING_BYTE, PF_PADDING_BYTE, PF_PADDING_BYTE, PF_PADDING_BYTE,
+                                                             PF_PADDING_BYTE, PF_PADDING_BYTE, PF_PADDING_BYTE, PF_PADDING_BYTE,
+                                                             PF_PADDING_BYTE, PF_PADDING_BYTE, PF_PADDING_BYTE, PF_PADDING_BYTE,
+                                                             PF_PADDING_BYTE, PF_PADDING_BYTE, PF_PADDING_BYTE, PF_PADDING_BYTE, };
+        const size_t filelen = static_cast<size_t>(pend - pbeg);
+        const size_t index   = m_OffsetTable.size();
+
+        if( index >= m_nbsubfiles )
+            throw std::out_of_range( "PackWriter::WriteSubFile(): All sub-files were already written!" );
+        if( !m_expectedsizes.empty() && m_expectedsizes[index] != filelen )
+        {
+            stringstream sstr;
+            sstr << "PackWriter::WriteSubFile(): Sub-file #" <<index <<" is " <<filelen <<" bytes long, but " <<m_expectedsizes[index] <<" bytes were expected!";
+            throw std::runtime_error( sstr.str() );
+        }
+        if( static_cast<uint64_t>(m_nextoffset) + filelen > std::numeric_limits<uint32_t>::max() )
+            throw std::overflow_error( "PackWriter::WriteSubFile(): Sub-files are too large to fit in a pack file!" );
+
+        const uint32_t nbpadding = ComputeFileNBPaddingBytes( static_cast<uint32_t>(filelen) );
+        m_out.write( reinterpret_cast<const char*>(pbeg), filelen );
+        m_out.write( reinterpret_cast<const char*>(PaddingBytes.data()), nbpadding );
+
+        if( m_out.fail() )
+            throw std::runtime_error( "PackWriter::WriteSubFile(): Error writing sub-file to the output stream!" );
+
+        m_OffsetTable.push_back( fileIndex( m_nextoffset, filelen ) );
+        m_nextoffset += filelen + nbpadding;
+    }
+
+    void PackWriter::WriteSubFile( const std::vector<uint8_t> & subfile )
+    {
+        WriteSubFile( subfile.data(), subfile.data() + subfile.size() );
+    }
+
+    void PackWriter::Finish()
+    {
+        if( m_OffsetTable.size() != m_nbsubfiles )
+        {
+            stringstream sstr;
+            sstr << "PackWriter::Finish(): Only " <<m_OffsetTable.size() <<" of the " <<m_nbsubfiles <<" sub-files were written!";
+            throw std::runtime_error( sstr.str() );
+        }
+
+        if( !m_bheaderwritten )
+        {
+            //Go back and fill the header we reserved, now that we know where everything ended up
+            const std::streampos endpos = m_out.tellp();
+            m_out.seekp( m_startpos );
+            WriteHeader( m_OffsetTable );
+            m_out.seekp( endpos );
+            m_bheaderwritten = true;
+        }
+
+        m_out.flush();
+        if( m_out.fail() )
+            throw std::runtime_error( "PackWriter::Finish(): Error writing the pack file!" );
+    }
+
+    void WritePackFromProducer( std::ostream                                         & out,
+                                uint32_t                                               nbsubfiles,
+                                const std::function<std::vector<uint8_t>(uint32_t)>  & producer,
+                                uint32_t                                               forcedfirstfileoffset,
+                                size_t                                                 maxinflight,
+                                const std::function<void(size_t,size_t)>             & onprogress )
+    {
+        utils::ThreadPool                      pool;
+        PackWriter                             writer( out, nbsubfiles, forcedfirstfileoffset );
+        std::deque<future<vector<uint8_t>>>    inflight;
+        uint32_t                               nextsubmit = 0;
+
+        if( maxinflight == 0 )
+            maxinflight = std::max<size_t>( pool.NbThreads(), 1 );
+
+        for( uint32_t i = 0; i < nbsubfiles; ++i )
+        {
+            //Keep the pool busy producing the next few sub-files while this one is written
+            for( ; nextsubmit < nbsubfiles && inflight.size() < maxinflight; ++nextsubmit )
+                inflight.push_back( pool.Submit( [&producer, nextsubmit](){ return producer(nextsubmit); } ) );
+
+            vector<uint8_t> subfile = inflight.front().get();
+            inflight.pop_front();
+            writer.WriteSubFile( subfile );
+
+            if( onprogress )
+                onprogress( i + 1, nbsubfiles );
+        }
+
+        writer.Finish();
+    }
+
+    void WritePackFromProducer( const std::string                                    & outpath,
+                                uint32_t                                               nbsubfiles,
+                                const std::function<std::vector<uint8_t>(uint32_t)>  & producer,
+                                uint32_t                                               forcedfirstfileoffset,
+                                size_t                                                 maxinflight,
+                                const std::function<void(size_t,size_t)>             & onprogress )
+    {
+        const string tmppath = outpath + ".tmp";
+        try
+        {
+            {
+                ofstream outfile( tmppath, ios::out | ios::binary );
+                if( !outfile.is_open() )
+                    throw runtime_error( "WritePackFromProducer(): Couldn't open output file \"" + tmppath + "\"!" );
+                WritePackFromProducer( outfile, nbsubfiles, producer, forcedfirstfileoffset, maxinflight, onprogress );
+            }
+            utils::RenameReplaceExisting(tmppath, outpath);
+        }
+        catch(...)
+        {
+            try
+            {
+                Poco::File tmpfile(tmppath);
+                if( tmpfile.exists() )
+                    tmpfile.remove();
+            }
+            catch(...)
+            {}
+            throw;
+        }
+    }
+
+//===============================================================================
+//								PackView
+//===============================================================================
+    struct packview_mapping
+    {
+        Poco::SharedMemory mappedfile;
+    };
+
+    PackView::PackView( const std::string & packfilepath )
+        :m_pbeg(nullptr), m_pend(nullptr), m_ForcedFirstFileOffset(0)
+    {
+        static const uint32_t MinPackFileLen = pfheader::HEADER_LEN + SZ_OFFSET_TBL_ENTRY;
+        Poco::File packfile(packfilepath);
+
+        //Can't map an empty file, so check the size first
+        if( !packfile.exists() || !packfile.isFile() || packfile.getSize() < MinPackFileLen )
+            throw runtime_error("PackView::PackView(): File \"" + packfilepath + "\" doesn't exist, or is too small to be a pack file!");
+
+        m_pmapping.reset( new packview_mapping{ Poco::SharedMemory( packfile, Poco::SharedMemory::AM_READ ) } );
+        m_pbeg = reinterpret_cast<const uint8_t*>( m_pmapping->mappedfile.begin() );
+        m_pend = reinterpret_cast<const uint8_t*>( m_pmapping->mappedfile.end() );
+
+        //#1 - Read header
+        const uint8_t * itread  = m_pbeg;
+        pfheader        mahead;
+        mahead._zeros   = utils::ReadIntFromBytes<uint32_t>( itread, m_pend );
+        mahead._nbfiles = utils::ReadIntFromBytes<uint32_t>( itread, m_pend );
+        const uint64_t fotend = OFFSET_TBL_FIRST_ENTRY + ( static_cast<uint64_t>(mahead._nbfiles) * SZ_OFFSET_TBL_ENTRY );
+
+        if( !mahead.isValid() || fotend > static_cast<uint64_t>(m_pend - m_pbeg) )
+            throw runtime_error("PackView::PackView(): File \"" + packfilepath + "\" has an invalid pack file header!");
+
+        //#2 - Read the File Offset Table, and make sure every entries are within the file
+        m_OffsetTable.resize( mahead._nbfiles );
+        for( auto & entry : m_OffsetTable )
+        {
+            entry._fileOffset = utils::ReadIntFromBytes<uint32_t>( itread, m_pend );
+            entry._fileLength = utils::ReadIntFromBytes<uint32_t>( itread, m_pend );
+
+            if( static_cast<uint64_t>(entry._fileOffset) + entry._fileLength > static_cast<uint64_t>(m_pend - m_pbeg) )
+                throw runtime_error("PackView::PackView(): File \"" + packfilepath + "\" has a sub-file ending past the end of the file!");
+        }
+
+        //#3 - Is it using a forced first file offset ?
+        const uint32_t expectedhdrlen = CalculatePaddedLengthTotal( pfheader::HEADER_LEN + (mahead._nbfiles * SZ_OFFSET_TBL_ENTRY) + SZ_OFFSET_TBL_DELIM, 16u );
+        m_ForcedFirstFileOffset = ( m_OffsetTable.front()._fileOffset > expectedhdrlen ) ? m_OffsetTable.front()._fileOffset : 0;
+    }
+
+    PackView::~PackView()
+    {}
+
+    PackView::subfile_view PackView::getSubFile( size_t index )const
+    {
+        const fileIndex & entry = m_OffsetTable.at(index);
+        subfile_view      view  = { m_pbeg + entry._fileOffset, m_pbeg + entry._fileOffset + entry._fileLength };
+        return view;
+    }
+
+    bool PackView::isSubFileCompressed( size_t index )const
+    {
+        subfile_view view = getSubFile(index);
+        return ( view.size() >= MagicNumber_PKDPX_Len && equal( MagicNumber_PKDPX.begin(), MagicNumber_PKDPX.end(), view.begin() ) ) ||
+               ( view.size() >= MagicNumber_AT4PX_Len && equal( MagicNumber_AT4PX.begin(), MagicNumber_AT4PX.end(), view.begin() ) );
+    }
+
+    std::vector<uint8_t> PackView::copySubFile( size_t index )const
+    {
+        subfile_view view = getSubFile(index);
+        return vector<uint8_t>( view.begin(), view.end() );
+    }
+
+    std::vector<uint8_t> PackView::getSubFileDecompressed( size_t index )const
+    {
+        subfile_view                view = getSubFile(index);
+        compression::px_info_header pxinf;
+        const uint8_t             * itdata = nullptr;
+
+        if( view.size() >= pkdpx_header::HEADER_SZ && equal( MagicNumber_PKDPX.begin(), MagicNumber_PKDPX.end(), view.begin() ) )
+        {
+            pkdpx_header hdr;
+            itdata = hdr.ReadFromContainer( view.begin(), view.end() );
+            pxinf  = PKDPXHeaderToPXinfo( hdr );
+        }
+        else if( view.size() >= at4px_header::HEADER_SZ && equal( MagicNumber_AT4PX.begin(), MagicNumber_AT4PX.end(), view.begin() ) )
+        {
+            at4px_header hdr;
+            itdata = hdr.ReadFromContainer( view.begin(), view.end() );
+            pxinf  = AT4PXHeaderToPXinfo( hdr );
+        }
+        else
+            return copySubFile(index);
+
+        vector<uint8_t> decompressed( pxinf.decompressedsz );
+        compression::DecompressPX( pxinf, itdata, view.end(), decompressed.data(), decompressed.data() + decompressed.size() );
+        return std::move(decompressed);
+    }
+
+    void PackView::OutputSubFileToFolder( size_t index, const std::string & pathdir )const
+    {
+        //The file type detection needs a vector, so copy only this one sub-file
+        vector<uint8_t> file = copySubFile(index);
+        WriteByteVectorToFile( MakeSubFileOutputPath( pathdir, index, m_OffsetTable[index]._fileOffset, file ), file );
+    }
+
+    void PackView::OutputToFolder( const std::string & pathdir )const
+    {
+        if( !utils::DoCreateDirectory( pathdir ) )
+            throw runtime_error("PackView::OutputToFolder(): Invalid output path!");
+
+        for( size_t i = 0; i < m_OffsetTable.size(); ++i )
+            OutputSubFileToFolder( i, pathdir );
     }
 
 //========================================================================================================
@@ -18,6 +18,8 @@ All wrongs reversed, no crappyrights :P
 #include <vector>
 #include <memory>
 #include <array>
+#include <functional>
+#include <iosfwd>
 #include <utils/utility.hpp>
 #include <types/content_type_analyser.hpp>
 
@@ -138,6 +140,9 @@ namespace filetypes
         // The method calls BuildFOT() before outputting the file, so its not neccessary to call it before.
         std::vector<uint8_t> OutputPack(); //Move constructor should make this very efficient
 
+        //Same as above, but the pack is written straight to the stream instead of being assembled in memory first.
+        void OutputPack( std::ostream & out );
+
         //This allow to output the sub files of this pack file into a specified directory.
         void OutputToFolder( const std::string & pathdir );
 
@@ -199,6 +204,8 @@ namespace filetypes
         //Write all the file's data in the subfiles vector to the uint8_t vector passed as parameter, at the position pointed by the iterator  
         std::vector<uint8_t>::iterator WriteFileData( std::vector<uint8_t>::iterator writeat ); //#todo: it should be const, but a stupid mistake with the CPack file makes it fail..
 
+        friend class PackWriter;
+
         //Write a subfile from the subfile vector to the specified file. 
         void WriteSubFileToFile( std::vector<uint8_t> & file, const std::string & path, unsigned int fileindex );
 
@@ -210,6 +217,166 @@ namespace filetypes
         std::vector<std::vector<uint8_t>> m_SubFiles;
     };
 
+//===============================================================================
+//								       PackWriter
+//===============================================================================
+    /*
+        PackWriter
+            Writes a pack file straight to an output stream, one sub-file at a time, without ever holding
+            the whole pack in memory.
+
+            When the sub-file sizes are known up front, the file offset table is computed right away, and the
+            header is written immediately. Each sub-file is then written as soon as its handed over. This works
+            on any output stream.
+
+            When only the number of sub-files is known, the space for the header is reserved, and the file
+            offset table is written over it by Finish(), once every sub-file was written. The stream must be
+            seekable for this.
+
+            Sub-files must be handed over in order, and Finish() must be called once they all were.
+    */
+    class PackWriter
+    {
+    public:
+        //Sub-file sizes known up front. The header is written right away.
+        PackWriter( std::ostream & out, const std::vector<uint32_t> & subfilesizes, uint32_t forcedfirstfileoffset = 0 );
+
+        //Only the number of sub-files is known. Room for the header is reserved, and its filled by Finish().
+        PackWriter( std::ostream & out, uint32_t nbsubfiles, uint32_t forcedfirstfileoffset = 0 );
+
+        //Writes the next sub-file, followed by its padding.
+        // If sizes were given on construction, the sub-file's size must match!
+        void WriteSubFile( const uint8_t * pbeg, const uint8_t * pend );
+        void WriteSubFile( const std::vector<uint8_t> & subfile );
+
+        //Checks that all sub-files were written, and writes the file offset table if it wasn't already.
+        void Finish();
+
+        inline uint32_t                       getNbSubFiles()const   { return m_nbsubfiles; }
+        inline uint32_t                       getNbWritten()const    { return m_OffsetTable.size(); }
+        inline uint32_t                       getHeaderLength()const { return m_headerlen; }
+        inline const std::vector<fileIndex> & getFOT()const          { return m_OffsetTable; }
+
+    private:
+        //Length of the header with its padding. Follows the same rules as CPack.
+        static uint32_t CalcHeaderLength( uint32_t nbsubfiles, uint32_t forcedfirstfileoffset );
+
+        void WriteHeader( const std::vector<fileIndex> & fot );
+
+        PackWriter( const PackWriter & );
+        PackWriter & operator=( const PackWriter & );
+
+    private:
+        std::ostream          & m_out;
+        std::streampos          m_startpos;
+        uint32_t                m_nbsubfiles;
+        uint32_t                m_headerlen;        //Header length with padding. Also the offset of the first sub-file.
+        uint32_t                m_nextoffset;       //Where the next sub-file goes
+        bool                    m_bheaderwritten;
+        std::vector<uint32_t>   m_expectedsizes;    //Empty when the sizes weren't known up front
+        std::vector<fileIndex>  m_OffsetTable;      //Entries for the sub-files written so far
+    };
+
+    /*
+        WritePackFromProducer
+            Writes a pack file to a seekable stream, getting each sub-file from the producer function.
+            The producer is called with the index of the sub-file, and returns its data. Its run on the
+            thread pool for up to "maxinflight" sub-files ahead of the one being written, so producing
+            sub-file N+1 overlaps with writing sub-file N. Only those sub-files are ever held in memory.
+            If maxinflight is 0, the amount of threads in use is used.
+            "onprogress" is called from the calling thread with the number of sub-files written so far, and the total.
+            The first exception thrown by the producer is rethrown.
+    */
+    void WritePackFromProducer( std::ostream                                         & out,
+                                uint32_t                                               nbsubfiles,
+                                const std::function<std::vector<uint8_t>(uint32_t)>  & producer,
+                                uint32_t                                               forcedfirstfileoffset = 0,
+                                size_t                                                 maxinflight           = 0,
+                                const std::function<void(size_t,size_t)>             & onprogress            = std::function<void(size_t,size_t)>() );
+
+    /*
+        WritePackFromProducer
+            Same as above, but writes to the file at "outpath". The pack is written to a temporary file next to it first,
+            which replaces "outpath" only once the pack is complete. If anything throws, the temporary file is deleted, 
+            and whatever was at "outpath" is left untouched.
+    */
+    void WritePackFromProducer( const std::string                                    & outpath,
+                                uint32_t                                               nbsubfiles,
+                                const std::function<std::vector<uint8_t>(uint32_t)>  & producer,
+                                uint32_t                                               forcedfirstfileoffset = 0,
+                                size_t                                                 maxinflight           = 0,
+                                const std::function<void(size_t,size_t)>             & onprogress            = std::function<void(size_t,size_t)>() );
+
+//===============================================================================
+//								       PackView
+//===============================================================================
+    struct packview_mapping; //This is to avoid including the POCO header in here..
+
+    /*
+        PackView
+            Read-only access to a pack file on disk, without loading it in memory.
+            The file is memory mapped, and only the header and file offset table are parsed on construction.
+            Sub-files are handed out as views into the mapped file, so nothing is copied until a sub-file 
+            is decompressed or written out. Views stay valid for as long as the PackView exists.
+    */
+    class PackView
+    {
+    public:
+        /*
+            subfile_view
+                Range of bytes of a single sub-file within the mapped pack file.
+        */
+        struct subfile_view
+        {
+            typedef const uint8_t * const_iterator;
+
+            const uint8_t * pbeg;
+            const uint8_t * pend;
+
+            inline const_iterator  begin()const { return pbeg; }
+            inline const_iterator  end()const   { return pend; }
+            inline const uint8_t * data()const  { return pbeg; }
+            inline size_t          size()const  { return static_cast<size_t>(pend - pbeg); }
+            inline bool            empty()const { return pbeg == pend; }
+        };
+
+        //Maps the file and reads its file offset table. Throws if its not a valid pack file.
+        explicit PackView( const std::string & packfilepath );
+        ~PackView();
+
+        inline size_t            getNbSubFiles()const                 { return m_OffsetTable.size(); }
+        inline const fileIndex & getFOTEntry( size_t index )const     { return m_OffsetTable.at(index); }
+
+        //Returns the offset the first sub-file was forced to, or 0 if the pack isn't using one.
+        inline uint32_t          getForcedFirstPosition()const        { return m_ForcedFirstFileOffset; }
+
+        //Returns the sub-file's raw data, without copying it.
+        subfile_view             getSubFile( size_t index )const;
+
+        //Whether the sub-file begins with a PKDPX or AT4PX header.
+        bool                     isSubFileCompressed( size_t index )const;
+
+        //Returns a copy of the sub-file's raw data.
+        std::vector<uint8_t>     copySubFile( size_t index )const;
+
+        //Returns the sub-file decompressed if its PKDPX or AT4PX compressed, or a copy of its raw data otherwise.
+        std::vector<uint8_t>     getSubFileDecompressed( size_t index )const;
+
+        //Write one or all sub-files into the directory. Files are named the same way CPack::OutputToFolder() does.
+        void OutputSubFileToFolder( size_t index, const std::string & pathdir )const;
+        void OutputToFolder( const std::string & pathdir )const;
+
+    private:
+        PackView( const PackView & );
+        PackView & operator=( const PackView & );
+
+        std::unique_ptr<packview_mapping> m_pmapping;
+        const uint8_t                   * m_pbeg;
+        const uint8_t                   * m_pend;
+        uint32_t                          m_ForcedFirstFileOffset;
+        std::vector<fileIndex>            m_OffsetTable;
+    };
+
 };
 
 #endif
\ No newline at end of file
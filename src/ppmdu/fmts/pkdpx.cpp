@@ -229,6 +229,32 @@ namespace filetypes
         return pxinf;
     }
 
+    /*******************************************************
+        CompressToPKDPXBatch
+    *******************************************************/
+    std::vector<compression::px_info_header> CompressToPKDPXBatch( const std::vector<compression::px_inrange_t> & inputs,
+                                                                   std::vector<std::vector<uint8_t>>            & out_compressed,
+                                                                   compression::ePXCompLevel                      complvl,
+                                                                   bool                                           bzealous,
+                                                                   bool                                           bdisplayProgress )
+    {
+        //Leave room for the header in front of the compressed data
+        auto pxinfs = compression::CompressPXBatch( inputs, 
+                                                    out_compressed, 
+                                                    complvl, 
+                                                    bzealous, 
+                                                    bdisplayProgress, 
+                                                    pkdpx_header::HEADER_SZ );
+
+        for( size_t i = 0; i < pxinfs.size(); ++i )
+        {
+            pkdpx_header headr = PXinfoToPKDPXHeader( pxinfs[i] );
+            headr.WriteToContainer( out_compressed[i].begin() );
+        }
+
+        return std::move(pxinfs);
+    }
+
     /*******************************************************
         DecompressPKDPX
             Decompress an PKDPX file.
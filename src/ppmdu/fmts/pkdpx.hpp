@@ -198,6 +198,20 @@ namespace filetypes
                                                  bool                                             blogenable       = false );
 
 
+    /*******************************************************
+        CompressToPKDPXBatch
+            Compress several ranges at once into PKDPX 
+            files, using compression::CompressPXBatch.
+            Each output entry contains the PKDPX header
+            followed by the compressed data, in the same
+            order as the inputs.
+    *******************************************************/
+    std::vector<compression::px_info_header> CompressToPKDPXBatch( const std::vector<compression::px_inrange_t> & inputs,
+                                                                   std::vector<std::vector<uint8_t>>            & out_compressed,
+                                                                   compression::ePXCompLevel                      complvl          = compression::ePXCompLevel::LEVEL_3,
+                                                                   bool                                           bzealous         = true,
+                                                                   bool                                           bdisplayProgress = false );
+
     /*******************************************************
         DecompressPKDPX
             Decompress an PKDPX file.
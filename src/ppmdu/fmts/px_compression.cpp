@@ -16,8 +16,12 @@
 #include <cassert>
 #include <string>
 #include <numeric>
+#include <cstring>
+#include <thread>
+#include <mutex>
 #include <Poco/File.h>
 #include <utils/utility.hpp>
+#include <utils/library_wide.hpp>
 using namespace std;
 using namespace utils;
 
@@ -34,6 +38,9 @@ namespace compression
     static const uint32_t PX_MAX_MATCH_SEQLEN     = 18u; //The longest sequence of similar bytes we can use!
     static const uint32_t PX_MIN_MATCH_SEQLEN     = 3u; //The shortest sequence of similar bytes we can use!
     static const uint32_t PX_NB_POSSIBLE_SEQ_LEN  = 7u; // The nb of unique lengths we can use when copying a sequence. This is due to ctrl flags taking over a part of the value range between 0x0 and 0xF
+    static const uint32_t PX_MATCH_HASH_BITS      = 15u; //Nb of bits of the hash used to index 3 bytes sequences in the match finder's hash chains.
+    static const uint32_t PX_MATCH_HASH_SIZE      = (1u << PX_MATCH_HASH_BITS);
+    static const uint32_t PX_MATCH_NO_POS         = std::numeric_limits<uint32_t>::max(); //Marks the end of a hash chain
 
 
 //=========================================
@@ -174,6 +181,13 @@ namespace compression
                                  bool                      shouldsearchfirst  = false, 
                                  multistep_completion<2> * pTotalBytesHandled = nullptr );
 
+        /*********************************************************************************
+            Rebind
+                Points the compressor to a new input range and output iterator, so it can
+                be reused for another compression without freeing its internal buffers.
+        *********************************************************************************/
+        void Rebind( inIterRand_t itinbeg, inIterRand_t itinend, outIter_t itout );
+
     private:
     //-------------------------------------------------------------
     // Compression Methods px_compressor
@@ -192,6 +206,28 @@ namespace compression
         *********************************************************************************/
         compOp DetermineBestOperation( ePXCompLevel compressionlvl, bool shouldsearchfirst, uint64_t * pTotalBytesHandled );
 
+        /*********************************************************************************
+            ParseOptimal
+                Used for LEVEL_4. Instead of picking operations greedily, find the 
+                sequence of operations producing the smallest output for the whole input.
+                It also picks the sequence lengths to reserve, and thus the ctrl flags, 
+                based on what lengths the whole input would benefit the most from.
+
+                Fills m_PendingOperations and m_highNybbleLenghtsPossible.
+        *********************************************************************************/
+        void ParseOptimal( atomic<uint8_t> * pPercentDone );
+
+        /*********************************************************************************
+            ComputeOptimalParse
+                Finds the cheapest way to encode the input, counting command bytes, 
+                using only the sequence lengths whose high nybble bit is set in 
+                "allowedlenmask". Outputs the nb of bytes consumed by each operation.
+        *********************************************************************************/
+        uint32_t ComputeOptimalParse( uint16_t                 allowedlenmask, 
+                                      const vector<uint8_t>  & longestmatches, 
+                                      const vector<compOp>   & nybbleops,
+                                      vector<uint8_t>        & out_advances );
+
         /*********************************************************************************
             CanCompressTo2In1Byte
                 Check whether the 2 bytes at "itcurbyte" can be stored as a single byte.
@@ -231,6 +267,43 @@ namespace compression
                                                       inIterRand_t ittofindend,
                                                       uint32_t     sequencelenght );
 
+        /*********************************************************************************
+            FindLongestMatchingSequenceHashChain
+                Same as FindLongestMatchingSequence, but only visits the positions within
+                the lookback buffer whose first PX_MIN_MATCH_SEQLEN bytes hash the same as 
+                the sequence to find, instead of searching the whole lookback buffer.
+
+                Positions are visited from the oldest to the most recent, and ties are 
+                resolved the same way, so the result is identical to the linear search!
+
+                - lookbackbeg : Offset from the beginning of the input of the first byte
+                                of the lookback buffer.
+                - tofindbeg   : Beginning of the sequence to find. Must be m_itInCur.
+                - tofindend   : End of the sequence to find.
+        *********************************************************************************/
+        matchingsequence FindLongestMatchingSequenceHashChain( uint32_t     lookbackbeg,
+                                                               inIterRand_t ittofindbeg,
+                                                               inIterRand_t ittofindend );
+
+        /*********************************************************************************
+            IndexSequencesUpTo
+                Add all the positions before "offsetend" to the hash chains, as long as 
+                they're the beginning of a PX_MIN_MATCH_SEQLEN bytes long sequence.
+        *********************************************************************************/
+        void IndexSequencesUpTo( uint32_t offsetend );
+
+        /*********************************************************************************
+            HashSequenceAt
+                Returns the hash chain index for the PX_MIN_MATCH_SEQLEN bytes at "itbyte".
+        *********************************************************************************/
+        static inline uint32_t HashSequenceAt( inIterRand_t itbyte )
+        {
+            const uint32_t key = static_cast<uint32_t>(static_cast<uint8_t>(itbyte[0]))         | 
+                                 (static_cast<uint32_t>(static_cast<uint8_t>(itbyte[1])) << 8)  | 
+                                 (static_cast<uint32_t>(static_cast<uint8_t>(itbyte[2])) << 16);
+            return (key * 2654435761u) >> (32u - PX_MATCH_HASH_BITS);
+        }
+
         /*********************************************************************************
             Because the length is stored as the high nybble in the compressed output, and 
             that the high nybble also contains the ctrl flags, we need to make sure the 
@@ -301,6 +374,13 @@ namespace compression
         //List of operations to apply. Stored here, because we compute our ctrl flags at the end
         deque<compOp>                   m_PendingOperations;
 
+        //Hash chains used to find matching sequences in the lookback buffer.
+        // Each chain links positions in the input sharing the same hash, from the oldest to the most recent.
+        vector<uint32_t>                 m_matchNext;       //Next position in the same chain, for each input position
+        vector<uint32_t>                 m_matchFirst;      //Oldest position still within the lookback buffer, for each chain
+        vector<uint32_t>                 m_matchLast;       //Most recent position, for each chain
+        uint32_t                         m_matchNbIndexed;  //Nb of input positions added to the chains so far
+
         //Data gathered during compression to be used later for building the header
         px_info_header                   m_compressioninfo;
 
@@ -397,17 +477,17 @@ namespace compression
 //=========================================
     /*********************************************************************************
         Compute4NybblesPattern
-            This returns a container with 2 bytes/4 nybbles in it.
+            Writes the 2 bytes/4 nybbles pattern to the 2 bytes at out_the2bytes.
+            Doesn't allocate anything, so its cheap enough to call for every pattern 
+            the fast path decompresses.
     *********************************************************************************/
-    vector<uint8_t> Compute4NybblesPattern( uint8_t indexControlFlag, uint8_t ctrlLowNybble )
+    inline void Compute4NybblesPattern( uint8_t indexControlFlag, uint8_t ctrlLowNybble, uint8_t * out_the2bytes )
     {
-        vector<uint8_t> out_the2bytes(2,0);
-
         if( indexControlFlag == 0 )
         {
             //#In this case, all our 4 nybbles have the value of the "ctrlLowNybble" as their value
             // Since we're dealing with half bytes, shift one left by 4 and bitwise OR it with the other!
-            fill( out_the2bytes.begin(), out_the2bytes.end(), ( (ctrlLowNybble<<4) | ctrlLowNybble ) );
+            out_the2bytes[0] = out_the2bytes[1] = static_cast<uint8_t>( (ctrlLowNybble<<4) | ctrlLowNybble );
         }
         else 
         {
@@ -424,8 +504,7 @@ namespace compression
                 --nybbleval;
 
             //#2 - Build our individual nybble list, just for convenience.
-            array<uint8_t,4> the4nybbles;
-            fill( the4nybbles.begin(), the4nybbles.end(), nybbleval );
+            uint8_t the4nybbles[4] = { nybbleval, nybbleval, nybbleval, nybbleval };
 
             //#3 - If the ctrl flag index fits between those values either 
             //     decrement or increment a specific nybble!
@@ -435,13 +514,165 @@ namespace compression
                 the4nybbles[ indexControlFlag - 5 ] += 1; //increment this particuliar nybble. (substract by 5 to get a 0-3 index)
 
             //#4 - We output everything to our output container
-            out_the2bytes[0] = ( (the4nybbles[0] << 4) | the4nybbles[1] );
-            out_the2bytes[1] = ( (the4nybbles[2] << 4) | the4nybbles[3] );
+            out_the2bytes[0] = static_cast<uint8_t>( (the4nybbles[0] << 4) | the4nybbles[1] );
+            out_the2bytes[1] = static_cast<uint8_t>( (the4nybbles[2] << 4) | the4nybbles[3] );
         }
+    }
 
+    /*********************************************************************************
+        Compute4NybblesPattern
+            This returns a container with 2 bytes/4 nybbles in it.
+    *********************************************************************************/
+    vector<uint8_t> Compute4NybblesPattern( uint8_t indexControlFlag, uint8_t ctrlLowNybble )
+    {
+        vector<uint8_t> out_the2bytes(2,0);
+        Compute4NybblesPattern( indexControlFlag, ctrlLowNybble, out_the2bytes.data() );
         return std::move(out_the2bytes);
     }
 
+    /*********************************************************************************
+        px_ctrlflag_table
+            Lookup table built once per decompression from the ctrl flags. 
+            For every possible high nybble of the byte following a 0 bit in a command 
+            byte, it gives the index of the matching ctrl flag, or -1 if there's none.
+            The pattern itself is only computed when one is output.
+    *********************************************************************************/
+    typedef array<int8_t,16> px_ctrlflag_table;
+
+    /*********************************************************************************
+        BuildPXCtrlFlagTable
+            If the same flag value appears more than once, the first index wins, 
+            just like when searching the flag list.
+    *********************************************************************************/
+    inline void BuildPXCtrlFlagTable( const px_info_header & info, px_ctrlflag_table & out_table )
+    {
+        out_table.fill(-1);
+        for( int8_t flagindex = static_cast<int8_t>(px_info_header::NB_FLAGS) - 1; flagindex >= 0; --flagindex )
+        {
+            if( info.controlflags[flagindex] < out_table.size() ) //A flag above 0xF can't match a nybble
+                out_table[info.controlflags[flagindex]] = flagindex;
+        }
+    }
+
+    /*********************************************************************************
+        DecompressPXRaw
+            Fast path for decompressing contiguous buffers, used whenever logging is 
+            disabled. 
+            
+            Whenever there's enough input and output left for the 8 operations of a 
+            command byte, those are run without any bounds checks, and sequences are 
+            copied 8 bytes at a time when they don't overlap within a single copy. 
+            Otherwise, near the end of the buffers, every operations is checked.
+    *********************************************************************************/
+    void DecompressPXRaw( const px_info_header & info, 
+                          const uint8_t        * pin, 
+                          const uint8_t        * pinend, 
+                          uint8_t              * pout, 
+                          uint8_t              * poutend )
+    {
+        static const ptrdiff_t MaxInputPerCmdByte  = 8 * 2;                             //At most 2 bytes per operation
+        static const ptrdiff_t MaxOutputPerCmdByte = 8 * PX_MAX_MATCH_SEQLEN + 8;       //Add room for the last wide copy overshooting
+        static const ptrdiff_t WideCopyLen         = 8;
+
+        px_ctrlflag_table table;
+        BuildPXCtrlFlagTable( info, table );
+
+        uint8_t * const poutbeg = pout;
+
+        //Returns the position to copy a sequence from, after making sure its within what we decompressed so far
+        auto lambdaSeqSource = [poutbeg]( const uint8_t * pcur, uint8_t opbyte, uint8_t nextbyte )->const uint8_t *
+        {
+            const ptrdiff_t distance = 0x1000 - ( ((opbyte & 0x0F) << 8) | nextbyte );
+            if( (pcur - poutbeg) < distance )
+            {
+                stringstream strserror;
+                strserror <<"DecompressPX(): Sequence to copy out of bound! Tried to copy from " <<distance 
+                          <<" bytes back, with only " <<(pcur - poutbeg) <<" bytes decompressed so far!\n"
+                          <<"The data to decompress is probably not valid PX compressed data!";
+                throw std::runtime_error(strserror.str());
+            }
+            return pcur - distance;
+        };
+
+        while( pin < pinend && pout < poutend )
+        {
+            uint8_t cmdbyte = *(pin++);
+
+            if( (pinend - pin) >= MaxInputPerCmdByte && (poutend - pout) >= MaxOutputPerCmdByte )
+            {
+                //Fast path, no bounds checks needed for this command byte
+                for( int i = 0; i < 8; ++i, cmdbyte <<= 1 )
+                {
+                    if( cmdbyte & 0x80 )
+                    {
+                        *(pout++) = *(pin++);
+                        continue;
+                    }
+
+                    const uint8_t opbyte    = *(pin++);
+                    const int8_t  flagindex = table[opbyte >> 4];
+                    if( flagindex >= 0 )
+                    {
+                        Compute4NybblesPattern( static_cast<uint8_t>(flagindex), opbyte & 0x0F, pout );
+                        pout += 2;
+                    }
+                    else
+                    {
+                        const uint8_t * psrc = lambdaSeqSource( pout, opbyte, *(pin++) );
+                        const ptrdiff_t len  = (opbyte >> 4) + PX_MIN_MATCH_SEQLEN;
+
+                        if( (pout - psrc) >= WideCopyLen )
+                        {
+                            //Each chunk only reads bytes that were already written
+                            for( ptrdiff_t cnt = 0; cnt < len; cnt += WideCopyLen )
+                                std::memcpy( pout + cnt, psrc + cnt, WideCopyLen );
+                        }
+                        else
+                        {
+                            for( ptrdiff_t cnt = 0; cnt < len; ++cnt )
+                                pout[cnt] = psrc[cnt];
+                        }
+                        pout += len;
+                    }
+                }
+            }
+            else
+            {
+                //Near the end, check everything
+                for( int i = 0; i < 8 && pin < pinend && pout < poutend; ++i, cmdbyte <<= 1 )
+                {
+                    if( cmdbyte & 0x80 )
+                    {
+                        *(pout++) = *(pin++);
+                        continue;
+                    }
+
+                    const uint8_t opbyte    = *(pin++);
+                    const int8_t  flagindex = table[opbyte >> 4];
+                    if( flagindex >= 0 )
+                    {
+                        uint8_t         the2bytes[2];
+                        const ptrdiff_t len = std::min<ptrdiff_t>( 2, poutend - pout );
+                        Compute4NybblesPattern( static_cast<uint8_t>(flagindex), opbyte & 0x0F, the2bytes );
+                        std::memcpy( pout, the2bytes, len );
+                        pout += len;
+                    }
+                    else
+                    {
+                        if( pin == pinend )
+                            throw std::runtime_error("DecompressPX(): Compressed data ends in the middle of a sequence copy operation!");
+
+                        const uint8_t * psrc = lambdaSeqSource( pout, opbyte, *(pin++) );
+                        const ptrdiff_t len  = std::min<ptrdiff_t>( (opbyte >> 4) + PX_MIN_MATCH_SEQLEN, poutend - pout );
+                        for( ptrdiff_t cnt = 0; cnt < len; ++cnt )
+                            pout[cnt] = psrc[cnt];
+                        pout += len;
+                    }
+                }
+            }
+        }
+    }
+
 //=========================================
 // Decompressor Definitions
 //=========================================
@@ -666,7 +897,7 @@ namespace compression
                                                              bool              blogenabled )
         :m_pCompressedData(&out_compresseddata), m_itInBeg(itinbeg), m_itInCur(itinbeg), m_itInEnd(itinend),
         m_highNybbleLenghtsPossible(PX_NB_POSSIBLE_SEQ_LEN,0), m_inputSize(0), m_bLoggingEnabled(blogenabled),
-        m_nbCompressedByteWritten(0), m_itOutCur(vector<uint8_t>())
+        m_nbCompressedByteWritten(0), m_itOutCur(vector<uint8_t>()), m_matchNbIndexed(0)
     {
         m_inputSize = std::distance(itinbeg, itinend);
 
@@ -716,7 +947,7 @@ namespace compression
                                                              bool          blogenabled )
         :m_pCompressedData(nullptr), m_itInBeg(itinbeg), m_itInCur(itinbeg), m_itInEnd(itinend),
         m_highNybbleLenghtsPossible(PX_NB_POSSIBLE_SEQ_LEN,0), m_inputSize(0), m_bLoggingEnabled(blogenabled),
-        m_itOutCur(itout), m_nbCompressedByteWritten(0)
+        m_itOutCur(itout), m_nbCompressedByteWritten(0), m_matchNbIndexed(0)
     {
         //Resize to zero to allow pushbacks, and preserve allocation
         m_highNybbleLenghtsPossible.resize(0);
@@ -727,6 +958,22 @@ namespace compression
         //    m_mylog.open(PX_COMPRESSION_LOGFILE_NAME);
     }
 
+    /*********************************************************************************
+        Rebind
+    *********************************************************************************/
+    template<class _inRandit, class _outit>
+        void px_compressor<_inRandit,_outit>::Rebind( inIterRand_t itinbeg, inIterRand_t itinend, outIter_t itout )
+    {
+        m_pCompressedData         = nullptr;
+        m_itInBeg                 = itinbeg;
+        m_itInCur                 = itinbeg;
+        m_itInEnd                 = itinend;
+        m_itOutCur                = itout;
+        m_nbCompressedByteWritten = 0;
+        m_compressioninfo         = px_info_header();
+        m_PendingOperations.resize(0);
+    }
+
     /*********************************************************************************
         Compress
     *********************************************************************************/
@@ -760,6 +1007,12 @@ namespace compression
         //Resets those
         m_highNybbleLenghtsPossible.resize(0);
 
+        //Reset the match finder
+        m_matchNext.assign( m_inputSize, PX_MATCH_NO_POS );
+        m_matchFirst.assign( PX_MATCH_HASH_SIZE, PX_MATCH_NO_POS );
+        m_matchLast.assign( PX_MATCH_HASH_SIZE, PX_MATCH_NO_POS );
+        m_matchNbIndexed = 0;
+
         //Setup the output iterators
         //m_itOutBeg = m_compresseddata.begin();
         //m_itOutCur = m_itOutBeg;
@@ -772,13 +1025,20 @@ namespace compression
         m_highNybbleLenghtsPossible.push_back(0xF); //We want 0xF !
 
         //Do compression
-        uint64_t nbBytesHandled=0;
-
-        while( HandleABlock( compressionlvl, &nbBytesHandled, shouldsearchfirst ) )
+        if( compressionlvl >= ePXCompLevel::LEVEL_4 )
         {
-            //Update progress
-            if( pTotalBytesHandled != nullptr )
-                pTotalBytesHandled->steps[0] = static_cast<uint8_t>((nbBytesHandled * 100ul) / m_inputSize);
+            ParseOptimal( (pTotalBytesHandled != nullptr)? &(pTotalBytesHandled->steps[0]) : nullptr );
+        }
+        else
+        {
+            uint64_t nbBytesHandled=0;
+
+            while( HandleABlock( compressionlvl, &nbBytesHandled, shouldsearchfirst ) )
+            {
+                //Update progress
+                if( pTotalBytesHandled != nullptr )
+                    pTotalBytesHandled->steps[0] = static_cast<uint8_t>((nbBytesHandled * 100ul) / m_inputSize);
+            }
         }
 
         //Build control flag table, now that we determined all our string search lengths !
@@ -881,6 +1141,185 @@ namespace compression
         return myoperation;
     }
 
+    /*********************************************************************************
+        ParseOptimal
+            Used for LEVEL_4. Find the sequence of operations producing the smallest 
+            output for the whole input, and pick the sequence lengths to reserve.
+    *********************************************************************************/
+    template<class _inRandit, class _outRandit>
+        void px_compressor<_inRandit,_outRandit>::ParseOptimal( atomic<uint8_t> * pPercentDone )
+    {
+        const uint32_t inputsz = static_cast<uint32_t>(m_inputSize);
+
+        //#1 - Find what operations are possible at every single positions. 
+        //     Only the longest matching sequence matters, since any shorter length can be copied from the same offset.
+        vector<uint8_t>  longestmatches( inputsz, 0 );
+        vector<uint16_t> matchoffsets  ( inputsz, 0 );
+        vector<compOp>   nybbleops     ( inputsz );
+
+        for( uint32_t i = 0; i < inputsz; ++i )
+        {
+            inIterRand_t itcur = m_itInBeg + i;
+            compOp       nybop;
+            nybop.reset();
+            if( !CanCompressTo2In1Byte( itcur, nybop ) && !CanCompressTo2In1ByteWithManipulation( itcur, nybop ) )
+                nybop.reset();
+            nybbleops[i] = nybop;
+
+            inIterRand_t itseqend = advAsMuchAsPossible( itcur, m_itInEnd, PX_MAX_MATCH_SEQLEN );
+            if( static_cast<uint32_t>(distance( itcur, itseqend )) >= PX_MIN_MATCH_SEQLEN )
+            {
+                uint32_t         lbbeg  = (i > PX_LOOKBACK_BUFFER_SIZE)? i - PX_LOOKBACK_BUFFER_SIZE : 0;
+                matchingsequence result = FindLongestMatchingSequenceHashChain( lbbeg, itcur, itseqend );
+                if( result.length >= PX_MIN_MATCH_SEQLEN )
+                {
+                    longestmatches[i] = static_cast<uint8_t> (result.length);
+                    matchoffsets[i]   = static_cast<uint16_t>(distance( result.itpos, itcur ));
+                }
+            }
+
+            if( pPercentDone != nullptr )
+                (*pPercentDone) = static_cast<uint8_t>( (static_cast<uint64_t>(i) * 80u) / inputsz );
+        }
+
+        //#2 - Parse once allowing every lengths, and count how often the optimal parse would use each of them.
+        vector<uint8_t> advances;
+        ComputeOptimalParse( 0xFFFF, longestmatches, nybbleops, advances );
+
+        array<uint32_t,16> lencounts;
+        lencounts.fill(0);
+        for( auto adv : advances )
+        {
+            if( adv >= PX_MIN_MATCH_SEQLEN )
+                ++lencounts[adv - PX_MIN_MATCH_SEQLEN];
+        }
+
+        //#3 - Reserve the PX_NB_POSSIBLE_SEQ_LEN most used lengths. Ties go to the smallest value.
+        array<uint8_t,16> lenbyuse;
+        std::iota( lenbyuse.begin(), lenbyuse.end(), 0 );
+        std::stable_sort( lenbyuse.begin(), lenbyuse.end(), [&lencounts]( uint8_t a, uint8_t b ){ return lencounts[a] > lencounts[b]; } );
+
+        m_highNybbleLenghtsPossible.assign( lenbyuse.begin(), lenbyuse.begin() + PX_NB_POSSIBLE_SEQ_LEN );
+        std::sort( m_highNybbleLenghtsPossible.begin(), m_highNybbleLenghtsPossible.end() );
+
+        uint16_t allowedlenmask = 0;
+        for( auto hnybble : m_highNybbleLenghtsPossible )
+            allowedlenmask |= (1 << hnybble);
+
+        //#4 - Parse again with only the reserved lengths
+        ComputeOptimalParse( allowedlenmask, longestmatches, nybbleops, advances );
+        if( pPercentDone != nullptr )
+            (*pPercentDone) = 95;
+
+        //#5 - Turn the parse into operations
+        uint32_t pos = 0;
+        for( auto adv : advances )
+        {
+            compOp myoperation;
+            myoperation.reset();
+
+            if( adv == 1 )
+            {
+                myoperation.type       = ePXOperation::COPY_ASIS;
+                myoperation.highnybble = (m_itInBeg[pos] >> 4) & 0x0F;
+                myoperation.lownybble  = (m_itInBeg[pos])      & 0x0F;
+            }
+            else if( adv == 2 )
+            {
+                myoperation = nybbleops[pos];
+            }
+            else
+            {
+                int16_t signedoffset = -static_cast<int16_t>(matchoffsets[pos]);
+                myoperation.lownybble     = static_cast<uint8_t>(( signedoffset >> 8 ) & 0x0F);
+                myoperation.nextbytevalue = static_cast<uint8_t>(signedoffset          & 0xFF);
+                myoperation.highnybble    = static_cast<uint8_t>(adv - PX_MIN_MATCH_SEQLEN);
+                myoperation.type          = ePXOperation::COPY_SEQUENCE;
+            }
+
+            m_PendingOperations.push_back(myoperation);
+            pos += adv;
+        }
+        m_itInCur = m_itInEnd;
+
+        if( pPercentDone != nullptr )
+            (*pPercentDone) = 100;
+    }
+
+    /*********************************************************************************
+        ComputeOptimalParse
+            Dynamic programming over (position, nb of operations modulo 8). The modulo
+            is needed to account exactly for the command byte output every 8 operations.
+    *********************************************************************************/
+    template<class _inRandit, class _outRandit>
+        uint32_t px_compressor<_inRandit,_outRandit>::ComputeOptimalParse( uint16_t                 allowedlenmask, 
+                                                                           const vector<uint8_t>  & longestmatches, 
+                                                                           const vector<compOp>   & nybbleops,
+                                                                           vector<uint8_t>        & out_advances )
+    {
+        static const uint32_t NbStates = 8;
+        static const uint32_t NoCost   = std::numeric_limits<uint32_t>::max();
+        const uint32_t        inputsz  = static_cast<uint32_t>(longestmatches.size());
+
+        vector<uint32_t> costs   ( (inputsz + 1) * NbStates, NoCost );
+        vector<uint8_t>  advances( (inputsz + 1) * NbStates, 0 ); //Nb of bytes consumed by the last operation to reach a state
+        costs[0] = 0;
+
+        for( uint32_t i = 0; i < inputsz; ++i )
+        {
+            for( uint32_t k = 0; k < NbStates; ++k )
+            {
+                const uint32_t curcost = costs[i * NbStates + k];
+                if( curcost == NoCost )
+                    continue;
+
+                //A new command byte is needed before every 8 operations
+                const uint32_t cmdbytecost = (k == 0)? 1 : 0;
+                const uint32_t nextstate   = (k + 1) % NbStates;
+
+                auto lambdaRelax = [&]( uint32_t adv, uint32_t opcost )
+                {
+                    uint32_t & dest = costs[(i + adv) * NbStates + nextstate];
+                    if( curcost + opcost + cmdbytecost < dest )
+                    {
+                        dest = curcost + opcost + cmdbytecost;
+                        advances[(i + adv) * NbStates + nextstate] = static_cast<uint8_t>(adv);
+                    }
+                };
+
+                lambdaRelax( 1, 1 );
+
+                if( nybbleops[i].type != ePXOperation::COPY_ASIS )
+                    lambdaRelax( 2, 1 );
+
+                for( uint32_t len = PX_MIN_MATCH_SEQLEN; len <= longestmatches[i]; ++len )
+                {
+                    if( allowedlenmask & (1 << (len - PX_MIN_MATCH_SEQLEN)) )
+                        lambdaRelax( len, 2 );
+                }
+            }
+        }
+
+        //Pick the cheapest final state, and walk back
+        uint32_t beststate = 0;
+        for( uint32_t k = 1; k < NbStates; ++k )
+        {
+            if( costs[inputsz * NbStates + k] < costs[inputsz * NbStates + beststate] )
+                beststate = k;
+        }
+
+        out_advances.resize(0);
+        for( uint32_t pos = inputsz, k = beststate; pos > 0; k = (k + NbStates - 1) % NbStates )
+        {
+            uint8_t adv = advances[pos * NbStates + k];
+            out_advances.push_back(adv);
+            pos -= adv;
+        }
+        std::reverse( out_advances.begin(), out_advances.end() );
+
+        return costs[inputsz * NbStates + beststate];
+    }
+
     /*********************************************************************************
         CanCompressTo2In1Byte
             Check whether the 2 bytes at "itcurbyte" can be stored as a single byte.
@@ -1043,6 +1482,78 @@ namespace compression
     }
 
 
+    /*********************************************************************************
+        IndexSequencesUpTo
+            Add all the positions before "offsetend" to the hash chains, as long as 
+            they're the beginning of a PX_MIN_MATCH_SEQLEN bytes long sequence.
+    *********************************************************************************/
+    template<class _inRandit, class _outRandit>
+        void px_compressor<_inRandit,_outRandit>::IndexSequencesUpTo( uint32_t offsetend )
+    {
+        for( ; m_matchNbIndexed < offsetend; ++m_matchNbIndexed )
+        {
+            const uint32_t hash = HashSequenceAt( m_itInBeg + m_matchNbIndexed );
+
+            if( m_matchLast[hash] == PX_MATCH_NO_POS )
+                m_matchFirst[hash] = m_matchNbIndexed;
+            else
+                m_matchNext[m_matchLast[hash]] = m_matchNbIndexed;
+            m_matchLast[hash] = m_matchNbIndexed;
+        }
+    }
+
+    /*********************************************************************************
+        FindLongestMatchingSequenceHashChain
+            Walks the hash chain for the sequence at "tofindbeg", from the oldest 
+            position within the lookback buffer to the most recent one.
+    *********************************************************************************/
+    template<class _inRandit, class _outRandit>
+        typename px_compressor<_inRandit,_outRandit>::matchingsequence px_compressor<_inRandit,_outRandit>::FindLongestMatchingSequenceHashChain( uint32_t     lookbackbeg,
+                                                                                                                                                inIterRand_t tofindbeg,
+                                                                                                                                                inIterRand_t tofindend )
+    {
+        const uint32_t   curoffset    = static_cast<uint32_t>( distance( m_itInBeg, tofindbeg ) );
+        const uint32_t   tofindlen    = static_cast<uint32_t>( distance( tofindbeg, tofindend ) );
+        matchingsequence longestmatch = { tofindbeg, 0 };
+
+        //Only sequences that end before the current position can be matched, just like with the linear search
+        if( curoffset >= PX_MIN_MATCH_SEQLEN )
+            IndexSequencesUpTo( curoffset - PX_MIN_MATCH_SEQLEN + 1 );
+
+        //Drop the positions that slid out of the lookback buffer. Since the lookback buffer only moves forward, we won't need them again.
+        const uint32_t hash = HashSequenceAt( tofindbeg );
+        uint32_t     & first = m_matchFirst[hash];
+        while( first != PX_MATCH_NO_POS && first < lookbackbeg )
+            first = m_matchNext[first];
+        if( first == PX_MATCH_NO_POS )
+            m_matchLast[hash] = PX_MATCH_NO_POS;
+
+        for( uint32_t pos = first; pos != PX_MATCH_NO_POS; pos = m_matchNext[pos] )
+        {
+            //Skip hash collisions
+            inIterRand_t itpos = m_itInBeg + pos;
+            if( itpos[0] != tofindbeg[0] || itpos[1] != tofindbeg[1] || itpos[2] != tofindbeg[2] )
+                continue;
+
+            //Can't match past the current position
+            const uint32_t maxlen    = std::min( std::min( PX_MAX_MATCH_SEQLEN, curoffset - pos ), tofindlen );
+            uint32_t       nbmatches = PX_MIN_MATCH_SEQLEN;
+            while( nbmatches < maxlen && itpos[nbmatches] == tofindbeg[nbmatches] )
+                ++nbmatches;
+
+            if( longestmatch.length < nbmatches )
+            {
+                longestmatch.length = nbmatches;
+                longestmatch.itpos  = itpos;
+            }
+
+            if( nbmatches == PX_MAX_MATCH_SEQLEN )
+                break;
+        }
+
+        return longestmatch;
+    }
+
     /*********************************************************************************
         CanUseAMatchingSequence
             Search through the lookback buffer for a string of bytes that matches the 
@@ -1070,7 +1581,12 @@ namespace compression
         if( curSeqLen < PX_MIN_MATCH_SEQLEN ) 
             return false;
 
-        matchingsequence result = FindLongestMatchingSequence( itLookBackBeg, itLookBackEnd, itSequenceBeg, itSequenceEnd, curSeqLen );
+        matchingsequence result = FindLongestMatchingSequenceHashChain( lbBufferBeg, itSequenceBeg, itSequenceEnd );
+#ifdef PX_VERIFY_MATCHFINDER
+        //Make sure the hash chains give the exact same result as the slow linear search
+        matchingsequence verif = FindLongestMatchingSequence( itLookBackBeg, itLookBackEnd, itSequenceBeg, itSequenceEnd, curSeqLen );
+        assert( verif.length == result.length && (verif.length < PX_MIN_MATCH_SEQLEN || verif.itpos == result.itpos) );
+#endif
 
         if( result.length >= PX_MIN_MATCH_SEQLEN )
         {
@@ -1215,7 +1731,7 @@ namespace compression
         // We only have 16 possible values to contain lengths and control flags..
         array<uint8_t,9>::iterator itctrlflaginsert = m_compressioninfo.controlflags.begin(); //Pos to insert a ctrl flag at
 
-        for( uint8_t flagval = 0; flagval < 0xF; ++flagval )
+        for( uint8_t flagval = 0; flagval <= 0xF; ++flagval )
         {
             auto itfound = find( m_highNybbleLenghtsPossible.begin(), m_highNybbleLenghtsPossible.end(), flagval );
             if( itfound == m_highNybbleLenghtsPossible.end() )
@@ -1330,6 +1846,16 @@ namespace compression
             throw std::runtime_error( sstr.str() );
         }
 
+        if( !blogenabled )
+        {
+            DecompressPXRaw( info, 
+                             itdatabeg == itdataend? nullptr : &(*itdatabeg), 
+                             itdatabeg == itdataend? nullptr : &(*itdatabeg) + distance(itdatabeg, itdataend), 
+                             out_decompresseddata.data(), 
+                             out_decompresseddata.data() + out_decompresseddata.size() );
+            return;
+        }
+
         //Create our state
         px_decompressor<std::vector<uint8_t>::const_iterator, std::vector<uint8_t>::iterator>
                         ( itdatabeg, 
@@ -1357,6 +1883,16 @@ namespace compression
             throw std::runtime_error( sstr.str() );
         }
 
+        if( !blogenabled )
+        {
+            DecompressPXRaw( info, 
+                             itdatabeg == itdataend? nullptr : &(*itdatabeg), 
+                             itdatabeg == itdataend? nullptr : &(*itdatabeg) + distance(itdatabeg, itdataend), 
+                             itoutbeg  == itoutend?  nullptr : &(*itoutbeg), 
+                             itoutbeg  == itoutend?  nullptr : &(*itoutbeg) + diff );
+            return;
+        }
+
         //Create our state
         px_decompressor<std::vector<uint8_t>::const_iterator, std::vector<uint8_t>::iterator>
                         ( itdatabeg, 
@@ -1367,6 +1903,23 @@ namespace compression
                           blogenabled ).DecompressPX(); //Run right after construction, we don't use it afterwards anyways
     }
 
+    void DecompressPX( px_info_header                         info, 
+                       const uint8_t                        * pdatabeg, 
+                       const uint8_t                        * pdataend, 
+                       uint8_t                              * poutbeg, 
+                       uint8_t                              * poutend )
+    {
+        auto diff = poutend - poutbeg;
+        if(info.decompressedsz != diff ) //Those must be the same size !
+        {
+            stringstream sstr;
+            sstr << "DecompressPX() : The output buffer is not of the expected size! Current buffer size : "
+                 << diff << " bytes, expected " <<info.decompressedsz <<" bytes!";
+            throw std::runtime_error( sstr.str() );
+        }
+        DecompressPXRaw( info, pdatabeg, pdataend, poutbeg, poutend );
+    }
+
     /*********************************************************************************
         CompressPX
     *********************************************************************************/
@@ -1531,6 +2084,86 @@ namespace compression
 
 
 
+    /*********************************************************************************
+        CompressPXBatch
+    *********************************************************************************/
+    std::vector<px_info_header> CompressPXBatch( const std::vector<px_inrange_t>     & inputs,
+                                                 std::vector<std::vector<uint8_t>>   & out_compresseddata,
+                                                 ePXCompLevel                          compressionlvl,
+                                                 bool                                  bZealousSearch,
+                                                 bool                                  displayprogress,
+                                                 size_t                                headerreservesz )
+    {
+        typedef px_compressor<vector<uint8_t>::const_iterator, back_insert_iterator<vector<uint8_t>>> batchcompressor_t;
+
+        vector<px_info_header> results(inputs.size());
+        atomic<size_t>         nextinput(0);
+        atomic<size_t>         nbcompleted(0);
+        atomic<bool>           shouldabort(false);
+        mutex                  mtxprogress;
+        exception_ptr          firstexception;
+        size_t                 lastpercent = 0;
+
+        out_compresseddata.resize(inputs.size());
+
+        //Each threads grabs the next range nobody's working on, until there are none left
+        auto lambdaWorker = [&]()
+        {
+            vector<uint8_t>   dummy;
+            batchcompressor_t compressor( dummy.cbegin(), dummy.cend(), back_inserter(dummy), false ); //Reused for all the ranges this thread handles
+
+            for( size_t i = nextinput++; i < inputs.size() && !shouldabort; i = nextinput++ )
+            {
+                try
+                {
+                    vector<uint8_t> & outdata = out_compresseddata[i];
+                    size_t            inputsz = distance( inputs[i].first, inputs[i].second );
+                    outdata.reserve( headerreservesz + inputsz + (inputsz / 8u) + 1 );
+                    outdata.resize( headerreservesz );
+
+                    compressor.Rebind( inputs[i].first, inputs[i].second, back_inserter(outdata) );
+                    results[i] = compressor.Compress( compressionlvl, bZealousSearch );
+                }
+                catch(...)
+                {
+                    lock_guard<mutex> lck(mtxprogress);
+                    if( !firstexception )
+                        firstexception = current_exception();
+                    shouldabort = true;
+                }
+
+                size_t nbdone = ++nbcompleted;
+                if( displayprogress )
+                {
+                    lock_guard<mutex> lck(mtxprogress);
+                    size_t percent = (nbdone * 100) / inputs.size();
+                    if( percent != lastpercent || nbdone == inputs.size() )
+                    {
+                        lastpercent = percent;
+                        cout <<"\r" <<setw(3) <<setfill(' ') <<percent <<"%";
+                        cout.flush();
+                    }
+                }
+            }
+        };
+
+        //The calling thread works too, so only spawn the extra threads needed
+        size_t         nbthreads = std::max( 1u, std::min( utils::LibWide().getNbThreadsToUse(), static_cast<unsigned int>(inputs.size()) ) );
+        vector<thread> workers;
+        for( size_t i = 1; i < nbthreads; ++i )
+            workers.push_back( thread(lambdaWorker) );
+
+        lambdaWorker();
+
+        for( auto & worker : workers )
+            worker.join();
+
+        if( firstexception )
+            rethrow_exception(firstexception);
+
+        return std::move(results);
+    }
+
     /*********************************************************************************
         CleanExistingCompressionLogs
     *********************************************************************************/
@@ -13,6 +13,9 @@ Description: Utilities for dealing with what we've dubbed "PX" compression. A cu
 #include <cstdint>
 #include <array>
 #include <vector>
+#include <string>
+#include <stdexcept>
+#include <utility>
 
 namespace compression
 {
@@ -34,6 +37,7 @@ namespace compression
         LEVEL_1,    // Low compression    - We handle 4 byte patterns, using only ctrl flag 0 
         LEVEL_2,    // Medium compression - We handle 4 byte patterns, using all control flags
         LEVEL_3,    // Full compression   - We handle everything above, along with repeating sequences of bytes already decompressed.
+        LEVEL_4,    // Optimal compression- Same operations as above, but picks the combination of them that results in the smallest output. Slower.
     };
 
 //=========================================
@@ -123,6 +127,17 @@ namespace compression
                        std::vector<uint8_t>::iterator         itoutend, 
                        bool                                   blogenabled = false );
 
+    /*
+        DecompressPX
+            Same as above, but for data in raw memory, like a memory mapped file.
+            The output range must be exactly info.decompressedsz bytes long. Never writes a log.
+    */
+    void DecompressPX( px_info_header                         info, 
+                       const uint8_t                        * pdatabeg, 
+                       const uint8_t                        * pdataend, 
+                       uint8_t                              * poutbeg, 
+                       uint8_t                              * poutend );
+
     /*
         CompressPX
             Function used to compress data into PX compressed data.
@@ -183,6 +198,41 @@ namespace compression
 
 
 
+    /*
+        px_inrange_t
+            A range of bytes to compress, used for batch compression.
+    */
+    typedef std::pair<std::vector<uint8_t>::const_iterator, std::vector<uint8_t>::const_iterator> px_inrange_t;
+
+    /*
+        CompressPXBatch
+            Function used to compress several independent ranges of data at once. 
+            The ranges are spread over as many threads as utils::LibWide().getNbThreadsToUse() allows,
+            and each threads reuses its compression buffers between ranges.
+
+            Parameters:
+                - inputs              : The ranges of data to compress. 
+                - out_compresseddata  : Resized to the nb of inputs. Each entry receives the compressed data of the 
+                                        range at the same index.
+                - compressionlvl      : The compression level to apply.
+                - bZealousSearch      : Whether to prioritize compression efficiency over speed basically..
+                - displayprogress     : Whether should display the nb of ranges compressed so far at the console!
+                - headerreservesz     : Nb of bytes to leave at the beginning of each output entry, so a header can be
+                                        written there afterwards.
+
+            Returns:
+                A px_info_header structure for each inputs, in the same order.
+
+            It may throw exceptions. If any of the ranges fails to compress, the first exception thrown is 
+            rethrown once all threads are done.
+    */
+    std::vector<px_info_header> CompressPXBatch( const std::vector<px_inrange_t>     & inputs,
+                                                 std::vector<std::vector<uint8_t>>   & out_compresseddata,
+                                                 ePXCompLevel                          compressionlvl  = ePXCompLevel::LEVEL_3,
+                                                 bool                                  bZealousSearch  = false,
+                                                 bool                                  displayprogress = true,
+                                                 size_t                                headerreservesz = 0 );
+
     /*
         CleanExistingCompressionLogs
             A little utility function to delete the existing logs. 
@@ -91,83 +91,113 @@ namespace filetypes
     }
 
 
-    //#TODO: Should use a back_inserter here !
-    void EncodeSIR0PtrOffsetList( const std::vector<uint32_t> &listoffsetptrs, std::vector<uint8_t> & out_encoded ) //! #REMOVEME
+    /*
+        Encodes the list into the output, without checking the output's length.
+        The output must have room for 4 bytes per offset, plus the closing 0.
+        Every offset is assembled into a single 4 bytes word, and the word is always written whole, 
+        so the loop doesn't branch on the length of each offset. The extra bytes are overwritten by the next offset.
+    */
+    inline uint8_t * EncodeSIR0PtrOffsetListUnchecked( const uint32_t * pbeg, const uint32_t * pend, uint8_t * pout )
     {
-        uint32_t offsetSoFar = 0; //used to add up the sum of all the offsets up to the current one
-
-        for( const auto & anoffset : listoffsetptrs )
+        uint32_t offsetSoFar = 0;
+        for( ; pbeg != pend; ++pbeg )
         {
-            uint32_t offsetToEncode        = anoffset - offsetSoFar;
-            bool     hasHigherNonZero      = false; //This tells the loop whether it needs to encode null bytes, if at least one higher byte was non-zero
-            offsetSoFar = anoffset; //set the value to the latest offset, so we can properly subtract it from the next offset.
-
-            //Encode every bytes of the 4 bytes integer we have to
-            for( int32_t i = sizeof(int32_t); i > 0; --i )
-            {
-                uint8_t currentbyte = ( offsetToEncode >> (7 * (i - 1)) ) & 0x7Fu;
-                
-                if( i == 1 ) //the lowest byte to encode is special
-                {
-                    //If its the last byte to append, leave the highest bit to 0 !
-                    out_encoded.push_back( currentbyte );
-                }
-                else if( currentbyte != 0 || hasHigherNonZero ) //if any bytes but the lowest one! If not null OR if we have encoded a higher non-null byte before!
-                {
-                    //Set the highest bit to 1, to signifie that the next byte must be appended
-                    out_encoded.push_back( currentbyte | 0x80u ); 
-                    hasHigherNonZero = true;
-                }
-            }
+            const uint32_t offset = *pbeg - offsetSoFar;
+            const uint32_t len    = EncodedSIR0OffsetLen(offset);
+            offsetSoFar = *pbeg;
+
+            //7 bits groups from the highest down. All but the last have their highest bit set.
+            const uint32_t groups = ( ((offset >> 21) & 0x7Fu) | 0x80u )        |
+                                    ( ((offset >> 14) & 0x7Fu) | 0x80u ) <<  8  |
+                                    ( ((offset >>  7) & 0x7Fu) | 0x80u ) << 16  |
+                                    (   offset        & 0x7Fu          ) << 24;
+            //Drop the unused highest groups
+            const uint32_t word   = groups >> (8u * (4u - len));
+            pout[0] = static_cast<uint8_t>(word);
+            pout[1] = static_cast<uint8_t>(word >>  8);
+            pout[2] = static_cast<uint8_t>(word >> 16);
+            pout[3] = static_cast<uint8_t>(word >> 24);
+            pout   += len;
         }
 
         //Append the closing 0
-        out_encoded.push_back(0);
+        *(pout++) = 0;
+        return pout;
+    }
+
+    void EncodeSIR0PtrOffsetList( const std::vector<uint32_t> &listoffsetptrs, std::vector<uint8_t> & out_encoded ) //! #REMOVEME
+    {
+        //Worst case is 4 bytes per offset, so size for that once, encode straight into it, and trim after
+        const size_t prevsize = out_encoded.size();
+        out_encoded.resize( prevsize + (listoffsetptrs.size() * sizeof(uint32_t)) + 1 );
+        uint8_t * pend = EncodeSIR0PtrOffsetListUnchecked( listoffsetptrs.data(), 
+                                                           listoffsetptrs.data() + listoffsetptrs.size(), 
+                                                           out_encoded.data() + prevsize );
+        out_encoded.resize( static_cast<size_t>(pend - out_encoded.data()) );
     }
 
     std::vector<uint8_t> EncodeSIR0PtrOffsetList( const std::vector<uint32_t> &listoffsetptrs ) //! #REMOVEME
     {
-        vector<uint8_t> encodedptroffsets( 2u + listoffsetptrs.size() );  //Worst case scenario allocation
-        encodedptroffsets.resize(0); //preserve alloc, allow push backs
+        vector<uint8_t> encodedptroffsets;
         EncodeSIR0PtrOffsetList(listoffsetptrs,encodedptroffsets);
         return std::move(encodedptroffsets);
     }
 
+    uint8_t * EncodeSIR0PtrOffsetList( const uint32_t * pbeg, const uint32_t * pend, uint8_t * poutbeg, uint8_t * poutend )
+    {
+        const size_t outlen = static_cast<size_t>(poutend - poutbeg);
+        if( outlen >= (static_cast<size_t>(pend - pbeg) * sizeof(uint32_t)) + 1 )
+            return EncodeSIR0PtrOffsetListUnchecked( pbeg, pend, poutbeg );
+
+        //If the output isn't large enough for the worst case, it must be at least as long as the encoded list.
+        // Then go through a scratch buffer, since the words written past the end of the list wouldn't fit.
+        const size_t enclen = CalcEncodedSIR0PtrOffsetListLen( pbeg, pend );
+        if( outlen < enclen )
+            throw std::length_error("EncodeSIR0PtrOffsetList(): Output range is too small for the encoded list!");
+
+        vector<uint8_t> scratch( (static_cast<size_t>(pend - pbeg) * sizeof(uint32_t)) + 1 );
+        EncodeSIR0PtrOffsetListUnchecked( pbeg, pend, scratch.data() );
+        return std::copy_n( scratch.data(), enclen, poutbeg );
+    }
+
     std::vector<uint32_t> DecodeSIR0PtrOffsetList( const std::vector<uint8_t>  &ptroffsetslst )
     {
-        vector<uint32_t> decodedptroffsets( ptroffsetslst.size() ); //worst case scenario
-        decodedptroffsets.resize(0);
+        vector<uint32_t> decodedptroffsets;
+        DecodeSIR0PtrOffsetList( ptroffsetslst.data(), ptroffsetslst.data() + ptroffsetslst.size(), decodedptroffsets );
+        return std::move(decodedptroffsets);
+    }
 
-        auto itcurbyte  = ptroffsetslst.begin();
-        auto itlastbyte = ptroffsetslst.end();
+    size_t DecodeSIR0PtrOffsetList( const uint8_t * pbeg, const uint8_t * pend, std::vector<uint32_t> & out_offsets )
+    {
+        //There can't be more offsets than bytes, so size for that, and trim after
+        const size_t prevsize = out_offsets.size();
+        out_offsets.resize( prevsize + static_cast<size_t>(pend - pbeg) );
 
-        uint32_t offsetsum = 0; //This is used to sum up all offsets and obtain the offset relative to the file, and not the last offset
-        uint32_t buffer    = 0; //temp buffer to assemble longer offsets
-        uint8_t curbyte    = *itcurbyte;
-        bool    LastHadBitFlag = false; //This contains whether the byte read on the previous turn of the loop had the bit flag indicating to append the next byte!
+        uint32_t * pout      = out_offsets.data() + prevsize;
+        uint32_t   offsetsum = 0; //This is used to sum up all offsets and obtain the offset relative to the file, and not the last offset
+        uint32_t   buffer    = 0; //temp buffer to assemble longer offsets
+        uint32_t   bcontinue = 0; //Whether the previous byte had its highest bit set, and the current one must be appended to it
 
-        while( itcurbyte != itlastbyte && ( LastHadBitFlag || (*itcurbyte) != 0 ) )
+        for( ; pbeg != pend; ++pbeg )
         {
-            curbyte = *itcurbyte;
-            buffer |= curbyte & 0x7Fu;
-        
-            if( (0x80u & curbyte) != 0 )
-            {
-                LastHadBitFlag = true;
-                buffer <<= 7u;
-            }
-            else
-            {
-                LastHadBitFlag = false;
-                offsetsum += buffer;
-                decodedptroffsets.push_back(offsetsum);
-                buffer = 0;
-            }
-        
-            ++itcurbyte;
+            const uint32_t curbyte = *pbeg;
+            if( curbyte == 0 && !bcontinue )
+                break;  //Reached the closing 0
+
+            buffer    = (buffer << 7u) | (curbyte & 0x7Fu);
+            bcontinue = curbyte >> 7u;
+
+            //Only commit the value once the last byte of an offset was read. Otherwise, the slot is simply overwritten next time.
+            const uint32_t mask = bcontinue - 1u; //0xFFFFFFFF when the offset is complete, 0 when not
+            offsetsum += buffer & mask;
+            *pout      = offsetsum;
+            pout      += (bcontinue ^ 1u);
+            buffer    &= ~mask;
         }
 
-        return std::move(decodedptroffsets);
+        const size_t nbdecoded = static_cast<size_t>( pout - (out_offsets.data() + prevsize) );
+        out_offsets.resize( prevsize + nbdecoded );
+        return nbdecoded;
     }
 
     vector<uint8_t> MakeSIR0Wrap( const vector<uint8_t>    & data, 
@@ -205,6 +235,57 @@ namespace filetypes
     }
 
 
+//========================================================================================================
+//  SIR0View
+//========================================================================================================
+    SIR0View::SIR0View( const uint8_t * pbeg, const uint8_t * pend )
+        :m_pbeg(pbeg), m_pend(pend)
+    {
+        if( !IsSIR0( pbeg, pend ) )
+            throw std::runtime_error("SIR0View::SIR0View(): Data is not a valid SIR0 container!");
+
+        m_hdr.ReadFromContainer( pbeg, pend );
+        m_ptroffsets.reserve( 2 + (static_cast<size_t>(pend - getEncodedPtrListBeg()) / 2) ); //Most offsets encode on 1 or 2 bytes
+        DecodeSIR0PtrOffsetList( getEncodedPtrListBeg(), getEncodedPtrListEnd(), m_ptroffsets );
+    }
+
+    SIR0View::SIR0View( const std::vector<uint8_t> & data )
+        :SIR0View( data.data(), data.data() + data.size() )
+    {}
+
+    bool SIR0View::IsSIR0( const uint8_t * pbeg, const uint8_t * pend )
+    {
+        const size_t len = static_cast<size_t>(pend - pbeg);
+        if( len < sir0_header::HEADER_LEN )
+            return false;
+
+        const uint8_t * itread       = pbeg;
+        const uint32_t  magic        = ReadIntFromBytes<uint32_t>( itread, pend, false );
+        const uint32_t  subheaderptr = ReadIntFromBytes<uint32_t>( itread, pend );
+        const uint32_t  ptrlistptr   = ReadIntFromBytes<uint32_t>( itread, pend );
+        const uint32_t  endzero      = ReadIntFromBytes<uint32_t>( itread, pend );
+
+        //The sub-header comes after the SIR0 header, and before the pointer list
+        return magic        == MagicNumber_SIR0         && 
+               endzero      == 0                        && 
+               subheaderptr >= sir0_header::HEADER_LEN  &&
+               subheaderptr <  len                      &&
+               subheaderptr <= ptrlistptr               &&
+               ptrlistptr   <= len;
+    }
+
+    const uint8_t * SIR0View::ResolvePointer( uint32_t ptroffset )const
+    {
+        if( static_cast<size_t>(ptroffset) + sizeof(uint32_t) > size() )
+            throw std::out_of_range("SIR0View::ResolvePointer(): Pointer offset is out of range!");
+
+        const uint8_t * itread = m_pbeg + ptroffset;
+        const uint32_t  ptr    = ReadIntFromBytes<uint32_t>( itread, m_pend );
+        if( ptr >= size() )
+            throw std::out_of_range("SIR0View::ResolvePointer(): Pointer points outside of the container!");
+        return m_pbeg + ptr;
+    }
+
 //========================================================================================================
 //  SIR0DerivHandler
 //========================================================================================================
@@ -205,6 +205,41 @@ namespace filetypes
         return itw;
     }
 
+    /*
+        EncodedSIR0OffsetLen
+            Returns the number of bytes a single offset takes once encoded.
+            Only the lower 28 bits of an offset are ever encoded.
+    */
+    inline uint32_t EncodedSIR0OffsetLen( uint32_t offset )
+    {
+        return 1u + (offset >= 0x80u) + (offset >= 0x4000u) + (offset >= 0x200000u);
+    }
+
+    /*
+        CalcEncodedSIR0PtrOffsetListLen
+            Returns the exact length of the encoded list of pointer offsets, including the closing 0.
+            Use this to size the output range for the raw pointer version of EncodeSIR0PtrOffsetList.
+    */
+    template<class _fwdinit>
+        size_t CalcEncodedSIR0PtrOffsetListLen( _fwdinit itbeg, _fwdinit itend )
+    {
+        size_t   len         = 1; //The closing 0
+        uint32_t offsetSoFar = 0;
+        for( ; itbeg != itend; ++itbeg )
+        {
+            len        += EncodedSIR0OffsetLen( *itbeg - offsetSoFar );
+            offsetSoFar = *itbeg;
+        }
+        return len;
+    }
+
+    /*
+        EncodeSIR0PtrOffsetList
+            Encode the list of offsets into the output range.
+            Throws if the output range is too small. Returns the position one past the closing 0.
+    */
+    uint8_t * EncodeSIR0PtrOffsetList( const uint32_t * pbeg, const uint32_t * pend, uint8_t * poutbeg, uint8_t * poutend );
+
 
 
     /**************************************************************************
@@ -219,6 +254,14 @@ namespace filetypes
     ***************************************************************************/
     std::vector<uint32_t> DecodeSIR0PtrOffsetList( const std::vector<uint8_t>  &ptroffsetslst  );
 
+    /*
+        DecodeSIR0PtrOffsetList
+            Same as above, but decodes the range, and appends the offsets to "out_offsets".
+            The output is sized once for the worst case, and shrunk afterwards, so nothing is re-allocated while decoding.
+            Returns the number of offsets decoded.
+    */
+    size_t DecodeSIR0PtrOffsetList( const uint8_t * pbeg, const uint8_t * pend, std::vector<uint32_t> & out_offsets );
+
     /*
         Test a sir0_header struct to verify if its from a valid SIR0 container.
     */
@@ -270,9 +313,8 @@ namespace filetypes
             const uint32_t nbpadbytes = utils::AppendPaddingBytes( itw, m_data.size() + sir0_header::HEADER_LEN, 16, 0xAA );
 
             //Encode and write the offset ptr list!
-            std::vector<uint8_t> encoded( (m_ptroffsets.size() + 2) * sizeof(uint32_t) );
-            encoded.resize(0);  //Preserve allocation, but allows push backs!
-            EncodeSIR0PtrOffsetList( m_ptroffsets.begin(), m_ptroffsets.end(), std::back_inserter(encoded) );
+            std::vector<uint8_t> encoded( CalcEncodedSIR0PtrOffsetListLen( m_ptroffsets.begin(), m_ptroffsets.end() ) );
+            EncodeSIR0PtrOffsetList( m_ptroffsets.begin(), m_ptroffsets.end(), encoded.begin() );
             lambdaWriteVector(encoded, itw );
 
             //Put final padding!
@@ -316,6 +358,53 @@ namespace filetypes
     };
 
 
+    /***************************************************************************
+        SIR0View
+            Read-only view over a SIR0 container in memory. 
+            The header is validated and the pointer offset list decoded on 
+            construction, but the wrapped data is never copied.
+            The view is only valid for as long as the memory it was made from.
+    ***************************************************************************/
+    class SIR0View
+    {
+    public:
+        //Throws if the range doesn't contain a valid SIR0 container.
+        SIR0View( const uint8_t * pbeg, const uint8_t * pend );
+        explicit SIR0View( const std::vector<uint8_t> & data );
+
+        //Whether the range begins with a SIR0 header whose offsets are within the range, with the sub-header before the pointer list.
+        static bool IsSIR0( const uint8_t * pbeg, const uint8_t * pend );
+
+        inline const sir0_header & getHeader()const             { return m_hdr; }
+        inline const uint8_t     * begin()const                 { return m_pbeg; }
+        inline const uint8_t     * end()const                   { return m_pend; }
+        inline size_t              size()const                  { return static_cast<size_t>(m_pend - m_pbeg); }
+
+        //The sub-header the SIR0 header points to.
+        inline const uint8_t     * getSubHeader()const          { return m_pbeg + m_hdr.subheaderptr; }
+
+        //The wrapped data, between the SIR0 header and the encoded pointer offset list. Includes the padding.
+        inline const uint8_t     * getDataBeg()const            { return m_pbeg + sir0_header::HEADER_LEN; }
+        inline const uint8_t     * getDataEnd()const            { return m_pbeg + m_hdr.ptrPtrOffsetLst; }
+
+        //The encoded pointer offset list, and the padding after it.
+        inline const uint8_t     * getEncodedPtrListBeg()const  { return getDataEnd(); }
+        inline const uint8_t     * getEncodedPtrListEnd()const  { return m_pend; }
+
+        //Offsets of all the pointers in the container, relative to its beginning. This includes the 2 pointers of the SIR0 header.
+        inline const std::vector<uint32_t> & getPtrOffsets()const { return m_ptroffsets; }
+
+        //Reads the pointer at the offset, and returns where it points to. Throws if either is out of range.
+        const uint8_t * ResolvePointer( uint32_t ptroffset )const;
+
+    private:
+        const uint8_t         * m_pbeg;
+        const uint8_t         * m_pend;
+        sir0_header             m_hdr;
+        std::vector<uint32_t>   m_ptroffsets;
+    };
+
+
 //! #REMOVEME: All this below is completely unused!!
     /*
         SIR0DerivHandler
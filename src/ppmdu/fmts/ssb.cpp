@@ -111,7 +111,7 @@ namespace filetypes
     typedef lblinfo                             lbl_t;          //Represents a label
     typedef unordered_map<dataoffset_t, lbl_t>  lbltbl_t;       //Contains the location of all labels
     typedef vector<routine_entry>               rawroutines_t;  //Raw group entries
-    typedef deque<ScriptInstruction>            rawinst_t;      //Raw instruction entries
+    typedef vector<ScriptInstruction>           rawinst_t;      //Raw instruction entries
 
 //=======================================================================================
 //  Functions for handling parameter values
@@ -405,7 +405,7 @@ namespace filetypes
         template<typename _init>
             void HandleInstruction( _init & iti, _init & itend, _init itlastinst )
         {
-            ScriptInstruction curinst  = *iti;
+            ScriptInstruction curinst  = std::move(*iti);
             OpCodeInfoWrapper codeinfo = m_instfinder.Info(curinst.value);
             //OpCodeInfoWrapper lastinfo;
             curinst.dbg_origoffset     = m_curdataoffset / ScriptWordLen;
@@ -561,7 +561,7 @@ namespace filetypes
     private:
         raw_ssb_content                       m_rawdata;
         const LanguageFilesDB               & m_langs;
-        deque<ScriptInstruction>            & m_rawinst;
+        rawinst_t                           & m_rawinst;
         const rawroutines_t                 & m_routines;
         const lbltbl_t                      & m_labels;
         const Script::consttbl_t            & m_constants;
@@ -589,7 +589,7 @@ namespace filetypes
     {
     public:
         typedef _Init                    initer;
-        typedef deque<ScriptInstruction> instcnt_t;
+        typedef rawinst_t                instcnt_t;
 
         SSB_Parser( _Init beg, _Init end, eOpCodeVersion scrver, eGameRegion scrloc, const LanguageFilesDB & langdat )
             :m_opfinder(scrver), m_beg(beg), m_end(end), m_cur(beg), m_scrversion(scrver), m_scrRegion(scrloc), m_lblcnt(0), 
@@ -826,6 +826,7 @@ namespace filetypes
             //Iterate once through the entire code, regardless of groups, list all jump targets, and parse all operations
             m_instbeg = m_hdrlen + ssb_data_hdr::LEN + (m_nbroutines * routine_entry::LEN);
             m_instend = m_hdrlen + m_datablocklen;
+            m_rawinst.reserve( (m_instend - m_instbeg) / (ScriptWordLen * 2) ); //Most commands are at least an opcode and a parameter
 #ifdef _DEBUG
             assert(m_inputsz >= m_instend);
 #endif
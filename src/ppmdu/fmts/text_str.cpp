@@ -81,25 +81,32 @@ namespace pmd2 { namespace filetypes
 
             //First get the first pointer to get the end of the ptr table!
             uint32_t endptrtbl = utils::ReadIntFromBytes<uint32_t>( itptrs, m_filedata.end() );  //iterator is incremented
+            if( endptrtbl > m_filedata.size() )
+                throw runtime_error("TextStrLoader::ReadPointerTable(): End of pointer table is past the end of the file!");
             m_ptrTable.reserve( endptrtbl / sizeof(uint32_t) );                     //reserve memory for all pointers
             m_ptrTable.push_back( endptrtbl );
 
             //Read all pointers
             auto itendptrs = m_filedata.begin() + endptrtbl;
             for( ; itptrs != itendptrs; )
-                m_ptrTable.push_back( utils::ReadIntFromBytes<uint32_t>( itptrs, m_filedata.end() ) );
+                m_ptrTable.push_back( utils::ReadIntFromBytes<uint32_t>( itptrs, itendptrs ) );
         }
 
+        /*
+            Each string is built straight from its bytes in the file buffer, and only goes through
+            escaping if it actually contains something to escape.
+        */
         void ReadStrings()
         {
             const unsigned int PtrTableSize = m_ptrTable.size()-1; // The last pointer is a pointer to the end of the file!
             const unsigned int LastPtrIndex = PtrTableSize - 1;    // Index of the last element before the end
+            const char       * pfiledata    = reinterpret_cast<const char*>(m_filedata.data());
             
             //Allocate
             m_txtstr.resize(m_ptrTable.size());
             
             //Read them all
-            for( unsigned int i = 0; i < PtrTableSize;  )
+            for( unsigned int i = 0; i < PtrTableSize; ++i )
             {
                 unsigned int len = 0;
 
@@ -108,13 +115,11 @@ namespace pmd2 { namespace filetypes
                 else
                     len = (m_ptrTable[i+1] - m_ptrTable[i]);
 
-                //char* ptrstr = reinterpret_cast<char*>(m_filedata.data() + m_ptrTable[i]); //#TODO: think of something faster...
-                auto itcurstr = m_filedata.begin() + m_ptrTable[i];
-                string curstr( itcurstr, itcurstr + len);
-                //curstr.push_back('\0');
+                if( m_ptrTable[i] > m_filedata.size() || len > (m_filedata.size() - m_ptrTable[i]) )
+                    throw runtime_error("TextStrLoader::ReadStrings(): String #" + to_string(i) + " is past the end of the file!");
 
-                m_txtstr[i] = std::move( EscapeUnprintableCharacters( curstr, m_escapejis, false, m_locale ) );
-                ++i;
+                const char * pstr = pfiledata + m_ptrTable[i];
+                m_txtstr[i] = EscapeUnprintableCharacters( pstr, pstr + len, m_escapejis );
             }
             clog<<" Done!\n";
         }
@@ -235,48 +240,40 @@ namespace pmd2 { namespace filetypes
         //    return escLen;
         //}
 
+        /*
+            The pointer table and all the strings are written into a single buffer sized up front.
+            Strings without any escape sequence are copied as-is.
+        */
         void Write( const std::string & filepath )
         {
             //Re-init ptr write positon, just in case someone would re-use the object..
             m_ptrTblWriteAt = 0;
 
+            //Unescaping never makes a string longer, so this is the most we'll need
+            size_t totalsz = m_txtstr.size() * PTR_LEN;
+            for( const auto & str : m_txtstr )
+                totalsz += str.size();
+
             //Reserve ptr table space!
+            m_fileData.reserve( totalsz );
             m_fileData.resize( m_txtstr.size() * PTR_LEN );
 
             clog << "Writing " <<dec << m_txtstr.size() <<" strings to file \"" <<filepath <<"\"";
 
-            auto itbackins = back_inserter( m_fileData );
-
-            for( unsigned int cntstr = 0; cntstr < m_txtstr.size();  )
+            string processed;
+            for( const auto & str : m_txtstr )
             {
-                const auto & str = m_txtstr[cntstr];
                 utils::WriteIntToBytes<uint32_t>( m_fileData.size(), m_fileData.begin() + m_ptrTblWriteAt );  //Write string offset
                 m_ptrTblWriteAt += PTR_LEN;
 
-                //
-                //string processed;
-                //auto         itprocessedbackins = back_inserter( processed );
-                //processed.reserve(str.size());
-                //for( unsigned int i = 0; i < str.size();  )
-                //{
-                //    char c = str[i];
-                //    if( c == '\\' && i < (str.size()-1) )
-                //    {   
-                //        //HandleEscapedChar returns the amount of characters that were handled as part of the escaped char.
-                //        i+= HandleEscapedChar( itprocessedbackins, str.substr( i + 1 ), m_locale ) ;
-                //    }
-                //    else
-                //    {
-                //        (*itprocessedbackins) = c; //If the character is not a backslash, or if there are no other characters after the backslash
-                //        ++i;
-                //    }
-                //}
-                //processed = std::move( ReplaceEscapedCharacters( str, m_locale ) );
-                string processed = str; 
-                ReplaceEscapedSequenceTest(processed);
-
-                std::copy( processed.begin(), processed.end(), itbackins );
-                ++cntstr;
+                if( str.find('\\') == string::npos )
+                    m_fileData.insert( m_fileData.end(), str.begin(), str.end() );
+                else
+                {
+                    processed = str;
+                    ReplaceEscapedSequenceTest(processed);
+                    m_fileData.insert( m_fileData.end(), processed.begin(), processed.end() );
+                }
             }
             cout<<" Done!\n";
             //Write file
@@ -268,6 +268,36 @@ namespace filetypes
         return std::move(palettecolors);
     }
 
+    /**************************************************************
+    **************************************************************/
+    vector<uint32_t> WAN_Parser::ReadImagePointers()const
+    {
+        vector<uint32_t>                imgptrs( m_wanImgDataInfo.nbImgsTblPtr );
+        vector<uint8_t>::const_iterator itfrmptr = (m_rawdata.begin() + m_wanImgDataInfo.ptrImgsTbl); //Make iterator to frame pointer table
+        vector<uint8_t>::const_iterator itend    = m_rawdata.end();
+
+        for( auto & ptrtoimg : imgptrs )
+            ptrtoimg = utils::ReadIntFromBytes<uint32_t>( itfrmptr, itend ); //iter is incremented automatically
+
+        return std::move(imgptrs);
+    }
+
+    /**************************************************************
+    **************************************************************/
+    void WAN_Parser::ReadImagesInfo( std::vector<ImageInfo> & out_imginfo )const
+    {
+        const vector<uint32_t> imgptrs = ReadImagePointers();
+        out_imginfo.resize( imgptrs.size() );
+
+        //Only the first entry of the assembly table is needed to get the z index
+        for( size_t i = 0; i < imgptrs.size(); ++i )
+        {
+            ImgAsmTblEntry entry;
+            entry.ReadFromContainer( m_rawdata.begin() + imgptrs[i], m_rawdata.end() );
+            out_imginfo[i].zindex = (entry.isNull())? 0 : entry.zIndex;
+        }
+    }
+
     /**************************************************************
     **************************************************************/
     MetaFrame WAN_Parser::ReadAMetaFrame( vector<uint8_t>::const_iterator & itread, bool & out_isLastFrm )
@@ -18,6 +18,7 @@ Description: Utilities for reading ".wan" sprite files, and its derivatives.
 #include <ppmdu/pmd2/pmd2_image_formats.hpp>
 #include <utils/library_wide.hpp>
 #include <utils/handymath.hpp>
+#include <utils/parallel_tasks.hpp>
 #include <atomic>
 #include <algorithm>
 #include <type_traits>
@@ -446,6 +447,30 @@ namespace filetypes
         return nb_bytesread;
     }
 
+    /*
+        Same as above, but from an assembly table that was already read with FillAsmTable.
+    */
+    template<class _TIMG_t, class _randit>
+        uint32_t ParseZeroStrippedTImg( const std::vector<ImgAsmTblEntry> & asmtbl, 
+                                        _randit                             filebeg, 
+                                        gimg::PxlReadIter<_TIMG_t>          itinsertat )
+    {
+        uint32_t nb_bytesread = 0;
+        for( const auto & entry : asmtbl )
+        {
+            if( entry.pixelsrc == 0  )
+                std::fill_n( itinsertat, entry.pixamt, 0 );
+            else
+            {
+                auto itcopy = std::next(filebeg, entry.pixelsrc);
+                for( size_t cntcp = 0; cntcp < entry.pixamt; ++cntcp, ++itcopy, ++itinsertat )
+                    (*itinsertat) = (*itcopy);
+            }
+            nb_bytesread += entry.pixamt;
+        }
+        return nb_bytesread;
+    }
+
     /**********************************************************************
         ---------------------------
             FillAsmTable
@@ -456,12 +481,10 @@ namespace filetypes
             of pixels to assemble the decompressed tiled image!
     **********************************************************************/
     template<class _randit>
-        std::vector<ImgAsmTblEntry> FillAsmTable( _randit itcomptblbeg, _randit itpastend )
+        void FillAsmTable( _randit itcomptblbeg, _randit itpastend, std::vector<ImgAsmTblEntry> & out_asmtbl )
     {
-        using namespace std;
-        using namespace utils;
-        std::vector<ImgAsmTblEntry> asmtbl;
-        ImgAsmTblEntry              entry;
+        ImgAsmTblEntry entry;
+        out_asmtbl.clear(); //Keeps the capacity, so the same vector can be reused for every images
 
         do
         {
@@ -469,11 +492,17 @@ namespace filetypes
 
             if( !(entry.isNull()) )
             {
-                asmtbl.push_back( entry );
+                out_asmtbl.push_back( entry );
             }
 
         }while( !(entry.isNull()) );
+    }
 
+    template<class _randit>
+        std::vector<ImgAsmTblEntry> FillAsmTable( _randit itcomptblbeg, _randit itpastend )
+    {
+        std::vector<ImgAsmTblEntry> asmtbl;
+        FillAsmTable( itcomptblbeg, itpastend, asmtbl );
         return std::move(asmtbl);
     }
 
@@ -500,6 +529,38 @@ namespace filetypes
 
         template<class TIMG_t>
             pmd2::graphics::SpriteData<TIMG_t> Parse( std::atomic<uint32_t> * pProgress = nullptr )
+        {
+            return std::move( ParseSprite<TIMG_t>( true, pProgress ) );
+        }
+
+        /*
+            Parses everything except the pixels of the images, for tools that only need the meta-frames and animations.
+            The images are allocated, so the references to them are valid, but they're all empty.
+            The images info (z index) is still read.
+        */
+        template<class TIMG_t>
+            pmd2::graphics::SpriteData<TIMG_t> ParseHeadersOnly( std::atomic<uint32_t> * pProgress = nullptr )
+        {
+            return std::move( ParseSprite<TIMG_t>( false, pProgress ) );
+        }
+
+        //This parse all images of the sprite as 4bpp!
+        pmd2::graphics::SpriteData<gimg::tiled_image_i4bpp> ParseAs4bpp( std::atomic<uint32_t> * pProgress = nullptr)
+        {
+            return std::move(Parse<gimg::tiled_image_i4bpp>(pProgress));
+        }
+
+        //This parse all images of the sprite as 8bpp!
+        pmd2::graphics::SpriteData<gimg::tiled_image_i8bpp> ParseAs8bpp(std::atomic<uint32_t> * pProgress = nullptr)
+        {
+            return std::move(Parse<gimg::tiled_image_i8bpp>(pProgress));
+        }
+
+    private:
+        //Methods
+
+        template<class TIMG_t>
+            pmd2::graphics::SpriteData<TIMG_t> ParseSprite( bool bdecodeimgs, std::atomic<uint32_t> * pProgress )
         {
             SpriteData<TIMG_t> sprite;
 
@@ -532,26 +593,14 @@ namespace filetypes
             sprite.RebuildAllReferences();
 
             //Read images, use meta frames to get proper res, thanks to the refs!
-            ReadImages<TIMG_t>( sprite.m_frames, sprite.m_metaframes, sprite.m_metarefs, sprite.getPalette(), sprite.getImgsInfo() );
+            if( bdecodeimgs )
+                ReadImages<TIMG_t>( sprite.m_frames, sprite.m_metaframes, sprite.m_metarefs, sprite.getPalette(), sprite.getImgsInfo() );
+            else
+                ReadImagesInfo( sprite.getImgsInfo() );
 
             return std::move( sprite );
         }
 
-        //This parse all images of the sprite as 4bpp!
-        pmd2::graphics::SpriteData<gimg::tiled_image_i4bpp> ParseAs4bpp( std::atomic<uint32_t> * pProgress = nullptr)
-        {
-            return std::move(Parse<gimg::tiled_image_i4bpp>(pProgress));
-        }
-
-        //This parse all images of the sprite as 8bpp!
-        pmd2::graphics::SpriteData<gimg::tiled_image_i8bpp> ParseAs8bpp(std::atomic<uint32_t> * pProgress = nullptr)
-        {
-            return std::move(Parse<gimg::tiled_image_i8bpp>(pProgress));
-        }
-
-    private:
-        //Methods
-
         //A generic parsing method to parse common non-image format specific stuff!
         void DoParse( std::vector<gimg::colorRGB24>                     & out_pal, 
                       pmd2::graphics::SprInfo                           & out_sprinf,
@@ -561,6 +610,10 @@ namespace filetypes
                       std::vector<pmd2::graphics::AnimationSequence>    & out_animseqs,
                       std::vector<pmd2::graphics::sprOffParticle>       & out_offsets );
 
+        /*
+            Images are independent from each others, so they're decoded over several threads.
+            Each chunk of images reuses the same assembly table buffer.
+        */
         template<class TIMG_t>
             void ReadImages( std::vector<TIMG_t>                           & out_imgs, 
                              const std::vector<pmd2::graphics::MetaFrame>  & metafrms,
@@ -568,29 +621,30 @@ namespace filetypes
                              const std::vector<gimg::colorRGB24>           & pal,
                              std::vector<pmd2::graphics::ImageInfo>        & out_imginfo )
         {
-            using namespace std;
-            vector<uint8_t>::const_iterator itfrmptr       = (m_rawdata.begin() + m_wanImgDataInfo.ptrImgsTbl); //Make iterator to frame pointer table
-            //uint32_t                        progressBefore = 0; 
-            //ensure capacity
-            out_imgs.resize( m_wanImgDataInfo.nbImgsTblPtr ); 
+            static const size_t          NbImgsPerChunk = 16;
+            const std::vector<uint32_t>  imgptrs        = ReadImagePointers();
 
-            //Save a little snapshot of the progress this far
-            //if(m_pProgress != nullptr)
-            //    progressBefore = m_pProgress->load(); 
+            //ensure capacity
+            out_imgs.resize( imgptrs.size() ); 
+            out_imginfo.resize( imgptrs.size() );
 
-            //Read all ptrs in the raw data!
-            for( unsigned int i = 0; i < m_wanImgDataInfo.nbImgsTblPtr; ++i )
+            auto lambdaReadImgs = [&]( size_t chunkbeg, size_t chunkend )
             {
-                uint32_t ptrtoimg = utils::ReadIntFromBytes<uint32_t>( itfrmptr, static_cast<vector<uint8_t>::const_iterator>(m_rawdata.end()) ); //iter is incremented automatically
+                std::vector<ImgAsmTblEntry> asmtable;
+                for( size_t i = chunkbeg; i < chunkend; ++i )
+                {
+                    if( utils::LibWide().isLogOn() )
+                        std::clog <<"== Frame #" <<i <<" ==\n";
 
-                if( utils::LibWide().isLogOn() )
-                    std::clog <<"== Frame #" <<i <<" ==\n";
+                    ReadImage( m_rawdata.begin() + imgptrs[i], metafrms, metarefs, pal, out_imgs[i], i, out_imginfo[i], asmtable );
+                }
+            };
 
-                ReadImage( m_rawdata.begin() + ptrtoimg, metafrms, metarefs, pal, out_imgs[i], i, out_imginfo );
-                
-                //if( m_pProgress != nullptr )
-                //    m_pProgress->store( progressBefore + ( (ProgressProp_Frames * (i+1)) / m_wanImgDataInfo.nbImgsTblPtr ) );
-            }
+            //Logging is done on a single thread, or the images' logs would get mixed up
+            if( utils::LibWide().isLogOn() )
+                lambdaReadImgs( 0, imgptrs.size() );
+            else
+                utils::RunChunked( 0, imgptrs.size(), NbImgsPerChunk, lambdaReadImgs );
         }
 
         template<class TIMG_t>
@@ -600,14 +654,15 @@ namespace filetypes
                                const std::vector<gimg::colorRGB24>     & pal,
                                TIMG_t                                  & cur_img,
                                uint32_t                                  curfrmindex,
-                               std::vector<pmd2::graphics::ImageInfo>        & out_imginfo )
+                               pmd2::graphics::ImageInfo               & out_imginf,
+                               std::vector<ImgAsmTblEntry>             & asmtable )
         {
             auto              itfound    = metarefs.find( curfrmindex ); //Find if we have a meta-frame pointing to that frame
             utils::Resolution myres      = RES_64x64_SPRITE;
             uint32_t          totalbyamt = 0;
 
             //Read the assembly table
-            auto asmtable = FillAsmTable( itwhere, m_rawdata.end() );
+            FillAsmTable( itwhere, m_rawdata.end(), asmtable );
 
             //Log the asm table if logging is on
             if( utils::LibWide().isLogOn() )
@@ -626,9 +681,7 @@ namespace filetypes
                 totalbyamt += entry.pixamt;
 
             //Keep track of the z index
-            ImageInfo imginf;
-            imginf.zindex = asmtable.front().zIndex;
-            out_imginfo.push_back(imginf);
+            out_imginf.zindex = (asmtable.empty())? 0 : asmtable.front().zIndex;
 
             if( itfound != metarefs.end() )
             {
@@ -727,11 +780,7 @@ namespace filetypes
             gimg::PxlReadIter<TIMG_t> myPixelReader(cur_img); 
 
             //Build the image
-            uint32_t byteshandled = ParseZeroStrippedTImg<TIMG_t>(  itwhere, 
-                                                                    m_rawdata.begin(), 
-                                                                    m_rawdata.end(), 
-                                                                    myres,
-                                                                    myPixelReader );
+            uint32_t byteshandled = ParseZeroStrippedTImg<TIMG_t>( asmtable, m_rawdata.begin(), myPixelReader );
 
             //Copy the palette!
             cur_img.getPalette() = pal;
@@ -741,6 +790,10 @@ namespace filetypes
         void                                        ReadSir0Header();
         void                                        ReadWanHeader();
         std::vector<gimg::colorRGB24>               ReadPalette();
+        std::vector<uint32_t>                       ReadImagePointers()const;
+
+        //Reads only the z index of each images, for when the pixels aren't decoded
+        void                                        ReadImagesInfo( std::vector<pmd2::graphics::ImageInfo> & out_imginfo )const;
 
         //Read all the meta-frames + meta-frame groups
         std::vector<pmd2::graphics::MetaFrame>            ReadMetaFrameGroups( std::vector<pmd2::graphics::MetaFrameGroup> & out_metafrmgrps );
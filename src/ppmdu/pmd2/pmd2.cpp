@@ -8,6 +8,7 @@
 #include <regex>
 #include <iterator>
 #include <algorithm>
+#include <array>
 using namespace std;
 
 std::ostream& operator<< (std::ostream& stream, const pmd2::toolkitversion_t & tkitver)
@@ -471,17 +472,71 @@ namespace pmd2
     }
 
 
+    /*
+        EscapeUnprintableCharacters
+            Single pass version of EscapeUnprintableCharactersTest, working straight on a raw byte range.
+            Strings with nothing to escape are copied as-is with a single allocation.
+    */
+    std::string EscapeUnprintableCharacters( const char * beg, const char * end, bool escapejis )
+    {
+        static const char HexDigits[] = "0123456789ABCDEF";
+        //Flat lookup of the characters in CharactersToCommonEscapeCharacters, so the scan doesn't hash every byte
+        static const std::array<bool,256> HasCommonEscape = []()
+        {
+            std::array<bool,256> tbl;
+            tbl.fill(false);
+            for( const auto & entry : CharactersToCommonEscapeCharacters )
+                tbl[static_cast<unsigned char>(entry.first)] = true;
+            return tbl;
+        }();
+        auto lambdaIsJIS = [escapejis]( unsigned char c )->bool
+        {
+            return escapejis && c >= ShiftJIS_Marker && c <= ShiftJIS_MarkerLast;
+        };
+        auto lambdaNeedsEscape = [&]( const char * itc )->bool
+        {
+            return ( lambdaIsJIS(*itc) && (itc + 1) != end ) || 
+                   HasCommonEscape[static_cast<unsigned char>(*itc)];
+        };
+
+        const char * itfirst = beg;
+        for( ; itfirst != end && !lambdaNeedsEscape(itfirst); ++itfirst );
+        if( itfirst == end )
+            return std::string(beg, end);
+
+        std::string out;
+        out.reserve( (end - beg) * 2 );
+        out.append(beg, itfirst);
+        for( const char * itc = itfirst; itc != end; ++itc )
+        {
+            if( lambdaIsJIS(*itc) && (itc + 1) != end )
+            {
+                for( int i = 0; i < 2; ++i, ++itc )
+                {
+                    const unsigned char c = *itc;
+                    out.push_back('\\');
+                    out.push_back('x');
+                    out.push_back(HexDigits[c >> 4]);
+                    out.push_back(HexDigits[c & 0xF]);
+                }
+                --itc;
+                continue;
+            }
+
+            if( HasCommonEscape[static_cast<unsigned char>(*itc)] )
+                out.append(CharactersToCommonEscapeCharacters.at(*itc));
+            else
+                out.push_back(*itc);
+        }
+        return std::move(out);
+    }
+
     /*
     */
     std::string EscapeUnprintableCharacters(const std::string & src, bool escapejis, bool escapeforxml, const std::locale & loc)
     {
 #if 1
-        std::string out = src;
-        if( escapejis )
-            EscapeUnprintableCharactersTest<true>(out);
-        else
-            EscapeUnprintableCharactersTest<false>(out);
-        return std::move(out);
+        return EscapeUnprintableCharacters( src.data(), src.data() + src.size(), escapejis );
 #else
         std::string out;
         out.reserve(src.size() * 2);
@@ -3,6 +3,7 @@
 #include <utils/parse_utils.hpp>
 #include <utils/library_wide.hpp>
 #include <utils/poco_wrapper.hpp>
+#include <utils/binary_cache.hpp>
 #include <iostream>
 #include <functional>
 #include <deque>
@@ -150,6 +151,7 @@ namespace pmd2
         {
             string confpath = utils::MakeAbsolutePath(configfile);
             pugi::xml_parse_result result = m_doc.load_file( confpath.c_str() );
+            m_srcfiles.push_back(confpath);
             //regex basepathex("(.+.+(?=\\b\\/))(.+\\..+)");
             //smatch sm;
             m_confbasepath = std::move( utils::GetPathOnly( confpath ) );
@@ -188,6 +190,11 @@ namespace pmd2
             }
         }
 
+        /*
+            All the xml files the data was parsed from, including the external files.
+        */
+        inline const std::vector<std::string> & GetSourceFiles()const { return m_srcfiles; }
+
     private:
 
         bool MatchesCurrentVersionID( xml_attribute_iterator itatbeg, xml_attribute_iterator itatend )
@@ -697,6 +704,7 @@ namespace pmd2
             {
                 xml_document doc;
                 m_subdocs.push_back(extfile);
+                m_srcfiles.push_back(extfile); //Even if it can't be loaded, so the cache gets rebuilt if it shows up
                 if( !(doc.load_file(extfile.c_str())) )
                 {
                     m_subdocs.pop_back();
@@ -870,6 +878,7 @@ namespace pmd2
         GameVersionInfo                 m_curversion;
         pugi::xml_document              m_doc;
         std::deque<std::string>         m_subdocs;
+        std::vector<std::string>        m_srcfiles;
 
         ConfigLoader::constcnt_t        m_constants;
         LanguageFilesDB::strfiles_t     m_lang;
@@ -880,6 +889,465 @@ namespace pmd2
         
     };
 
+//
+//  ConfigBinCache
+//
+    /*
+        ConfigBinCache
+            Saves and loads the data parsed from the config xml files for a given game version
+            to/from a binary file, to avoid parsing the xml files every time.
+            Its tied to the way the game version was looked up, since different lookups may not pick the same version.
+    */
+    class ConfigBinCache
+    {
+    public:
+        static const uint32_t MagicNumber   = 0x47464350; //"PCFG" as it appears in the file
+        static const uint32_t FormatVersion = 1;          //Increment whenever anything cached changes!
+
+        ConfigBinCache( const std::string & configfile, uint16_t arm9off14 )
+            :m_confpath(utils::MakeAbsolutePath(configfile)), m_cachepath(m_confpath + ConfigCacheFileExt), 
+             m_bbyarm9off(true), m_arm9off14(arm9off14), m_version(eGameVersion::Invalid), m_region(eGameRegion::Invalid), m_bneedsrefresh(false)
+        {}
+
+        ConfigBinCache( const std::string & configfile, eGameVersion version, eGameRegion region )
+            :m_confpath(utils::MakeAbsolutePath(configfile)), m_cachepath(m_confpath + ConfigCacheFileExt), 
+             m_bbyarm9off(false), m_arm9off14(0), m_version(version), m_region(region), m_bneedsrefresh(false)
+        {}
+
+        //Whether the last successful Load() found a source file that was touched, but not modified.
+        inline bool                             NeedsRefresh()const { return m_bneedsrefresh; }
+        inline const std::vector<std::string> & SourceFiles()const  { return m_srcfiles; }
+
+        /*
+            Returns false if there's no usable cache, or if it was built from a config file at another path.
+            The target is left untouched in that case.
+            Never writes to the cache. If NeedsRefresh() is true afterwards, call Save() with SourceFiles().
+        */
+        bool Load( ConfigLoader & target )
+        {
+            utils::BinaryCacheReader rd;
+            if( !rd.Load( m_cachepath, MagicNumber, FormatVersion ) )
+                return false;
+            if( rd.SourceFiles().empty() || rd.SourceFiles().front() != m_confpath )
+                return false; //Built from a config file somewhere else, like when the whole folder was copied
+            m_bneedsrefresh = rd.NeedsRefresh();
+            m_srcfiles      = rd.SourceFiles();
+
+            try
+            {
+                if( rd.ReadInt<uint8_t>() != static_cast<uint8_t>(m_bbyarm9off) ||
+                    rd.ReadInt<uint16_t>() != m_arm9off14                         ||
+                    rd.ReadInt<uint32_t>() != static_cast<uint32_t>(m_version)    ||
+                    rd.ReadInt<uint32_t>() != static_cast<uint32_t>(m_region) )
+                    return false; //Was made for another game version
+
+                GameVersionInfo             verinf;
+                GameConstants::constcnt_t   consts;
+                GameBinariesInfo            bins;
+                LanguageFilesDB::strfiles_t langs;
+                GameScriptData              scrdata;
+                GameASMPatchData            asmdata;
+                ReadVersionInfo  (rd, verinf);
+                ReadConstants    (rd, consts);
+                ReadBinaries     (rd, bins);
+                ReadLanguages    (rd, langs);
+                ReadScriptData   (rd, scrdata);
+                ReadASMPatchData (rd, asmdata);
+                if( !rd.AtEnd() )
+                    return false;
+
+                target.m_langdb       = std::move(LanguageFilesDB(std::move(langs)));
+                target.m_binblocks    = std::move(bins);
+                target.m_constants.SetConstants(std::move(consts));
+                target.m_versioninfo  = std::move(verinf);
+                target.m_gscriptdata  = std::move(scrdata);
+                target.m_asmpatchdata = std::move(asmdata);
+            }
+            catch( const std::exception & )
+            {
+                return false;
+            }
+            return true;
+        }
+
+        /*
+            Failing to write the cache isn't an error, the config will just be parsed again next time.
+        */
+        void Save( const std::vector<std::string> & srcfiles, const ConfigLoader & src )
+        {
+            try
+            {
+                utils::BinaryCacheWriter wr;
+                for( const auto & srcf : srcfiles )
+                    wr.AddSourceFile(srcf);
+
+                wr.WriteInt<uint8_t> ( static_cast<uint8_t>(m_bbyarm9off) );
+                wr.WriteInt<uint16_t>( m_arm9off14 );
+                wr.WriteInt<uint32_t>( static_cast<uint32_t>(m_version) );
+                wr.WriteInt<uint32_t>( static_cast<uint32_t>(m_region) );
+
+                WriteVersionInfo (wr, src.m_versioninfo);
+                WriteConstants   (wr, src.m_constants);
+                WriteBinaries    (wr, src.m_binblocks);
+                WriteLanguages   (wr, src.m_langdb);
+                WriteScriptData  (wr, src.m_gscriptdata);
+                WriteASMPatchData(wr, src.m_asmpatchdata);
+                wr.Save( m_cachepath, MagicNumber, FormatVersion );
+            }
+            catch( const std::exception & e )
+            {
+                if(utils::LibWide().isLogOn())
+                    clog << "<!>- ConfigBinCache::Save(): Couldn't write the config cache file \"" <<m_cachepath <<"\": " <<e.what() <<"\n";
+            }
+        }
+
+    private:
+
+        // --- Version Info ---
+        void WriteVersionInfo( utils::BinaryCacheWriter & wr, const GameVersionInfo & verinf )
+        {
+            wr.WriteStr(verinf.id);
+            wr.WriteStr(verinf.code);
+            wr.WriteInt<uint32_t>( static_cast<uint32_t>(verinf.version) );
+            wr.WriteInt<uint32_t>( static_cast<uint32_t>(verinf.region) );
+            wr.WriteInt<uint16_t>( verinf.arm9off14 );
+            wr.WriteInt<uint32_t>( static_cast<uint32_t>(verinf.defaultlang) );
+            wr.WriteInt<uint8_t> ( static_cast<uint8_t>(verinf.issupported) );
+        }
+
+        void ReadVersionInfo( utils::BinaryCacheReader & rd, GameVersionInfo & verinf )
+        {
+            verinf.id          = rd.ReadStr();
+            verinf.code        = rd.ReadStr();
+            verinf.version     = static_cast<eGameVersion>  ( rd.ReadInt<uint32_t>() );
+            verinf.region      = static_cast<eGameRegion>   ( rd.ReadInt<uint32_t>() );
+            verinf.arm9off14   = rd.ReadInt<uint16_t>();
+            verinf.defaultlang = static_cast<eGameLanguages>( rd.ReadInt<uint32_t>() );
+            verinf.issupported = rd.ReadInt<uint8_t>() != 0;
+        }
+
+        // --- Constants ---
+        void WriteConstants( utils::BinaryCacheWriter & wr, const GameConstants & consts )
+        {
+            wr.WriteInt<uint32_t>( static_cast<uint32_t>(consts.Constants().size()) );
+            for( const auto & cnst : consts.Constants() )
+            {
+                wr.WriteInt<uint32_t>( static_cast<uint32_t>(cnst.first) );
+                wr.WriteStr( cnst.second );
+            }
+        }
+
+        void ReadConstants( utils::BinaryCacheReader & rd, GameConstants::constcnt_t & consts )
+        {
+            const uint32_t nbconsts = rd.ReadInt<uint32_t>();
+            for( uint32_t i = 0; i < nbconsts; ++i )
+            {
+                eGameConstants cnst = static_cast<eGameConstants>( rd.ReadInt<uint32_t>() );
+                consts.emplace( cnst, rd.ReadStr() );
+            }
+        }
+
+        // --- Binaries ---
+        void WriteBinaries( utils::BinaryCacheWriter & wr, const GameBinariesInfo & bins )
+        {
+            const auto & binfiles = bins.Binaries();
+            wr.WriteInt<uint32_t>( static_cast<uint32_t>(binfiles.size()) );
+            for( const auto & bin : binfiles )
+            {
+                wr.WriteStr(bin.first);
+                wr.WriteInt<uint32_t>( bin.second.loadaddress );
+                wr.WriteInt<uint32_t>( static_cast<uint32_t>(bin.second.blocks.size()) );
+                for( const auto & blk : bin.second.blocks )
+                {
+                    wr.WriteInt<uint32_t>( static_cast<uint32_t>(blk.first) );
+                    wr.WriteInt<uint64_t>( blk.second.beg );
+                    wr.WriteInt<uint64_t>( blk.second.end );
+                }
+            }
+        }
+
+        void ReadBinaries( utils::BinaryCacheReader & rd, GameBinariesInfo & bins )
+        {
+            const uint32_t nbbins = rd.ReadInt<uint32_t>();
+            for( uint32_t i = 0; i < nbbins; ++i )
+            {
+                std::string binpath = rd.ReadStr();
+                binaryinfo  binfo;
+                binfo.loadaddress = rd.ReadInt<uint32_t>();
+                const uint32_t nbblocks = rd.ReadInt<uint32_t>();
+                for( uint32_t j = 0; j < nbblocks; ++j )
+                {
+                    eBinaryLocations loc = static_cast<eBinaryLocations>( rd.ReadInt<uint32_t>() );
+                    binlocation      blk;
+                    blk.beg = static_cast<size_t>( rd.ReadInt<uint64_t>() );
+                    blk.end = static_cast<size_t>( rd.ReadInt<uint64_t>() );
+                    binfo.blocks.emplace( loc, std::move(blk) );
+                }
+                bins.AddBinary( std::move(binpath), std::move(binfo) );
+            }
+        }
+
+        // --- Languages ---
+        void WriteLanguages( utils::BinaryCacheWriter & wr, const LanguageFilesDB & langdb )
+        {
+            wr.WriteInt<uint32_t>( static_cast<uint32_t>(langdb.Languages().size()) );
+            for( const auto & lang : langdb.Languages() )
+            {
+                wr.WriteStr(lang.first);
+                wr.WriteStr(lang.second.GetStrFName());
+                wr.WriteStr(lang.second.GetLocaleString());
+                wr.WriteInt<uint32_t>( static_cast<uint32_t>(lang.second.GetLanguage()) );
+                wr.WriteInt<uint32_t>( static_cast<uint32_t>(lang.second.size()) );
+                for( const auto & blk : lang.second )
+                {
+                    wr.WriteInt<uint32_t>( static_cast<uint32_t>(blk.first) );
+                    wr.WriteInt<uint32_t>( blk.second.beg );
+                    wr.WriteInt<uint32_t>( blk.second.end );
+                }
+            }
+        }
+
+        void ReadLanguages( utils::BinaryCacheReader & rd, LanguageFilesDB::strfiles_t & langs )
+        {
+            const uint32_t nblangs = rd.ReadInt<uint32_t>();
+            for( uint32_t i = 0; i < nblangs; ++i )
+            {
+                std::string    key = rd.ReadStr();
+                StringsCatalog catalog;
+                catalog.SetStrFName    ( rd.ReadStr() );
+                catalog.SetLocaleString( rd.ReadStr() );
+                catalog.SetLanguage    ( static_cast<eGameLanguages>( rd.ReadInt<uint32_t>() ) );
+                StringsCatalog::blkcnt_t blocks;
+                const uint32_t nbblocks = rd.ReadInt<uint32_t>();
+                for( uint32_t j = 0; j < nbblocks; ++j )
+                {
+                    eStringBlocks blkty = static_cast<eStringBlocks>( rd.ReadInt<uint32_t>() );
+                    strbounds_t   bnd;
+                    bnd.beg = rd.ReadInt<uint32_t>();
+                    bnd.end = rd.ReadInt<uint32_t>();
+                    blocks.emplace( blkty, std::move(bnd) );
+                }
+                catalog.AddStringBlocks( std::move(blocks) );
+                langs.emplace( std::move(key), std::move(catalog) );
+            }
+        }
+
+        // --- Script Data ---
+        //The lookup names for each entries of the NamedDataEntry tables are their name field, or for the string tables, the string itself.
+        static inline const std::string & GetEntryName( const std::string        & entry ) { return entry; }
+        template<class _EntryTy>
+            static inline const std::string & GetEntryName( const _EntryTy & entry )        { return entry.name; }
+
+        static inline void WriteEntry( utils::BinaryCacheWriter & wr, const gamevariable_info & entry )
+        {
+            wr.WriteInt<int16_t>(entry.type);
+            wr.WriteInt<int16_t>(entry.unk1);
+            wr.WriteInt<int16_t>(entry.memoffset);
+            wr.WriteInt<int16_t>(entry.bitshift);
+            wr.WriteInt<int16_t>(entry.unk3);
+            wr.WriteInt<int16_t>(entry.unk4);
+            wr.WriteStr(entry.name);
+        }
+
+        static inline void ReadEntry( utils::BinaryCacheReader & rd, gamevariable_info & entry )
+        {
+            entry.type      = rd.ReadInt<int16_t>();
+            entry.unk1      = rd.ReadInt<int16_t>();
+            entry.memoffset = rd.ReadInt<int16_t>();
+            entry.bitshift  = rd.ReadInt<int16_t>();
+            entry.unk3      = rd.ReadInt<int16_t>();
+            entry.unk4      = rd.ReadInt<int16_t>();
+            entry.name      = rd.ReadStr();
+        }
+
+        static inline void WriteEntry( utils::BinaryCacheWriter & wr, const livesent_info & entry )
+        {
+            wr.WriteStr(entry.name);
+            wr.WriteInt<int16_t>(entry.type);
+            wr.WriteInt<int16_t>(entry.entid);
+            wr.WriteInt<int16_t>(entry.unk3);
+            wr.WriteInt<int16_t>(entry.unk4);
+        }
+
+        static inline void ReadEntry( utils::BinaryCacheReader & rd, livesent_info & entry )
+        {
+            entry.name  = rd.ReadStr();
+            entry.type  = rd.ReadInt<int16_t>();
+            entry.entid = rd.ReadInt<int16_t>();
+            entry.unk3  = rd.ReadInt<int16_t>();
+            entry.unk4  = rd.ReadInt<int16_t>();
+        }
+
+        static inline void WriteEntry( utils::BinaryCacheWriter & wr, const level_info & entry )
+        {
+            wr.WriteStr(entry.name);
+            wr.WriteInt<int16_t>(entry.mapty);
+            wr.WriteInt<int16_t>(entry.unk2);
+            wr.WriteInt<int16_t>(entry.mapid);
+            wr.WriteInt<int16_t>(entry.unk4);
+        }
+
+        static inline void ReadEntry( utils::BinaryCacheReader & rd, level_info & entry )
+        {
+            entry.name  = rd.ReadStr();
+            entry.mapty = rd.ReadInt<int16_t>();
+            entry.unk2  = rd.ReadInt<int16_t>();
+            entry.mapid = rd.ReadInt<int16_t>();
+            entry.unk4  = rd.ReadInt<int16_t>();
+        }
+
+        static inline void WriteEntry( utils::BinaryCacheWriter & wr, const commonroutine_info & entry )
+        {
+            wr.WriteInt<int16_t>(entry.id);
+            wr.WriteInt<int16_t>(entry.unk1);
+            wr.WriteStr(entry.name);
+        }
+
+        static inline void ReadEntry( utils::BinaryCacheReader & rd, commonroutine_info & entry )
+        {
+            entry.id   = rd.ReadInt<int16_t>();
+            entry.unk1 = rd.ReadInt<int16_t>();
+            entry.name = rd.ReadStr();
+        }
+
+        static inline void WriteEntry( utils::BinaryCacheWriter & wr, const object_info & entry )
+        {
+            wr.WriteInt<int16_t>(entry.unk1);
+            wr.WriteInt<int16_t>(entry.unk2);
+            wr.WriteInt<int16_t>(entry.unk3);
+            wr.WriteStr(entry.name);
+        }
+
+        static inline void ReadEntry( utils::BinaryCacheReader & rd, object_info & entry )
+        {
+            entry.unk1 = rd.ReadInt<int16_t>();
+            entry.unk2 = rd.ReadInt<int16_t>();
+            entry.unk3 = rd.ReadInt<int16_t>();
+            entry.name = rd.ReadStr();
+        }
+
+        static inline void WriteEntry( utils::BinaryCacheWriter & wr, const std::string & entry )
+        {
+            wr.WriteStr(entry);
+        }
+
+        static inline void ReadEntry( utils::BinaryCacheReader & rd, std::string & entry )
+        {
+            entry = rd.ReadStr();
+        }
+
+        template<class _EntryTy>
+            void WriteNamedEntries( utils::BinaryCacheWriter & wr, const NamedDataEntry<_EntryTy> & entries )
+        {
+            wr.WriteInt<uint32_t>( static_cast<uint32_t>(entries.size()) );
+            for( const auto & entry : entries )
+                WriteEntry( wr, entry );
+        }
+
+        template<class _EntryTy>
+            void ReadNamedEntries( utils::BinaryCacheReader & rd, NamedDataEntry<_EntryTy> & entries )
+        {
+            const uint32_t nbentries = rd.ReadInt<uint32_t>();
+            for( uint32_t i = 0; i < nbentries; ++i )
+            {
+                _EntryTy entry;
+                ReadEntry( rd, entry );
+                entries.PushEntryPair( GetEntryName(entry), entry );
+            }
+        }
+
+        void WriteScriptData( utils::BinaryCacheWriter & wr, const GameScriptData & scrdata )
+        {
+            WriteNamedEntries( wr, scrdata.GameVariables() );
+            WriteNamedEntries( wr, scrdata.ExGameVariables() );
+            WriteNamedEntries( wr, scrdata.LivesEnt() );
+            WriteNamedEntries( wr, scrdata.LevelInfo() );
+            WriteNamedEntries( wr, scrdata.CommonRoutineInfo() );
+            WriteNamedEntries( wr, scrdata.FaceNames() );
+            WriteNamedEntries( wr, scrdata.FacePosModes() );
+            WriteNamedEntries( wr, scrdata.Directions() );
+            WriteNamedEntries( wr, scrdata.ObjectsInfo() );
+        }
+
+        void ReadScriptData( utils::BinaryCacheReader & rd, GameScriptData & scrdata )
+        {
+            ReadNamedEntries( rd, scrdata.GameVariables() );
+            ReadNamedEntries( rd, scrdata.ExGameVariables() );
+            ReadNamedEntries( rd, scrdata.LivesEnt() );
+            ReadNamedEntries( rd, scrdata.LevelInfo() );
+            ReadNamedEntries( rd, scrdata.CommonRoutineInfo() );
+            ReadNamedEntries( rd, scrdata.FaceNames() );
+            ReadNamedEntries( rd, scrdata.FacePosModes() );
+            ReadNamedEntries( rd, scrdata.Directions() );
+            ReadNamedEntries( rd, scrdata.ObjectsInfo() );
+        }
+
+        // --- ASM Patches ---
+        void WriteASMPatchData( utils::BinaryCacheWriter & wr, const GameASMPatchData & asmdata )
+        {
+            wr.WriteStr(asmdata.asmpatchdir);
+            wr.WriteInt<uint32_t>( static_cast<uint32_t>(asmdata.patches.size()) );
+            for( const auto & patch : asmdata.patches )
+            {
+                wr.WriteStr(patch.first);
+                wr.WriteStr(patch.second.id);
+                wr.WriteInt<uint32_t>( static_cast<uint32_t>(patch.second.steps.size()) );
+                for( const auto & step : patch.second.steps )
+                {
+                    wr.WriteInt<uint32_t>( static_cast<uint32_t>(step.op) );
+                    wr.WriteStr(step.param);
+                }
+            }
+            wr.WriteInt<uint32_t>( static_cast<uint32_t>(asmdata.lfentry.size()) );
+            for( const auto & lf : asmdata.lfentry )
+            {
+                wr.WriteInt<uint32_t>( static_cast<uint32_t>(lf.first) );
+                wr.WriteInt<uint32_t>( static_cast<uint32_t>(lf.second.src) );
+                wr.WriteStr(lf.second.path);
+            }
+        }
+
+        void ReadASMPatchData( utils::BinaryCacheReader & rd, GameASMPatchData & asmdata )
+        {
+            asmdata.asmpatchdir = rd.ReadStr();
+            const uint32_t nbpatches = rd.ReadInt<uint32_t>();
+            for( uint32_t i = 0; i < nbpatches; ++i )
+            {
+                std::string   key = rd.ReadStr();
+                asmpatchentry entry;
+                entry.id = rd.ReadStr();
+                const uint32_t nbsteps = rd.ReadInt<uint32_t>();
+                for( uint32_t j = 0; j < nbsteps; ++j )
+                {
+                    asmpatchentry::asmpatchstep step;
+                    step.op    = static_cast<asmpatchentry::eAsmPatchStep>( rd.ReadInt<uint32_t>() );
+                    step.param = rd.ReadStr();
+                    entry.steps.push_back( std::move(step) );
+                }
+                asmdata.patches.emplace( std::move(key), std::move(entry) );
+            }
+            const uint32_t nblfentries = rd.ReadInt<uint32_t>();
+            for( uint32_t i = 0; i < nblfentries; ++i )
+            {
+                eBinaryLocations  loc = static_cast<eBinaryLocations>( rd.ReadInt<uint32_t>() );
+                patchloosebinfile lf;
+                lf.src  = static_cast<eBinaryLocations>( rd.ReadInt<uint32_t>() );
+                lf.path = rd.ReadStr();
+                asmdata.lfentry.emplace( loc, std::move(lf) );
+            }
+        }
+
+    private:
+        std::string              m_confpath;
+        std::string              m_cachepath;
+        bool                     m_bbyarm9off;  //Whether the game version is looked up with arm9off14, or with version and region
+        uint16_t                 m_arm9off14;
+        eGameVersion             m_version;
+        eGameRegion              m_region;
+        bool                     m_bneedsrefresh;
+        std::vector<std::string> m_srcfiles;    //Source files listed in the last cache loaded
+    };
+
 
 //
 //
@@ -913,12 +1381,32 @@ namespace pmd2
 
     void ConfigLoader::Parse( uint16_t arm9off14 )
     {
-        ConfigXMLParser(m_conffile).ParseDataForGameVersion(arm9off14,*this);
+        ConfigBinCache cache(m_conffile, arm9off14);
+        if( cache.Load(*this) )
+        {
+            if( cache.NeedsRefresh() )
+                cache.Save(cache.SourceFiles(), *this);
+            return;
+        }
+
+        ConfigXMLParser parser(m_conffile);
+        parser.ParseDataForGameVersion(arm9off14,*this);
+        cache.Save(parser.GetSourceFiles(), *this);
     }
 
     void ConfigLoader::Parse(eGameVersion version, eGameRegion region)
     {
-        ConfigXMLParser(m_conffile).ParseDataForGameVersion(version, region, *this);
+        ConfigBinCache cache(m_conffile, version, region);
+        if( cache.Load(*this) )
+        {
+            if( cache.NeedsRefresh() )
+                cache.Save(cache.SourceFiles(), *this);
+            return;
+        }
+
+        ConfigXMLParser parser(m_conffile);
+        parser.ParseDataForGameVersion(version, region, *this);
+        cache.Save(parser.GetSourceFiles(), *this);
     }
 
 
@@ -17,6 +17,7 @@ Description: Loads on demand certain values from the config file!
 namespace pmd2
 {
     const std::string DefConfigFileName = "pmd2data.xml";
+    const std::string ConfigCacheFileExt = ".cache";
 
 //========================================================================================
 //  Entries in the configuration file
@@ -376,6 +377,7 @@ namespace pmd2
         }
 
         inline const std::string & GetConstAsString(eGameConstants cnst)const { return m_constants.at(cnst); }
+        inline const constcnt_t  & Constants()const                           { return m_constants; }
         
         template<typename _IntegerTy>
             _IntegerTy GetConstAsInt(eGameConstants cnst)const
@@ -458,6 +460,8 @@ namespace pmd2
                 return nullptr;
         }
 
+        inline const binfilesinf_t & Binaries()const { return m_info; }
+
         binarylocatioinfo FindInfoByLocation(eBinaryLocations location)const
         {
             binarylocatioinfo inf;
@@ -748,10 +752,15 @@ namespace pmd2
     /************************************************************************************
         ConfigLoader
             Load constants as needed from the XML file.
+
+            Once parsed, the data for the game version is saved to a binary cache next to 
+            the XML file ( ConfigCacheFileExt is appended to its name ). Later runs load
+            the cache instead, as long as none of the XML files it was built from changed.
     ************************************************************************************/
     class ConfigLoader
     {
         friend class ConfigXMLParser;
+        friend class ConfigBinCache;
 
         typedef std::unordered_map<eGameConstants,  std::string> constcnt_t;
     public:
@@ -6,6 +6,7 @@
 #include <utils/poco_wrapper.hpp>
 #include <utils/utility.hpp>
 #include <utils/library_wide.hpp>
+#include <utils/parallel_tasks.hpp>
 #include <Poco/Path.h>
 #include <Poco/File.h>
 #include <Poco/DirectoryIterator.h>
@@ -14,6 +15,7 @@
 #include <sstream>
 #include <iomanip>
 #include <functional>
+#include <chrono>
 using namespace std;
 using utils::logutil::slog;
 
@@ -547,22 +549,67 @@ namespace pmd2
         ExportGameScriptsXML(dir,*this, m_options); //We don't want pugixml to escape characters if we already did!!
     }
 
+    /*
+        Level directories don't share any state besides the read-only config and opcode tables,
+        so each of them is loaded/decompiled or compiled/written on its own thread.
+    */
     std::unordered_map<std::string, LevelScript> GameScripts::LoadAll()
     {
-        std::unordered_map<std::string, LevelScript> out;
+        typedef chrono::steady_clock clock_t;
+        const clock_t::time_point tstart = clock_t::now();
 
+        //Results are stored by index, and only moved into the map once all threads are done
+        vector<const evindex_t::value_type*> levels;
+        levels.reserve(m_setsindex.size());
         for( const auto & entry : m_setsindex )
-            out.emplace( entry.first, std::forward<LevelScript>(entry.second()) );
+            levels.push_back( std::addressof(entry) );
+
+        vector<LevelScript> loaded( levels.size(), LevelScript(string()) );
+        utils::parallel_for( 0, levels.size(), 1, [&]( size_t i )
+        {
+            loaded[i] = levels[i]->second();
+        });
+        const clock_t::time_point tloaded = clock_t::now();
 
+        std::unordered_map<std::string, LevelScript> out;
+        out.reserve(levels.size());
+        for( size_t i = 0; i < levels.size(); ++i )
+            out.emplace( levels[i]->first, std::move(loaded[i]) );
+
+        if( utils::LibWide().isLogOn() )
+        {
+            slog() << "GameScripts::LoadAll(): Loaded " <<levels.size() <<" level directories. Load+decompile: " 
+                   <<chrono::duration_cast<chrono::milliseconds>(tloaded - tstart).count() <<" ms, indexing: " 
+                   <<chrono::duration_cast<chrono::milliseconds>(clock_t::now() - tloaded).count() <<" ms\n";
+        }
         return std::move(out);
     }
 
     void GameScripts::WriteAll(const std::unordered_map<std::string, LevelScript>& stuff)
     {
+        typedef chrono::steady_clock clock_t;
+        const clock_t::time_point tstart = clock_t::now();
+
         WriteScriptSet(m_common);
+        const clock_t::time_point tcommon = clock_t::now();
 
+        //Look everything up first, so an unknown level is reported before anything is written
+        vector<pair<const ScrSetLoader*, const LevelScript*>> levels;
+        levels.reserve(stuff.size());
         for( const auto & entry : stuff )
-            m_setsindex.at(entry.first)(entry.second);
+            levels.emplace_back( std::addressof(m_setsindex.at(entry.first)), std::addressof(entry.second) );
+
+        utils::parallel_for( 0, levels.size(), 1, [&]( size_t i )
+        {
+            (*levels[i].first)(*levels[i].second);
+        });
+
+        if( utils::LibWide().isLogOn() )
+        {
+            slog() << "GameScripts::WriteAll(): Wrote " <<levels.size() <<" level directories. COMMON: " 
+                   <<chrono::duration_cast<chrono::milliseconds>(tcommon - tstart).count() <<" ms, compile+write: " 
+                   <<chrono::duration_cast<chrono::milliseconds>(clock_t::now() - tcommon).count() <<" ms\n";
+        }
     }
 
     LevelScript GameScripts::LoadScriptSet(const std::string & setname)
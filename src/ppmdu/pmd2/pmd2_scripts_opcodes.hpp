@@ -1045,15 +1045,11 @@ namespace pmd2
             return nullptr;
     }
 
-    inline eOpParamTypes FindOpParamTypesByName( const std::string & name )
-    {
-        for( size_t i = 0; i < OpParamTypesNames.size(); ++i )
-        {
-            if( OpParamTypesNames[i] == name )
-                return static_cast<eOpParamTypes>(i);
-        }
-        return eOpParamTypes::Invalid;
-    }
+    /*
+        FindOpParamTypesByName
+            Returns eOpParamTypes::Invalid if there are no parameter types with that name.
+    */
+    eOpParamTypes FindOpParamTypesByName( const std::string & name );
 
     struct OpParamInfo
     {
@@ -1143,15 +1139,12 @@ namespace pmd2
         return FindOpCodeInfo_EoTD( static_cast<uint16_t>(opcode) );
     }
 
-    inline eScriptOpCodesEoTD FindOpCodeByName_EoTD( const std::string & name, size_t nbparams )
-    {
-        for( size_t i = 0; i < OpCodesInfoListEoTD.size(); ++i )
-        {
-            if( OpCodesInfoListEoTD[i].name == name && OpCodesInfoListEoTD[i].nbparams == nbparams )
-                return static_cast<eScriptOpCodesEoTD>(i);
-        }
-        return eScriptOpCodesEoTD::INVALID;
-    }
+    /*************************************************************************************
+        FindOpCodeByName_EoTD
+            Returns the opcode with the specified name, that takes exactly "nbparams" parameters.
+            Returns eScriptOpCodesEoTD::INVALID if there are none.
+    *************************************************************************************/
+    eScriptOpCodesEoTD FindOpCodeByName_EoTD( const std::string & name, size_t nbparams );
 
     inline size_t GetNbOpCodes_EoTD()
     {
@@ -1214,6 +1207,12 @@ namespace pmd2
         return FindOpCodeInfo_EoS( static_cast<uint16_t>(opcode) );
     }
 
+    /*************************************************************************************
+        FindOpCodeByName_EoS
+            Returns the opcode with the specified name, that takes exactly "nbparams" parameters.
+            If there are none, returns the opcode with that name that takes a variable amount 
+            of parameters. Returns eScriptOpCodesEoS::INVALID if neither exist.
+    *************************************************************************************/
     eScriptOpCodesEoS FindOpCodeByName_EoS( const std::string & name, size_t nbparams );
 
 
@@ -1721,7 +1720,7 @@ namespace pmd2
         //GameVar Info
         inline const gamevariable_info * GameVarInfo( int16_t id )const 
         {
-            if( id > 0x400 ) //Extended game var starts at 0x400
+            if( id >= 0x400 ) //Extended game var starts at 0x400
                 return m_gconf.GetGameScriptData().ExGameVariables().FindByIndex(id - 0x400);
             else
                 return m_gconf.GetGameScriptData().GameVariables().FindByIndex(id);
@@ -1734,7 +1733,7 @@ namespace pmd2
             if( ret == std::numeric_limits<size_t>::max() )
             {
                 ret = m_gconf.GetGameScriptData().ExGameVariables().FindIndexByName(name);
-                if(ret != ret == std::numeric_limits<size_t>::max() )
+                if( ret != std::numeric_limits<size_t>::max() )
                     ret += 0x400; //Extended game var starts at 0x400
             }
 
@@ -1858,7 +1857,7 @@ namespace pmd2
         }
 
         template<int16_t _INVALIDID, class _EntryTy>
-            inline const std::string FindByIndex( _EntryTy container, int16_t id, const std::string & invalidstr = ScriptNullValName )const 
+            inline const std::string FindByIndex( const _EntryTy & container, int16_t id, const std::string & invalidstr = ScriptNullValName )const 
         { 
             if( id == _INVALIDID )
                 return invalidstr;
@@ -1876,7 +1875,7 @@ namespace pmd2
 
         //tryconverttoint : If true, will attempt converting to an integer when there are no matches!
         template<int16_t _INVALIDID, class _EntryTy>
-            inline int16_t FindIDByName( _EntryTy container, const std::string & name, const std::string & invalidstr = ScriptNullValName, bool tryconverttoint = true )const 
+            inline int16_t FindIDByName( const _EntryTy & container, const std::string & name, const std::string & invalidstr = ScriptNullValName, bool tryconverttoint = true )const 
         { 
             if( name == invalidstr )
                 return _INVALIDID;
@@ -539,7 +539,8 @@ namespace pmd2
                 - ptrres : Pointer to a compiler result for this particular file. Null if not used.
         *****************************************************************************************/
         SSBXMLParser( eGameVersion version, eGameRegion region, const ConfigLoader & conf, CompilerReport::compileresult * ptrres = nullptr )
-            :m_version(version), 
+            :m_nbinstparsed(0),
+             m_version(version), 
              m_region(region), 
              m_opinfo(version),
              m_gconf(conf), 
@@ -602,10 +603,28 @@ namespace pmd2
         *****************************************************************************************/
         inline void OffsetAllStringReferencesParameters()
         {
-            const size_t constblocksz = m_constqueue.size();
-            for( const auto & entry : m_stringrefparam )
+            if( m_stringrefparam.empty() )
+                return;
+
+            const uint16_t constblocksz = ToWord(m_constqueue.size());
+            auto           itref        = m_stringrefparam.begin();
+            size_t         instcnt      = 0;
+            auto lambdaOffsetInst = [&]( ScriptBaseInstruction & inst )
+            {
+                for( ; itref != m_stringrefparam.end() && itref->first == instcnt; ++itref )
+                    inst.parameters[itref->second] += constblocksz;
+                ++instcnt;
+            };
+
+            //Visit instructions in the order they were parsed in. Parent instructions come before their sub-instructions.
+            for( auto & routine : m_out.Routines() )
             {
-                (*entry) += ToWord(constblocksz);
+                for( auto & inst : routine )
+                {
+                    lambdaOffsetInst(inst);
+                    for( auto & subinst : inst.subinst )
+                        lambdaOffsetInst(subinst);
+                }
             }
         }
 
@@ -765,6 +784,7 @@ namespace pmd2
             m_labelchecker[labelid].bexists = true; //We know this label exists
 
             ScriptInstruction outinstr;
+            ++m_nbinstparsed;
             outinstr.type  = eInstructionType::MetaLabel;
             outinstr.value = labelid;
             outcnt.push_back(std::move(outinstr));
@@ -803,6 +823,7 @@ namespace pmd2
 
             OpCodeInfoWrapper opinfo = m_opinfo.Info(foundop);
             ScriptInstruction outinstr;
+            ++m_nbinstparsed;
             outinstr.value = foundop;
             outinstr.type  = opinfo.GetMyInstructionType();
 
@@ -851,6 +872,7 @@ namespace pmd2
             
             ScriptInstruction outinstr;
             outinstr.type = eInstructionType::Command;
+            ++m_nbinstparsed;
 
             //#1 - Try to count parameters
             bool                    hasstrings  = false;
@@ -1141,7 +1163,7 @@ namespace pmd2
 
                 //Add to the list of parameter only once per string, not per language!!!
                 outinstr.parameters.push_back( strindex );//save the idex it was inserted at
-                m_stringrefparam.push_back( std::addressof(outinstr.parameters.back()) ); //Then add this parameter value to the list of strings id to increment by the constant tbl len later on!
+                m_stringrefparam.push_back( std::make_pair(m_nbinstparsed - 1, outinstr.parameters.size() - 1) ); //Then add this parameter to the list of strings id to increment by the constant tbl len later on!
             }
         }
 
@@ -1471,7 +1493,9 @@ namespace pmd2
         unordered_map<eGameLanguages, deque<string>> m_strqueues;
 
         //A list of parameters containing a string index reference to be incremented after the size of the const table is known!
-        deque<uint16_t *>                            m_stringrefparam;  
+        // first is the index of the instruction in parsing order, second is the index of the parameter within that instruction.
+        vector<pair<size_t,size_t>>                  m_stringrefparam;  
+        size_t                                       m_nbinstparsed;    //Nb of instructions parsed so far, including labels and sub-instructions.
 
         Script           m_out;
         eGameVersion     m_version;
@@ -2157,12 +2181,18 @@ namespace pmd2
         }
 
         /*
+            ParseSets
+                Each set's nodes are removed from the document once the set was compiled. Pugixml only
+                releases a node page once every node in it was removed, and keeps the parsed file's buffer
+                until the document is destroyed, so this only trims part of the DOM while the scripts are compiled.
         */
         void ParseSets( xml_node & parentn, LevelScript::scriptsets_t & sets )
         {
             using namespace scriptXML;
-            for( auto & curset : parentn.children(NODE_ScriptSet.c_str()) )
+            xml_node nextset;
+            for( xml_node curset = parentn.child(NODE_ScriptSet.c_str()); curset; curset = nextset )
             {
+                nextset = curset.next_sibling(NODE_ScriptSet.c_str());
                 xml_attribute xname = curset.attribute(ATTR_GrpName.c_str());
                 if( !xname )
                 {
@@ -2184,6 +2214,7 @@ namespace pmd2
                         HandleData(comp, outset );
                 }
                 sets.push_back(std::forward<LevelScript::scriptsets_t::value_type>(outset));
+                parentn.remove_child(curset);
             }
         }
 
@@ -3244,6 +3275,8 @@ namespace pmd2
         /*
             WriteAsFile
                 Write the content of the level's script data to a single XML file.
+                Each set is built into its own small document, and streamed to the file 
+                right away, so we never hold the DOM of the whole level in memory.
         */
         void WriteAsFile(const std::string & destdir, const scriptprocoptions & options )
         {
@@ -3251,20 +3284,31 @@ namespace pmd2
             m_options = options;
             stringstream sstrfname;
             sstrfname << utils::TryAppendSlash(destdir) <<m_scrset.Name() <<".xml";
-            xml_document doc;
-            xml_node     xroot = doc.append_child( ROOT_ScripDir.c_str() );
+            m_xmlflags = (m_options.bescapepcdata)? pugi::format_default  :
+                                        pugi::format_indent | pugi::format_no_escapes;
 
-            SetPPMDU_RootNodeXMLAttributes(xroot, m_gconf.GetGameVersion().version, m_gconf.GetGameVersion().region);
-            //Write stuff
-            WriteLSDTable(xroot);
+            XMLRootStreamWriter xmlout( sstrfname.str(), "    "/*"\t"*/, m_xmlflags, pugi::encoding_utf8 );
+            {
+                xml_document doc;
+                xml_node     xroot = doc.append_child( ROOT_ScripDir.c_str() );
+                SetPPMDU_RootNodeXMLAttributes(xroot, m_gconf.GetGameVersion().version, m_gconf.GetGameVersion().region);
+                xmlout.BeginRoot(xroot);
+
+                //Write stuff
+                WriteLSDTable(xroot);
+                xmlout.WriteChildren(xroot);
+            }
 
             for( const auto & entry : m_scrset.Components() )
-                WriteSet(xroot,entry);
+            {
+                xml_document setdoc;
+                xml_node     xsetparent = setdoc.append_child( ROOT_ScripDir.c_str() );
+                WriteSet(xsetparent,entry);
+                xmlout.WriteChildren(xsetparent);
+            }
 
-            m_xmlflags = (m_options.bescapepcdata)? pugi::format_default  :
-                                        pugi::format_indent | pugi::format_no_escapes;
             //Write doc
-            if( ! doc.save_file( sstrfname.str().c_str(), "    "/*"\t"*/, m_xmlflags, pugi::encoding_utf8 ) )
+            if( ! xmlout.EndRoot() )
                 throw std::runtime_error("GameScriptsXMLWriter::Write(): PugiXML can't write xml file " + sstrfname.str());
         }
 
@@ -3515,22 +3559,12 @@ namespace pmd2
     }
 
     /*
-        PrintProgressLoop
-            To be run on a separate thread. Displays a percentage of "completed" on "total".
-            Stops looping when "bDoUpdate" is false.
+        PrintProgress
+            Progress hook for utils::parallel_for. Displays a percentage of "nbdone" on "total".
     */
-    void PrintProgressLoop( atomic<uint32_t> & completed, uint32_t total, atomic<bool> & bDoUpdate )
+    void PrintProgress( size_t nbdone, size_t total )
     {
-        static const chrono::milliseconds ProgressUpdThWait = chrono::milliseconds(200);
-        while( bDoUpdate )
-        {
-            if( completed.load() <= total )
-            {
-                uint32_t percent = ( (100 * completed.load()) / total );
-                cout << "\r" <<setw(3) <<setfill(' ') <<percent <<"%" <<setw(15) <<setfill(' ') <<" ";
-            }
-            this_thread::sleep_for(ProgressUpdThWait);
-        }
+        cout << "\r" <<setw(3) <<setfill(' ') <<((100 * nbdone) / total) <<"%" <<setw(15) <<setfill(' ') <<" ";
     }
 
     /*
@@ -3544,9 +3578,7 @@ namespace pmd2
 
         eGameRegion                  tempregion  = eGameRegion::Invalid;
         eGameVersion                 tempversion = eGameVersion::Invalid;
-        atomic_bool                  shouldUpdtProgress = true;
         atomic<uint32_t>             completed = 0;
-        future<void>                 updatethread;
         CompilerReport               reporter;
         //Grab our version and region from the 
         if(utils::LibWide().ShouldDisplayProgress())
@@ -3581,7 +3613,8 @@ namespace pmd2
         //Prepare import of everything else!
         //multitask::CMultiTaskHandler taskhandler;
 
-        utils::AsyncTaskHandler taskhandler;
+        utils::ThreadPool       taskhandler;
+        vector<future<bool>>    tasks;
         Poco::DirectoryIterator dirit(dir);
         Poco::DirectoryIterator dirend;
         if(utils::LibWide().isLogOn())
@@ -3598,13 +3631,13 @@ namespace pmd2
                 {
                     Poco::Path destination(out_dest.GetScriptDir());
                     destination.append(dirit.path().getBaseName());
-                    taskhandler.QueueTask( utils::AsyncTaskHandler::task_t( std::bind( RunLevelXMLImport, 
-                                                                         std::ref(out_dest), 
-                                                                         dirit->path(), 
-                                                                         destination.toString(),
-                                                                         std::ref(completed),
-                                                                         std::ref(reporter),
-                                                                         std::cref(options)) ) );
+                    tasks.push_back( taskhandler.Submit( std::bind( RunLevelXMLImport, 
+                                                                    std::ref(out_dest), 
+                                                                    dirit->path(), 
+                                                                    destination.toString(),
+                                                                    std::ref(completed),
+                                                                    std::ref(reporter),
+                                                                    std::cref(options)) ) );
                     if(utils::LibWide().isLogOn())
                         slog() << "\t+ " <<dirit.path().getBaseName() <<"\n";
                     ++cntdir;
@@ -3623,13 +3656,13 @@ namespace pmd2
 
                     Poco::Path destination(out_dest.GetScriptDir());
                     destination.append(dirit.path().getBaseName());
-                    taskhandler.QueueTask( utils::AsyncTaskHandler::task_t( std::bind( RunLevelXMLImport, 
-                                                                         std::ref(out_dest), 
-                                                                         dirit->path(), 
-                                                                         destination.toString(),
-                                                                         std::ref(completed),
-                                                                         std::ref(reporter),
-                                                                         std::cref(options)) ) );
+                    tasks.push_back( taskhandler.Submit( std::bind( RunLevelXMLImport, 
+                                                                    std::ref(out_dest), 
+                                                                    dirit->path(), 
+                                                                    destination.toString(),
+                                                                    std::ref(completed),
+                                                                    std::ref(reporter),
+                                                                    std::cref(options)) ) );
                     if(utils::LibWide().isLogOn())
                         slog() << "\t+ " <<dirit.path().getFileName() <<"\n";
                     ++cntdir;
@@ -3642,29 +3675,24 @@ namespace pmd2
             slog() << "Done listing " <<cntdir <<" entries\n\n";
         try
         {
-            if( !taskhandler.empty() )
+            if( !tasks.empty() )
             {
+                if(utils::LibWide().isLogOn())
+                    slog() << "Running import tasks..\n";
                 if(utils::LibWide().ShouldDisplayProgress())
                 {
                     assert(!out_dest.m_setsindex.empty());
                     cout<<"\n<*>- Compiling Scripts..\n";
-                    std::packaged_task<void()> task( std::bind(&PrintProgressLoop, 
-                                                               std::ref(completed), 
-                                                               taskhandler.size(), 
-                                                               std::ref(shouldUpdtProgress)) );
-                    updatethread = std::move(task.get_future());
-                    std::thread(std::move(task)).detach();
+                    //Update the progress whenever a task completes, without getting any exception yet
+                    for( auto & task : tasks )
+                    {
+                        task.wait();
+                        PrintProgress( completed.load(), tasks.size() );
+                    }
                 }
-                if(utils::LibWide().isLogOn())
-                    slog() << "Running import tasks..\n";
-                taskhandler.Start();
-                taskhandler.WaitTasksFinished();
-                taskhandler.WaitStop();
+                taskhandler.WaitAll();
             }
 
-            shouldUpdtProgress = false;
-            if(updatethread.valid())
-                updatethread.get();
             if(utils::LibWide().ShouldDisplayProgress())
                 cout<<"\r100%"; //Can't be bothered to make another drawing update
 
@@ -3674,12 +3702,13 @@ namespace pmd2
             if( !options.basdir ) //We need to specify the nb when imported as XML files
                 reporter.SetNbExpected( cntdir + 1 ); //Add one for the unionall.ssb script!
             reporter.PrintErrorReport(outputresult); 
+
+            //Rethrow any failed import only once the report is written
+            for( auto & task : tasks )
+                task.get();
         }
         catch(...)
         {
-            shouldUpdtProgress = false;
-            if(updatethread.valid())
-                updatethread.get();
             std::rethrow_exception( std::current_exception() );
         }
 
@@ -3702,58 +3731,31 @@ namespace pmd2
             cout<<"<*>- Writing COMMOM.xml..";
         GameScriptsXMLWriter(gs.m_common, gs.GetConfig() ).Write(dir, options);
 
-        atomic_bool                  shouldUpdtProgress = true;
-        future<void>                 updtProgress;
         atomic<uint32_t>             completed = 0;
-        //multitask::CMultiTaskHandler taskhandler;
-        utils::AsyncTaskHandler      taskhandler;
+        vector<const ScrSetLoader*>  levels;
         if(utils::LibWide().isLogOn())
             slog() << "<*>- Listing level directories to export..\n";
         //Export everything else
+        levels.reserve(gs.m_setsindex.size());
         for( const auto & entry : gs.m_setsindex )
         {
-            taskhandler.QueueTask( utils::AsyncTaskHandler::task_t( std::bind( RunLevelXMLExport, 
-                                                                 std::cref(entry.second), 
-                                                                 std::cref(dir), 
-                                                                 std::cref(gs.GetConfig()),
-                                                                 std::cref(options),
-                                                                 std::ref(completed) ) ) );
+            levels.push_back(&entry.second);
             if(utils::LibWide().isLogOn())
                 slog() << "\t+ " << utils::GetBaseNameOnly(entry.first) <<"\n";
         }
         if(utils::LibWide().isLogOn())
             slog() << "Done listing " <<gs.m_setsindex.size() <<" directories.\n\n";
 
-        try
-        {
-            if(utils::LibWide().ShouldDisplayProgress())
-            {
-                cout<<"\n<*>- Exporting the rest..\n";
-                updtProgress = std::async( std::launch::async, 
-                                           PrintProgressLoop, 
-                                           std::ref(completed), 
-                                           gs.m_setsindex.size(), 
-                                           std::ref(shouldUpdtProgress) );
-            }
-            if(utils::LibWide().isLogOn())
-                slog() << "Running export tasks..\n";
-            taskhandler.Start();
-            taskhandler.WaitTasksFinished();
-            taskhandler.WaitStop();
-
-            shouldUpdtProgress = false;
-            if( updtProgress.valid() )
-                updtProgress.get();
-            if(utils::LibWide().ShouldDisplayProgress())
-                cout<<"\r100%"; //Can't be bothered to make another drawing update
-        }
-        catch(...)
+        if(utils::LibWide().ShouldDisplayProgress())
+            cout<<"\n<*>- Exporting the rest..\n";
+        if(utils::LibWide().isLogOn())
+            slog() << "Running export tasks..\n";
+
+        utils::parallel_ctrl progress(PrintProgress);
+        utils::parallel_for( 0, levels.size(), 1, [&]( size_t i )
         {
-            shouldUpdtProgress = false;
-            if( updtProgress.valid() )
-                updtProgress.get();
-            std::rethrow_exception( std::current_exception() );
-        }
+            RunLevelXMLExport( *levels[i], dir, gs.GetConfig(), options, completed );
+        }, (utils::LibWide().ShouldDisplayProgress())? &progress : nullptr );
 
         if(utils::LibWide().ShouldDisplayProgress())
             cout<<"\n";
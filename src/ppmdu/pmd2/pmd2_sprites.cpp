@@ -2,10 +2,13 @@
 #include <utils/utility.hpp>
 #include <types/content_type_analyser.hpp>
 #include <ppmdu/pmd2/sprite_rle.hpp>
+#include <utils/parallel_tasks.hpp>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
 #include <cassert>
+#include <algorithm>
+#include <unordered_map>
 
 using namespace ::std;
 using namespace ::pmd2;
@@ -26,6 +29,77 @@ namespace pmd2
     //========================================================================================================
     // Utility Functions
     //========================================================================================================
+        /*
+            spr_occurences
+                Counts how many times each value of a variable occured.
+                The values are counted in a hash map, and only sorted when the list is requested.
+        */
+        template<class T>
+            class spr_occurences
+        {
+        public:
+            typedef pair< int, T > occur_t;
+
+            inline void Add( T value )
+            {
+                ++(m_counts[value]);
+            }
+
+            void Merge( const spr_occurences<T> & other )
+            {
+                for( const auto & entry : other.m_counts )
+                    m_counts[entry.first] += entry.second;
+            }
+
+            /*
+                SortedByNbOfOccurences
+                    Returns the nb of occurences of each value, from most common to least common.
+                    Values that occured as many times are sorted by value.
+            */
+            vector<occur_t> SortedByNbOfOccurences()const
+            {
+                vector<occur_t> sorted;
+                sorted.reserve( m_counts.size() );
+                for( const auto & entry : m_counts )
+                    sorted.push_back( occur_t( entry.second, entry.first ) );
+
+                std::sort( sorted.begin(), sorted.end(), []( const occur_t & elem1, const occur_t & elem2 )->bool
+                {
+                    if( elem1.first != elem2.first )
+                        return elem1.first > elem2.first;
+                    return elem1.second < elem2.second;
+                });
+                return std::move(sorted);
+            }
+
+        private:
+            unordered_map<T, int> m_counts;
+        };
+
+        /*
+            CompileStatistics
+                Runs all the entries through a _StatsTy object, over several threads. 
+                Each chunk of entries gets its own _StatsTy object, and they're merged in order at the end.
+        */
+        template<class _StatsTy, class _EntryTy>
+            _StatsTy CompileStatistics( const vector<const _EntryTy*> & entries )
+        {
+            static const size_t NbEntriesPerChunk = 4096; //Most sprites fit in a single chunk, and don't need any extra threads
+            vector<_StatsTy>    chunkstats( (entries.size() + NbEntriesPerChunk - 1) / NbEntriesPerChunk );
+
+            utils::RunChunked( 0, entries.size(), NbEntriesPerChunk, [&]( size_t chunkbeg, size_t chunkend )
+            {
+                _StatsTy & stats = chunkstats[chunkbeg / NbEntriesPerChunk];
+                for( size_t i = chunkbeg; i < chunkend; ++i )
+                    stats( *(entries[i]) );
+            });
+
+            _StatsTy result;
+            for( const auto & stats : chunkstats )
+                result.Merge(stats);
+            return std::move(result);
+        }
+
         /*
             spr_varstats
                 Struct that contains statistics about variables..
@@ -69,6 +143,18 @@ namespace pmd2
                     return *this;
                 }
 
+                datablock_i_sum & operator+=( const datablock_i_sum & other )
+                {
+                    this->sum_unk0  += other.sum_unk0;
+                    this->sum_index += other.sum_index;
+                    this->sum_val0  += other.sum_val0;
+                    this->sum_val1  += other.sum_val1;
+                    this->sum_val2  += other.sum_val2;
+                    this->sum_val3  += other.sum_val3;
+
+                    return *this;
+                }
+
                 datablock_i_entry operator/( int32_t other )const
                 {
                     datablock_i_entry result;
@@ -112,22 +198,34 @@ namespace pmd2
 
                 ++m_nbentriesanalysed;
             }
+
+            /*
+                Merge
+                    Adds the values analysed by another instance to this one's.
+            */
+            void Merge( const spr_varstats & other )
+            {
+                m_sum += other.m_sum;
+                m_max.AssignMembersIfGreaterThan( other.m_max );
+                m_min.AssignMembersIfSmallerThan( other.m_min );
+                m_nbentriesanalysed += other.m_nbentriesanalysed;
+
+                m_occurences_unk0.Merge( other.m_occurences_unk0 );
+                m_occurences_index.Merge( other.m_occurences_index );
+                m_occurences_val0.Merge( other.m_occurences_val0 );
+                m_occurences_val1.Merge( other.m_occurences_val1 );
+                m_occurences_val2.Merge( other.m_occurences_val2 );
+                m_occurences_val3.Merge( other.m_occurences_val3 );
+            }
             
             /*
                 WriteStatistics
                     Write a report on values found inside this.
             */
-            string WriteStatistics()
+            string WriteStatistics()const
             {
                 stringstream strs;
 
-                sortOccurencesByNbOfOccurences(m_occurences_unk0);
-                sortOccurencesByNbOfOccurences(m_occurences_index);
-                sortOccurencesByNbOfOccurences(m_occurences_val0);
-                sortOccurencesByNbOfOccurences(m_occurences_val1);
-                sortOccurencesByNbOfOccurences(m_occurences_val2);
-                sortOccurencesByNbOfOccurences(m_occurences_val3);
-
                 strs <<"Datablock I Data Range:\n"
                      <<"-----------------------------\n"
                      <<"    Max:\n"
@@ -199,104 +297,28 @@ namespace pmd2
                     Writes a list of occurences to a string, from most common, to least common.
             */
             template< class T >
-                string occurencesToString( const vector< pair< int, T > > & occurvec )const
+                string occurencesToString( const spr_occurences<T> & occurences )const
             {
                 stringstream strs;
 
-                for( const pair< int, T > & anoccurence : occurvec )
+                for( const pair< int, T > & anoccurence : occurences.SortedByNbOfOccurences() )
                     strs <<setfill(' ') <<setw(4) <<anoccurence.second <<" has occured " <<setfill(' ') <<setw(4) <<anoccurence.first <<" time(s)!\n";
 
                 return strs.str();
             }
 
-            /*
-                sortOccurencesByValue
-            */
-            template< class T >
-                void sortOccurencesByValue( vector< pair< int, T > > & occurvec )
-            {
-                typedef pair< int, T > occur_t;
-                static auto lambdaisgreaterthan = []( const occur_t & elem1, const occur_t & elem2 )->bool
-                {
-                    return elem1.second > elem2.second;
-                };
-
-                std::sort( occurvec.begin(), occurvec.end(), lambdaisgreaterthan );
-            }
-
-
-            /*
-                sortOccurencesByNbOfOccurences
-            */
-            template< class T >
-                void sortOccurencesByNbOfOccurences( vector< pair< int, T > > & occurvec )
-            {
-                typedef pair< int, T > occur_t;
-                static auto lambdaisgreaterthan = []( const occur_t & elem1, const occur_t & elem2 )->bool
-                {
-                    return elem1.first > elem2.first;
-                };
-
-                std::sort( occurvec.begin(), occurvec.end(), lambdaisgreaterthan );
-            }
-
-            /*
-                findoccurence
-            */
-            template<class T>
-               typename vector<pair<int, typename T> >::iterator findoccurence( vector< pair<int, T> > & vecoccur, T lookingfor )
-            {
-                return std::find_if( vecoccur.begin(), vecoccur.end(), [&lookingfor]( pair<int, T> & thatoccur ){ return lookingfor == thatoccur.second; } );
-            }
-
-            /*
-                incrementOccurenceCounterIfExistAddIfNot
-            */
-            template<class T>
-                void incrementOccurenceCounterIfExistAddIfNot( vector< pair<int, T> > & vecoccur, T newoccur )
-            {
-                typedef pair< int, T > occur_t;
-                auto found  = findoccurence( vecoccur, newoccur );
-
-                //If we found it, increment its occurence counter
-                if( found != vecoccur.end() )
-                    ++(found->first);
-                else
-                {
-                    //Insert the entry so that its inserted before the first larger value found
-                    auto foundinspos = std::find_if( vecoccur.begin(), 
-                                                     vecoccur.end(), 
-                                                     [&newoccur](occur_t& aoccur)
-                                                     {
-                                                         return aoccur.second > newoccur;
-                                                     } );
-
-                    //Handle 2 special cases to avoid trying to move the iterator out of range
-                    if( foundinspos != vecoccur.end() && foundinspos != vecoccur.begin() )
-                    {
-                        unsigned int insertposfrombeg = (distance(vecoccur.begin(), foundinspos) - 1);
-                        foundinspos = vecoccur.begin();
-                        advance( foundinspos, insertposfrombeg );
-                    }
-
-                    vecoccur.insert( foundinspos, make_pair<int, T>( 1, std::move(newoccur)) );
-                }
-            }
-
             /*
                 handleOccurence
-                    Handles each occurence of a value for the variables we got. If its a new value
-                    increment our occurence counter for that value. If not add it to the occurence list !
+                    Counts one more occurence of the value of each of the variables.
             */
             void handleOccurence( const datablock_i_entry & anoccurence )
             {
-                //find id already in there
-                incrementOccurenceCounterIfExistAddIfNot( m_occurences_unk0, anoccurence.Unk0 );
-                incrementOccurenceCounterIfExistAddIfNot( m_occurences_index, anoccurence.Index );
-                incrementOccurenceCounterIfExistAddIfNot( m_occurences_val0, anoccurence.Val0 );
-                incrementOccurenceCounterIfExistAddIfNot( m_occurences_val1, anoccurence.Val1 );
-                incrementOccurenceCounterIfExistAddIfNot( m_occurences_val2, anoccurence.Val2 );
-                incrementOccurenceCounterIfExistAddIfNot( m_occurences_val3, anoccurence.Val3 );
+                m_occurences_unk0.Add( anoccurence.Unk0 );
+                m_occurences_index.Add( anoccurence.Index );
+                m_occurences_val0.Add( anoccurence.Val0 );
+                m_occurences_val1.Add( anoccurence.Val1 );
+                m_occurences_val2.Add( anoccurence.Val2 );
+                m_occurences_val3.Add( anoccurence.Val3 );
             }
 
             //average, maximum, and minimum for all values in the datablock
@@ -306,12 +328,12 @@ namespace pmd2
             uint32_t          m_nbentriesanalysed; //Contain the current nubmer of entries we've ran the "operator()" on this far
 
             //List of occurences all values
-            vector< pair< int, decltype(datablock_i_entry::Unk0) > >  m_occurences_unk0;
-            vector< pair< int, decltype(datablock_i_entry::Index)> >  m_occurences_index;
-            vector< pair< int, decltype(datablock_i_entry::Val0) > >  m_occurences_val0;
-            vector< pair< int, decltype(datablock_i_entry::Val1) > >  m_occurences_val1;
-            vector< pair< int, decltype(datablock_i_entry::Val2) > >  m_occurences_val2;
-            vector< pair< int, decltype(datablock_i_entry::Val3) > >  m_occurences_val3;
+            spr_occurences< decltype(datablock_i_entry::Unk0) >   m_occurences_unk0;
+            spr_occurences< decltype(datablock_i_entry::Index) >  m_occurences_index;
+            spr_occurences< decltype(datablock_i_entry::Val0) >   m_occurences_val0;
+            spr_occurences< decltype(datablock_i_entry::Val1) >   m_occurences_val1;
+            spr_occurences< decltype(datablock_i_entry::Val2) >   m_occurences_val2;
+            spr_occurences< decltype(datablock_i_entry::Val3) >   m_occurences_val3;
         };
 
 
@@ -356,6 +378,17 @@ namespace pmd2
                     return *this;
                 }
 
+                datablock_s_sum & operator+=( const datablock_s_sum & other )
+                {
+                    this->sum_id    += other.sum_id;
+                    this->sum_val0  += other.sum_val0;
+                    this->sum_val1  += other.sum_val1;
+                    this->sum_val2  += other.sum_val2;
+                    this->sum_val3  += other.sum_val3;
+
+                    return *this;
+                }
+
                 datablock_s_entry operator/( int32_t other )const
                 {
                     datablock_s_entry result;
@@ -398,21 +431,33 @@ namespace pmd2
 
                 ++m_nbentriesanalysed;
             }
+
+            /*
+                Merge
+                    Adds the values analysed by another instance to this one's.
+            */
+            void Merge( const spr_dbs_varstats & other )
+            {
+                m_sum += other.m_sum;
+                m_max.AssignMembersIfGreaterThan( other.m_max );
+                m_min.AssignMembersIfSmallerThan( other.m_min );
+                m_nbentriesanalysed += other.m_nbentriesanalysed;
+
+                m_occurences_id.Merge( other.m_occurences_id );
+                m_occurences_val0.Merge( other.m_occurences_val0 );
+                m_occurences_val1.Merge( other.m_occurences_val1 );
+                m_occurences_val2.Merge( other.m_occurences_val2 );
+                m_occurences_val3.Merge( other.m_occurences_val3 );
+            }
             
             /*
                 WriteStatistics
                     Write a report on values found inside this.
             */
-            string WriteStatistics()
+            string WriteStatistics()const
             {
                 stringstream strs;
 
-                sortOccurencesByNbOfOccurences(m_occurences_id);
-                sortOccurencesByNbOfOccurences(m_occurences_val0);
-                sortOccurencesByNbOfOccurences(m_occurences_val1);
-                sortOccurencesByNbOfOccurences(m_occurences_val2);
-                sortOccurencesByNbOfOccurences(m_occurences_val3);
-
                 strs <<"Datablock S Data Range:\n"
                      <<"-----------------------------\n"
                      <<"    Max:\n"
@@ -481,103 +526,27 @@ namespace pmd2
                     Writes a list of occurences to a string, from most common, to least common.
             */
             template< class T >
-                string occurencesToString( const vector< pair< int, T > > & occurvec )const
+                string occurencesToString( const spr_occurences<T> & occurences )const
             {
                 stringstream strs;
 
-                for( const pair< int, T > & anoccurence : occurvec )
+                for( const pair< int, T > & anoccurence : occurences.SortedByNbOfOccurences() )
                     strs <<"0x" <<setfill('0') <<setw(4)  <<hex  <<uppercase <<static_cast<uint32_t>(anoccurence.second) <<nouppercase <<dec <<" has occured " <<setfill(' ') <<setw(4) <<anoccurence.first <<" time(s)!\n";
 
                 return strs.str();
             }
 
-            /*
-                sortOccurencesByValue
-            */
-            template< class T >
-                void sortOccurencesByValue( vector< pair< int, T > > & occurvec )
-            {
-                typedef pair< int, T > occur_t;
-                static auto lambdaisgreaterthan = []( const occur_t & elem1, const occur_t & elem2 )->bool
-                {
-                    return elem1.second > elem2.second;
-                };
-
-                std::sort( occurvec.begin(), occurvec.end(), lambdaisgreaterthan );
-            }
-
-
-            /*
-                sortOccurencesByNbOfOccurences
-            */
-            template< class T >
-                void sortOccurencesByNbOfOccurences( vector< pair< int, T > > & occurvec )
-            {
-                typedef pair< int, T > occur_t;
-                static auto lambdaisgreaterthan = []( const occur_t & elem1, const occur_t & elem2 )->bool
-                {
-                    return elem1.first > elem2.first;
-                };
-
-                std::sort( occurvec.begin(), occurvec.end(), lambdaisgreaterthan );
-            }
-
-            /*
-                findoccurence
-            */
-            template<class T>
-               typename vector<pair<int, typename T> >::iterator findoccurence( vector< pair<int, T> > & vecoccur, T lookingfor )
-            {
-                return std::find_if( vecoccur.begin(), vecoccur.end(), [&lookingfor]( pair<int, T> & thatoccur ){ return lookingfor == thatoccur.second; } );
-            }
-
-            /*
-                incrementOccurenceCounterIfExistAddIfNot
-            */
-            template<class T>
-                void incrementOccurenceCounterIfExistAddIfNot( vector< pair<int, T> > & vecoccur, T newoccur )
-            {
-                typedef pair< int, T > occur_t;
-                auto found  = findoccurence( vecoccur, newoccur );
-
-                //If we found it, increment its occurence counter
-                if( found != vecoccur.end() )
-                    ++(found->first);
-                else
-                {
-                    //Insert the entry so that its inserted before the first larger value found
-                    auto foundinspos = std::find_if( vecoccur.begin(), 
-                                                     vecoccur.end(), 
-                                                     [&newoccur](occur_t& aoccur)
-                                                     {
-                                                         return aoccur.second > newoccur;
-                                                     } );
-
-                    //Handle 2 special cases to avoid trying to move the iterator out of range
-                    if( foundinspos != vecoccur.end() && foundinspos != vecoccur.begin() )
-                    {
-                        unsigned int insertposfrombeg = (distance(vecoccur.begin(), foundinspos) - 1);
-                        foundinspos = vecoccur.begin();
-                        advance( foundinspos, insertposfrombeg );
-                    }
-
-                    vecoccur.insert( foundinspos, make_pair<int, T>( 1, std::move(newoccur)) );
-                }
-            }
-
             /*
                 handleOccurence
-                    Handles each occurence of a value for the variables we got. If its a new value
-                    increment our occurence counter for that value. If not add it to the occurence list !
+                    Counts one more occurence of the value of each of the variables.
             */
             void handleOccurence( const datablock_s_entry & anoccurence )
             {
-                //find id already in there
-                incrementOccurenceCounterIfExistAddIfNot( m_occurences_id, anoccurence.id );
-                incrementOccurenceCounterIfExistAddIfNot( m_occurences_val0, anoccurence.val0 );
-                incrementOccurenceCounterIfExistAddIfNot( m_occurences_val1, anoccurence.val1 );
-                incrementOccurenceCounterIfExistAddIfNot( m_occurences_val2, anoccurence.val2 );
-                incrementOccurenceCounterIfExistAddIfNot( m_occurences_val3, anoccurence.val3 );
+                m_occurences_id.Add( anoccurence.id );
+                m_occurences_val0.Add( anoccurence.val0 );
+                m_occurences_val1.Add( anoccurence.val1 );
+                m_occurences_val2.Add( anoccurence.val2 );
+                m_occurences_val3.Add( anoccurence.val3 );
             }
 
             //average, maximum, and minimum for all values in the datablock
@@ -587,11 +556,11 @@ namespace pmd2
             uint32_t          m_nbentriesanalysed; //Contain the current nubmer of entries we've ran the "operator()" on this far
 
             //List of occurences all values
-            vector< pair< int, decltype(datablock_s_entry::id) > >  m_occurences_id;
-            vector< pair< int, decltype(datablock_s_entry::val0) > >  m_occurences_val0;
-            vector< pair< int, decltype(datablock_s_entry::val1) > >  m_occurences_val1;
-            vector< pair< int, decltype(datablock_s_entry::val2) > >  m_occurences_val2;
-            vector< pair< int, decltype(datablock_s_entry::val3) > >  m_occurences_val3;
+            spr_occurences< decltype(datablock_s_entry::id) >     m_occurences_id;
+            spr_occurences< decltype(datablock_s_entry::val0) >   m_occurences_val0;
+            spr_occurences< decltype(datablock_s_entry::val1) >   m_occurences_val1;
+            spr_occurences< decltype(datablock_s_entry::val2) >   m_occurences_val2;
+            spr_occurences< decltype(datablock_s_entry::val3) >   m_occurences_val3;
         };
 
     //========================================================================================================
@@ -1346,8 +1315,8 @@ namespace pmd2
 
         std::string SpriteUnkRefTable::WriteReport()const
         {
-            stringstream strs;
-            spr_varstats stats;
+            stringstream                     strs;
+            vector<const datablock_i_entry*> analysedentries;
 
             strs <<"-------------------------\nDatablock G,H,I Details:\n-------------------------\n"
                  <<"Total Nb Entries Table G : " <<m_datablockG.size() <<"\n\n";
@@ -1369,8 +1338,8 @@ namespace pmd2
                             strs <<"                I-" <<cpti <<"- Content:\n"
                                  <<m_datablockI[curhptr][cpti].toString( 20 );
 
-                            //Compile statistics
-                            stats(m_datablockI[curhptr][cpti]);
+                            //Compile statistics later on
+                            analysedentries.push_back( &(m_datablockI[curhptr][cpti]) );
                         }
                     }
                 }
@@ -1383,7 +1352,7 @@ namespace pmd2
             }
 
             strs <<"\n-------------------------\nDatablock I Analysis:\n-------------------------\n\n"
-                 <<stats.WriteStatistics()
+                 <<CompileStatistics<spr_varstats>(analysedentries).WriteStatistics()
                  <<"\n";
 
             return strs.str();
@@ -1894,18 +1863,19 @@ namespace pmd2
             }
 
             //#7 - Write details on datablock S
-            spr_dbs_varstats mydbsstats;
+            vector<const datablock_s_entry*> analysedentries;
+            analysedentries.reserve( m_datablockE.size() );
             myreport <<"\n"
                      <<"-------------\nDatablock E/S:\n--------------\n";
             for( decltype(m_datablockE.size()) cpte = 0; cpte < m_datablockE.size(); ++cpte )
             {
-                mydbsstats(m_datablockE[cpte]);
+                analysedentries.push_back( &(m_datablockE[cpte]) );
                 myreport <<"    S-" <<cpte <<"- Content:\n"
                          <<m_datablockE[cpte].toString(8);
             }
             myreport <<"\n"
                      <<"-------------\nDatablock E/S Analysis:\n--------------\n"
-                     <<mydbsstats.WriteStatistics()
+                     <<CompileStatistics<spr_dbs_varstats>(analysedentries).WriteStatistics()
                      <<"\n";
 
             return myreport.str();
@@ -156,7 +156,7 @@ namespace ppx_compress
 		     << "-> outputpath(opt) : folder to output the file(s) to, or output filename.\n\n\n"
              << "Options:\n"
              << "   -" <<OPTION_COMPRESSION_LVL <<" (compression level) : Sets the compression level. Value from\n"
-             << "                            0 to 3.\n"
+             << "                            0 to 4.\n"
              << "                             0 : Disable compression, only format data\n"
              << "                                 so the game can read it as a compressed\n"
              << "                                 file!\n"
@@ -165,6 +165,9 @@ namespace ppx_compress
              << "                             2 : The above, plus a few extra cases.\n"
              << "                             3 : All the above, plus enable matching\n"
              << "                                 string compression. Basically LZ..\n"
+             << "                             4 : Same as 3, but searches for the\n"
+             << "                                 combination of operations giving the\n"
+             << "                                 smallest output. Slower.\n"
              << "   -"<<OPTION_ZEALOUS <<"                     : Zealous search. This means that instead\n"
              << "                            of avoiding searching through the \n"
              << "                            lookback buffer as often as possible it will\n"
@@ -233,7 +236,7 @@ namespace ppx_compress
 
                         //Verify if the compression lvl is valid
                         if( clvl >= static_cast<unsigned int>(ePXCompLevel::LEVEL_0) && 
-                            clvl <= static_cast<unsigned int>(ePXCompLevel::LEVEL_3) )
+                            clvl <= static_cast<unsigned int>(ePXCompLevel::LEVEL_4) )
                         {
                             if( !params.isQuiet )
                                 cout<<"-" <<OPTION_COMPRESSION_LVL <<" specified, compressing using level " <<clvl <<" compression !\n";
@@ -4,7 +4,7 @@
 #include <ppmdu/utils/utility.hpp>
 #include <ppmdu/pmd2/pmd2_filetypes.hpp>
 #include <types/content_type_analyser.hpp>
-#include <ppmdu/utils/multiple_task_handler.hpp>
+#include <utils/parallel_tasks.hpp>
 #include <ppmdu/utils/library_wide.hpp>
 #include <ppmdu/utils/cmdline_util.hpp>
 #include <Poco/DirectoryIterator.h>
@@ -23,7 +23,6 @@ using namespace std;
 using namespace utils;
 using namespace pmd2;
 using namespace pmd2::graphics;
-using namespace multitask;
 
 namespace pspr_analyser
 {
@@ -101,10 +100,11 @@ namespace pspr_analyser
     /**********************************************************************************************************
         Read all sprites over several worker threads!
     **********************************************************************************************************/
-    vector< vector<uint8_t> > ReadSpritesToBuffers( const vector<string> & spritespaths, CMultiTaskHandler & taskmanager )
+    vector< vector<uint8_t> > ReadSpritesToBuffers( const vector<string> & spritespaths, ThreadPool & taskmanager )
     {
         vector< vector<uint8_t> > buffers(spritespaths.size());
         completion_t              mycompletion = { 0, spritespaths.size(), 1, 3 };
+        vector<future<bool>>      tasks;
 
         //A lambda wrapper to get over the bug in msvc2012 where a packaged_task can't have a void return value..
         auto lambdaread = [&mycompletion](const std::string & path, std::vector<uint8_t> & out_filedata )->bool
@@ -117,10 +117,11 @@ namespace pspr_analyser
 
         for( unsigned int i = 0; i < buffers.size(); ++i )
         {
-            taskmanager.AddTask( pktask_t( bind( lambdaread, std::ref( spritespaths[i] ), std::ref( buffers[i] ) ) ) );
+            tasks.push_back( taskmanager.Submit( bind( lambdaread, std::ref( spritespaths[i] ), std::ref( buffers[i] ) ) ) );
         }
-        taskmanager.Execute();
-        taskmanager.BlockUntilTaskQueueEmpty();
+        taskmanager.WaitAll();
+        for( auto & task : tasks )
+            task.get();
 
         return std::move( buffers );
     }
@@ -130,12 +131,13 @@ namespace pspr_analyser
     **********************************************************************************************************/
     vector<CCharSpriteData> ParseSprites( const vector<vector<uint8_t> > & filesRawData, 
                                           vector<string>                 & spritereports, 
-                                          CMultiTaskHandler              & taskmanager, 
+                                          ThreadPool                     & taskmanager, 
                                           const vector<string>           & spritespaths )
     {
         typedef tuple<types::constitbyte_t,types::constitbyte_t, vector<CCharSpriteData>::iterator> inputdata; 
         vector<CCharSpriteData> filesSpriteData( filesRawData.size() );
         completion_t            mycompletion = { 0, spritespaths.size(), 2, 3 };
+        vector<future<bool>>    tasks;
 
         //A lambda wrapper to get over the bug in msvc2012 where a packaged_task can't have a void return value..
         auto lambdaparse = [&mycompletion](inputdata indata, std::string & report, const std::string & curfilepath)->bool
@@ -160,11 +162,12 @@ namespace pspr_analyser
                                         std::ref( spritereports[i] ), 
                                         std::ref( spritespaths[i]  ) 
                                        );
-                taskmanager.AddTask( pktask_t(std::move(myfunction)) );
+                tasks.push_back( taskmanager.Submit( std::move(myfunction) ) );
             }
         }
-        taskmanager.Execute();
-        taskmanager.BlockUntilTaskQueueEmpty();
+        taskmanager.WaitAll();
+        for( auto & task : tasks )
+            task.get();
 
         return std::move(filesSpriteData);
     }
@@ -173,9 +176,10 @@ namespace pspr_analyser
     /**********************************************************************************************************
         Generates and output the reports for all sprite files we parsed!
     **********************************************************************************************************/
-    void WriteAllReports( vector< CCharSpriteData > & spritedata, const string & outputpath, const vector<string> & spritespaths, vector< string >& spritereports, CMultiTaskHandler & taskhandler )
+    void WriteAllReports( vector< CCharSpriteData > & spritedata, const string & outputpath, const vector<string> & spritespaths, vector< string >& spritereports, ThreadPool & taskhandler )
     {
-        completion_t completion = { 0, spritedata.size(), 3, 3 };
+        completion_t         completion = { 0, spritedata.size(), 3, 3 };
+        vector<future<bool>> tasks;
 
         for( unsigned int i = 0; i < spritedata.size(); ++i )
         {
@@ -184,14 +188,15 @@ namespace pspr_analyser
                            <<GetPathWithoutFileExt( GetFilenameFromPath( spritespaths[i] ) )
                            <<".log";
 
-            taskhandler.AddTask( 
-                                 pktask_t( 
-                                 bind( WriteOutAReport, std::ref(spritedata[i]), reportfilename.str(), std::ref(spritereports[i]), &completion )
-                                         )
-                                );
+            tasks.push_back( 
+                             taskhandler.Submit( 
+                             bind( WriteOutAReport, std::ref(spritedata[i]), reportfilename.str(), std::ref(spritereports[i]), &completion )
+                                               )
+                           );
         }
-        taskhandler.Execute();
-        taskhandler.BlockUntilTaskQueueEmpty();
+        taskhandler.WaitAll();
+        for( auto & task : tasks )
+            task.get();
         cerr <<"\n";
     }
 
@@ -203,7 +208,7 @@ namespace pspr_analyser
         vector<string>          spritereports(spritespaths.size());
         vector<vector<uint8_t> > filesRawData;
         vector<CCharSpriteData> filesSpriteData;
-        CMultiTaskHandler       taskhandler;
+        ThreadPool              taskhandler;
 
         cerr <<"Analysing " <<spritespaths.size() <<" file(s)..\n"
              <<"Outputing reports to \"" <<outputpath <<"\"\n\n";
@@ -217,8 +222,6 @@ namespace pspr_analyser
         //#3 - Generate and output report for all sprite files.
         WriteAllReports( filesSpriteData, outputpath, spritespaths, spritereports, taskhandler );
 
-        taskhandler.StopExecute();
-
         return 0;
     }
 
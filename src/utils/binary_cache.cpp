@@ -0,0 +1,192 @@
+#include "binary_cache.hpp"
+#include <utils/gfileio.hpp>
+#include <utils/poco_wrapper.hpp>
+#include <Poco/File.h>
+#include <Poco/TemporaryFile.h>
+#include <Poco/Path.h>
+using namespace std;
+
+namespace utils
+{
+    static const size_t CacheHeaderLen   = 16;  //magic number, version, checksum
+
+    /*
+        Fills in the size and modification time of the file, and whether it exists.
+    */
+    static void StatCacheSrcFile( cachesrcfile & srcf )
+    {
+        Poco::File src(srcf.path);
+        srcf.bexists = src.exists() && src.isFile();
+        srcf.size    = 0;
+        srcf.mtime   = 0;
+        if( srcf.bexists )
+        {
+            srcf.size  = src.getSize();
+            srcf.mtime = src.getLastModified().epochMicroseconds();
+        }
+    }
+
+    static uint64_t HashCacheSrcFile( const std::string & path )
+    {
+        vector<uint8_t> fdata;
+        io::ReadFileToByteVector( path, fdata );
+        return HashBytesFNV1a( fdata.begin(), fdata.end() );
+    }
+
+    /*
+        Returns whether the source file is still the same as when the cache was built.
+        The content is only hashed when the size matches, but the modification time doesn't.
+    */
+    static bool IsCacheSrcFileUnchanged( const cachesrcfile & srcf, int64_t & out_curmtime )
+    {
+        cachesrcfile cur;
+        cur.path = srcf.path;
+        StatCacheSrcFile(cur);
+        out_curmtime = cur.mtime;
+
+        if( cur.bexists != srcf.bexists )
+            return false;
+        if( !cur.bexists )
+            return true;
+        if( cur.size != srcf.size )
+            return false;
+        if( cur.mtime == srcf.mtime )
+            return true;
+        return HashCacheSrcFile(srcf.path) == srcf.hash;
+    }
+
+    /*
+        Writes to a temporary file first, and then renames it over the cache file in a single step, 
+        so other processes reading the cache at the same time never see a partial or missing file.
+    */
+    static void WriteCacheFile( const std::string & cachepath, const std::vector<uint8_t> & filedata )
+    {
+        const string tmppath = Poco::TemporaryFile::tempName( Poco::Path(cachepath).makeAbsolute().parent().toString() ); //Same directory, so the rename can't cross file systems
+        try
+        {
+            io::WriteByteVectorToFile( tmppath, filedata );
+            RenameReplaceExisting( tmppath, cachepath );
+        }
+        catch(...)
+        {
+            Poco::File tmpf(tmppath);
+            if( tmpf.exists() )
+                tmpf.remove();
+            throw;
+        }
+    }
+
+//======================================================================================
+//  BinaryCacheWriter
+//======================================================================================
+    void BinaryCacheWriter::AddSourceFile( const std::string & path )
+    {
+        cachesrcfile srcf;
+        srcf.path = path;
+        StatCacheSrcFile(srcf);
+        if( srcf.bexists )
+            srcf.hash = HashCacheSrcFile(path);
+        m_srcfiles.push_back( std::move(srcf) );
+    }
+
+    void BinaryCacheWriter::WriteStr( const std::string & str )
+    {
+        WriteInt<uint32_t>( static_cast<uint32_t>(str.size()) );
+        m_data.insert( m_data.end(), str.begin(), str.end() );
+    }
+
+    void BinaryCacheWriter::Save( const std::string & cachepath, uint32_t magicn, uint32_t version )const
+    {
+        //The list of source files comes before the cached data
+        vector<uint8_t> body;
+        auto            itbody = back_inserter(body);
+        body.reserve( m_data.size() + 1024 );
+        WriteIntToBytes<uint32_t>( static_cast<uint32_t>(m_srcfiles.size()), itbody );
+        for( const auto & srcf : m_srcfiles )
+        {
+            WriteIntToBytes<uint32_t>( static_cast<uint32_t>(srcf.path.size()), itbody );
+            body.insert( body.end(), srcf.path.begin(), srcf.path.end() );
+            WriteIntToBytes<uint8_t> ( (srcf.bexists)? 1 : 0, itbody );
+            WriteIntToBytes<uint64_t>( srcf.size,  itbody );
+            WriteIntToBytes<int64_t> ( srcf.mtime, itbody );
+            WriteIntToBytes<uint64_t>( srcf.hash,  itbody );
+        }
+        body.insert( body.end(), m_data.begin(), m_data.end() );
+
+        vector<uint8_t> filedata;
+        auto            itfile = back_inserter(filedata);
+        filedata.reserve( body.size() + CacheHeaderLen );
+        WriteIntToBytes<uint32_t>( magicn,  itfile );
+        WriteIntToBytes<uint32_t>( version, itfile );
+        WriteIntToBytes<uint64_t>( HashBytesFNV1a( body.begin(), body.end() ), itfile );
+        filedata.insert( filedata.end(), body.begin(), body.end() );
+
+        WriteCacheFile( cachepath, filedata );
+    }
+
+//======================================================================================
+//  BinaryCacheReader
+//======================================================================================
+    bool BinaryCacheReader::Load( const std::string & cachepath, uint32_t magicn, uint32_t version )
+    {
+        m_data.clear();
+        m_srcfiles.clear();
+        m_pos           = 0;
+        m_bneedsrefresh = false;
+
+        Poco::File cachef(cachepath);
+        if( !cachef.exists() || !cachef.isFile() )
+            return false;
+
+        try
+        {
+            io::ReadFileToByteVector( cachepath, m_data );
+            if( m_data.size() < CacheHeaderLen   ||
+                ReadInt<uint32_t>() != magicn    ||
+                ReadInt<uint32_t>() != version )
+                return false;
+
+            const uint64_t checksum = ReadInt<uint64_t>();
+            if( HashBytesFNV1a( m_data.begin() + CacheHeaderLen, m_data.end() ) != checksum )
+                return false;
+
+            const uint32_t nbsrcfiles = ReadInt<uint32_t>();
+            for( uint32_t i = 0; i < nbsrcfiles; ++i )
+            {
+                cachesrcfile srcf;
+                srcf.path    = ReadStr();
+                srcf.bexists = ReadInt<uint8_t>() != 0;
+                srcf.size    = ReadInt<uint64_t>();
+                srcf.mtime   = ReadInt<int64_t>();
+                srcf.hash    = ReadInt<uint64_t>();
+
+                int64_t curmtime = 0;
+                if( !IsCacheSrcFileUnchanged(srcf, curmtime) )
+                    return false;
+                if( curmtime != srcf.mtime )
+                    m_bneedsrefresh = true; //Same content, but the file was touched
+                m_srcfiles.push_back( std::move(srcf.path) );
+            }
+        }
+        catch( const std::exception & )
+        {
+            //A cache we can't read is just a stale cache
+            m_data.clear();
+            m_srcfiles.clear();
+            m_pos           = 0;
+            m_bneedsrefresh = false;
+            return false;
+        }
+        return true;
+    }
+
+    std::string BinaryCacheReader::ReadStr()
+    {
+        const uint32_t len = ReadInt<uint32_t>();
+        if( (m_data.size() - m_pos) < len )
+            throw std::runtime_error("BinaryCacheReader::ReadStr(): Not enough data left in the cache!");
+        string str( m_data.begin() + m_pos, m_data.begin() + m_pos + len );
+        m_pos += len;
+        return std::move(str);
+    }
+};
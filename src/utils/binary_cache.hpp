@@ -0,0 +1,132 @@
+#ifndef BINARY_CACHE_HPP
+#define BINARY_CACHE_HPP
+/*
+binary_cache.hpp
+psycommando@gmail.com
+Description: Utilities for keeping a binary snapshot of data that's slow to build from its source files,
+             like the content of a large XML file once parsed.
+*/
+#include <utils/gbyteutils.hpp>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <stdexcept>
+
+namespace utils
+{
+    /************************************************************************
+        cachesrcfile
+            The state of a source file a binary cache was built from.
+            A source file that didn't exist is still tracked, so the cache
+            is rebuilt if it gets created later on.
+    ************************************************************************/
+    struct cachesrcfile
+    {
+        std::string path;
+        bool        bexists = false;
+        uint64_t    size    = 0;
+        int64_t     mtime   = 0;   //Last modification time, in microseconds since the epoch
+        uint64_t    hash    = 0;   //FNV-1a hash of the file's content
+    };
+
+    /************************************************************************
+        BinaryCacheWriter
+            Accumulates the data to put into a binary cache file, along with
+            the list of source files the data was built from.
+
+            The file begins with the magic number and format version given
+            when saving, followed by a checksum of everything after it.
+            All integers are little endian.
+    ************************************************************************/
+    class BinaryCacheWriter
+    {
+    public:
+        /*
+            AddSourceFile
+                Records the current state of a file the cached data depends on.
+        */
+        void AddSourceFile( const std::string & path );
+
+        template<class T>
+            inline void WriteInt( T val )
+        {
+            WriteIntToBytes( val, std::back_inserter(m_data) );
+        }
+
+        void WriteStr( const std::string & str );
+
+        /*
+            Save
+                Writes the cache file. Throws on failure.
+        */
+        void Save( const std::string & cachepath, uint32_t magicn, uint32_t version )const;
+
+    private:
+        std::vector<cachesrcfile> m_srcfiles;
+        std::vector<uint8_t>      m_data;
+    };
+
+    /************************************************************************
+        BinaryCacheReader
+            Loads a binary cache file written by BinaryCacheWriter, and
+            reads back its data in the order it was written in.
+    ************************************************************************/
+    class BinaryCacheReader
+    {
+    public:
+        BinaryCacheReader()
+            :m_pos(0), m_bneedsrefresh(false)
+        {}
+
+        /*
+            Load
+                Returns false if the cache file doesn't exist, was made for another format version,
+                is corrupted, or if any of its source files changed since it was written.
+                The caller is expected to rebuild the data from the source files in that case.
+
+                A source file with a new modification time, but with the same content is still 
+                considered unchanged. NeedsRefresh() then returns true, and the caller may save
+                the cache again, so the file isn't hashed on every load. Load never writes anything.
+        */
+        bool Load( const std::string & cachepath, uint32_t magicn, uint32_t version );
+
+        //Whether a source file was touched without being modified since the cache was saved.
+        inline bool                             NeedsRefresh()const { return m_bneedsrefresh; }
+
+        //The source files recorded in the cache, in the order they were added.
+        inline const std::vector<std::string> & SourceFiles()const  { return m_srcfiles; }
+
+        /*
+            Throws if reading past the end of the cached data.
+        */
+        template<class T>
+            inline T ReadInt()
+        {
+            static_assert( std::numeric_limits<T>::is_integer, "BinaryCacheReader::ReadInt(): Type T is not an integer!" );
+            typedef typename std::make_unsigned<T>::type uint_t;
+            if( (m_data.size() - m_pos) < sizeof(T) )
+                throw std::runtime_error("BinaryCacheReader::ReadInt(): Not enough data left in the cache!");
+
+            uint_t val = 0;
+            for( size_t i = 0; i < sizeof(T); ++i )
+                val |= static_cast<uint_t>(m_data[m_pos + i]) << (i * 8);
+            m_pos += sizeof(T);
+            return static_cast<T>(val);
+        }
+
+        std::string ReadStr();
+
+        inline bool AtEnd()const { return m_pos == m_data.size(); }
+
+    private:
+        std::vector<uint8_t>     m_data;
+        size_t                   m_pos;
+        std::vector<std::string> m_srcfiles;
+        bool                     m_bneedsrefresh;
+    };
+};
+
+#endif
@@ -534,6 +534,26 @@ namespace utils
         return lenpadding;
     }
 
+    /*********************************************************************************************
+        HashBytesFNV1a
+            Computes the 64 bits FNV-1a hash of a range of bytes. 
+            Its fast and simple, and is meant for indexing data by content, not for anything cryptographic.
+            Pass the value returned as "hash" to continue hashing over several ranges.
+    *********************************************************************************************/
+    static const uint64_t FNV1a64_OffsetBasis = 14695981039346656037ULL;
+    static const uint64_t FNV1a64_Prime       = 1099511628211ULL;
+
+    template<class _init>
+        inline uint64_t HashBytesFNV1a( _init itbeg, _init itend, uint64_t hash = FNV1a64_OffsetBasis )
+    {
+        for( ; itbeg != itend; ++itbeg )
+        {
+            hash ^= static_cast<uint8_t>(*itbeg);
+            hash *= FNV1a64_Prime;
+        }
+        return hash;
+    }
+
 //===============================================================================
 //								Utility
 //===============================================================================
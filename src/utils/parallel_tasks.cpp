@@ -47,6 +47,266 @@ namespace utils
         return TryPop(out_task);
     }
 
+//======================================================================================================================================
+//  ThreadPool
+//======================================================================================================================================
+    namespace
+    {
+        //Lets a task submitted from a worker thread go to that worker's own queue
+        thread_local const ThreadPool * t_pcurpool    = nullptr;
+        thread_local size_t             t_workerindex = 0;
+    };
+
+    ThreadPool::ThreadPool( size_t nbthreads )
+        :m_nextqueue(0), m_nbqueued(0), m_nbunfinished(0), m_nbparked(0), m_nbwaiting(0), m_bstop(false)
+    {
+        if( nbthreads == 0 )
+            nbthreads = 1;
+
+        for( size_t i = 0; i < nbthreads; ++i )
+            m_queues.push_back( std::unique_ptr<WorkerQueue>(new WorkerQueue) );
+
+        for( size_t i = 0; i < nbthreads; ++i )
+            m_threads.push_back( std::thread( &ThreadPool::WorkerLoop, this, i ) );
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lck(m_mtxpark);
+            m_bstop = true;
+        }
+        m_cvnewjob.notify_all();
+
+        for( auto & th : m_threads )
+        {
+            if( th.joinable() )
+                th.join();
+        }
+    }
+
+    void ThreadPool::WaitAll()
+    {
+        std::unique_lock<std::mutex> lck(m_mtxpark);
+        ++m_nbwaiting;
+        m_cvidle.wait( lck, [this](){ return m_nbunfinished == 0; } );
+        --m_nbwaiting;
+    }
+
+    void ThreadPool::PushJob( job_t && job )
+    {
+        const size_t queueindex = (t_pcurpool == this)? t_workerindex : (m_nextqueue++ % m_queues.size());
+
+        //Count the job before it can be popped, so the counters never go below 0
+        ++m_nbunfinished;
+        ++m_nbqueued;
+        {
+            std::lock_guard<std::mutex> lck(m_queues[queueindex]->mtx);
+            m_queues[queueindex]->jobs.push_back( std::move(job) );
+        }
+
+        //A worker parks only after registering in m_nbparked, and checking m_nbqueued while holding m_mtxpark.
+        // So either it sees the new job, or we see it parked, and taking the lock makes sure it's waiting before we notify.
+        if( m_nbparked > 0 )
+        {
+            { std::lock_guard<std::mutex> lck(m_mtxpark); }
+            m_cvnewjob.notify_one();
+        }
+    }
+
+    bool ThreadPool::TryPopOwn( size_t workerindex, job_t & out_job )
+    {
+        WorkerQueue & q = *m_queues[workerindex];
+        std::lock_guard<std::mutex> lck(q.mtx);
+        if( q.jobs.empty() )
+            return false;
+        out_job = std::move(q.jobs.front());
+        q.jobs.pop_front();
+        return true;
+    }
+
+    bool ThreadPool::TrySteal( size_t workerindex, job_t & out_job )
+    {
+        for( size_t i = 1; i < m_queues.size(); ++i )
+        {
+            WorkerQueue & q = *m_queues[(workerindex + i) % m_queues.size()];
+            std::lock_guard<std::mutex> lck(q.mtx);
+            if( !q.jobs.empty() )
+            {
+                out_job = std::move(q.jobs.back());
+                q.jobs.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ThreadPool::WorkerLoop( size_t workerindex )
+    {
+        t_pcurpool    = this;
+        t_workerindex = workerindex;
+
+        while(true)
+        {
+            job_t job;
+            if( TryPopOwn(workerindex, job) || TrySteal(workerindex, job) )
+            {
+                --m_nbqueued;
+                job(); //Exceptions end up in the task's future
+
+                //Same handshake as in PushJob, with the threads in WaitAll
+                if( --m_nbunfinished == 0 && m_nbwaiting > 0 )
+                {
+                    { std::lock_guard<std::mutex> lck(m_mtxpark); }
+                    m_cvidle.notify_all();
+                }
+                continue;
+            }
+
+            //Nothing to run, so park until something gets queued
+            std::unique_lock<std::mutex> lck(m_mtxpark);
+            ++m_nbparked;
+            m_cvnewjob.wait( lck, [this](){ return m_bstop || m_nbqueued > 0; } );
+            --m_nbparked;
+            if( m_bstop && m_nbqueued == 0 )
+                return;
+        }
+    }
+
+//======================================================================================================================================
+//  Parallel Algorithms
+//======================================================================================================================================
+    ThreadPool & SharedThreadPool()
+    {
+        static ThreadPool s_pool;
+        return s_pool;
+    }
+
+    namespace
+    {
+        /*
+            State shared between a RunChunked call and the helper jobs it queued on the shared pool.
+            Helpers that only start once the caller is done see "bclosed" and leave without touching anything else,
+            since the caller's stack, where chunkfn and pctrl live, might be gone by then.
+        */
+        struct chunkedrun_state
+        {
+            chunkedrun_state( size_t beg, size_t end, size_t grain, const std::function<void(size_t,size_t)> & fn, parallel_ctrl * pctrl )
+                :beg(beg), end(end), grain(grain), nbchunks( (end - beg + grain - 1) / grain ), 
+                 pchunkfn(&fn), pctrl(pctrl), nextchunk(0), bshouldabort(false), nbactive(0), bclosed(false)
+            {}
+
+            //Each thread grabs the next chunk nobody's working on, until there are none left
+            void RunChunks()
+            {
+                for( size_t chunk = nextchunk++; chunk < nbchunks; chunk = nextchunk++ )
+                {
+                    if( bshouldabort || (pctrl && pctrl->bcancel) )
+                        return;
+
+                    const size_t chunkbeg = beg + (chunk * grain);
+                    const size_t chunkend = std::min( chunkbeg + grain, end );
+                    try
+                    {
+                        (*pchunkfn)( chunkbeg, chunkend );
+
+                        if( pctrl )
+                        {
+                            pctrl->nbdone += (chunkend - chunkbeg);
+                            if( pctrl->onprogress )
+                            {
+                                lock_guard<mutex> lck(mtxprogress);
+                                pctrl->onprogress( pctrl->nbdone.load(), end - beg );
+                            }
+                        }
+                    }
+                    catch(...)
+                    {
+                        lock_guard<mutex> lck(mtxprogress);
+                        if( !firstexception )
+                            firstexception = current_exception();
+                        bshouldabort = true;
+                        if( pctrl )
+                            pctrl->bcancel = true;
+                        return;
+                    }
+                }
+            }
+
+            //Run by the jobs queued on the pool
+            void HelpRun()
+            {
+                {
+                    lock_guard<mutex> lck(mtxactive);
+                    if( bclosed )
+                        return;
+                    ++nbactive;
+                }
+
+                RunChunks();
+
+                bool bislast = false;
+                {
+                    lock_guard<mutex> lck(mtxactive);
+                    bislast = (--nbactive == 0);
+                }
+                if( bislast )
+                    cvactive.notify_all();
+            }
+
+            //Run by the caller once its own loop is over. Stops any late helper, and waits for the ones still busy.
+            void CloseAndWait()
+            {
+                unique_lock<mutex> lck(mtxactive);
+                bclosed = true;
+                cvactive.wait( lck, [this](){ return nbactive == 0; } );
+            }
+
+            const size_t                                     beg;
+            const size_t                                     end;
+            const size_t                                     grain;
+            const size_t                                     nbchunks;
+            const std::function<void(size_t,size_t)>       * pchunkfn;
+            parallel_ctrl                                  * pctrl;
+            atomic<size_t>                                   nextchunk;
+            atomic<bool>                                     bshouldabort;
+            mutex                                            mtxprogress;
+            exception_ptr                                    firstexception; //Guarded by mtxprogress
+
+            mutex                                            mtxactive;
+            condition_variable                               cvactive;
+            size_t                                           nbactive;       //Guarded by mtxactive
+            bool                                             bclosed;        //Guarded by mtxactive
+        };
+    };
+
+    void RunChunked( size_t                                     beg,
+                     size_t                                     end,
+                     size_t                                     grain,
+                     const std::function<void(size_t,size_t)> & chunkfn,
+                     parallel_ctrl                            * pctrl )
+    {
+        if( end <= beg )
+            return;
+        if( grain == 0 )
+            grain = 1;
+
+        auto         pstate    = std::make_shared<chunkedrun_state>( beg, end, grain, chunkfn, pctrl );
+        ThreadPool & pool      = SharedThreadPool();
+        const size_t nbthreads = std::min<size_t>( utils::LibWide().getNbThreadsToUse(), pstate->nbchunks );
+
+        //The calling thread works too, so only queue the extra helpers needed. 
+        //When called from within the pool, they go on the current worker's own deque, for idle workers to steal.
+        for( size_t i = 1; i < nbthreads; ++i )
+            pool.Submit( [pstate](){ pstate->HelpRun(); } );
+
+        pstate->RunChunks();
+        pstate->CloseAndWait();
+
+        if( pstate->firstexception )
+            rethrow_exception(pstate->firstexception);
+    }
+
 //======================================================================================================================================
 //  Worker
 //======================================================================================================================================
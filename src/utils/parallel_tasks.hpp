@@ -13,6 +13,13 @@ Description: A set of utilities for handling multi-threaded tasks execution. Mea
 #include <vector>
 #include <deque>
 #include <future>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <type_traits>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
 
 namespace utils
 {
@@ -86,6 +93,197 @@ namespace utils
     };
 
 
+//======================================================================================================================================
+//  ThreadPool
+//======================================================================================================================================
+    /*
+        ThreadPool
+            A pool of worker threads, each with its own task deque. 
+            
+            Tasks submitted from outside the pool are spread over the workers' deques in turn, while tasks submitted 
+            from within a task go to the current worker's own deque. Workers run their own tasks in order, and once 
+            they run out, steal from the back of the other workers' deques. Idle workers sleep on a condition variable
+            instead of polling.
+
+            Submit returns a future, which rethrows any exception the task threw when calling get().
+            The destructor runs any task left, then joins all threads.
+    */
+    class ThreadPool
+    {
+    public:
+        typedef std::function<void()> job_t;
+
+        explicit ThreadPool( size_t nbthreads = utils::LibWide().getNbThreadsToUse() );
+        ~ThreadPool();
+
+        /*
+            Submit
+                Queue a callable taking no parameters. Returns a future on its return value.
+        */
+        template<class _Fn>
+            std::future<typename std::result_of<_Fn()>::type> Submit( _Fn && fn )
+        {
+            typedef typename std::result_of<_Fn()>::type ret_t;
+            //std::function needs to be copyable, so keep the packaged_task in a shared_ptr
+            auto ptask = std::make_shared<std::packaged_task<ret_t()>>( std::forward<_Fn>(fn) );
+            std::future<ret_t> fut = ptask->get_future();
+            PushJob( [ptask](){ (*ptask)(); } );
+            return std::move(fut);
+        }
+
+        /*
+            WaitAll
+                Blocks until every task submitted so far has completed. 
+                Must not be called from within a task.
+        */
+        void WaitAll();
+
+        inline size_t NbThreads()const { return m_threads.size(); }
+
+    private:
+        struct WorkerQueue
+        {
+            std::mutex         mtx;
+            std::deque<job_t>  jobs;
+        };
+
+        void PushJob  ( job_t && job );
+        bool TryPopOwn( size_t workerindex, job_t & out_job );
+        bool TrySteal ( size_t workerindex, job_t & out_job );
+        void WorkerLoop( size_t workerindex );
+
+        ThreadPool( const ThreadPool & );
+        ThreadPool & operator=( const ThreadPool & );
+
+    private:
+        std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+        std::vector<std::thread>                  m_threads;
+        std::atomic<size_t>                       m_nextqueue;     //Queue where the next task from outside the pool goes
+
+        //Only used to park and wake threads. The queues each have their own lock.
+        std::mutex                                m_mtxpark;
+        std::condition_variable                   m_cvnewjob;      //Signaled when a job is queued, or when stopping
+        std::condition_variable                   m_cvidle;        //Signaled when the last unfinished job completes
+        std::atomic<size_t>                       m_nbqueued;      //Jobs waiting in a queue
+        std::atomic<size_t>                       m_nbunfinished;  //Jobs submitted, but not completed yet
+        std::atomic<size_t>                       m_nbparked;      //Workers sleeping, or about to, on m_cvnewjob
+        std::atomic<size_t>                       m_nbwaiting;     //Threads sleeping, or about to, in WaitAll
+        bool                                      m_bstop;         //Guarded by m_mtxpark
+    };
+
+    /*
+        SharedThreadPool
+            The pool the parallel algorithms below queue their work on. Created on first use, 
+            with LibWide().getNbThreadsToUse() threads.
+    */
+    ThreadPool & SharedThreadPool();
+
+//======================================================================================================================================
+//  Parallel Algorithms
+//======================================================================================================================================
+    /*
+        parallel_ctrl
+            Optional state shared with a running parallel_for, parallel_transform or parallel_reduce.
+            - bcancel    : Set it to make the workers skip every chunk they haven't started yet.
+                           Its also set when a chunk throws.
+            - nbdone     : Nb of items processed so far. Updated after each chunk.
+            - onprogress : If set, called after each chunk with nbdone and the total nb of items. Calls never overlap.
+    */
+    struct parallel_ctrl
+    {
+        typedef std::function<void(size_t,size_t)> progressfn_t;
+
+        parallel_ctrl( progressfn_t && progressfn = progressfn_t() )
+            :bcancel(false), nbdone(0), onprogress(std::move(progressfn))
+        {}
+
+        std::atomic<bool>   bcancel;
+        std::atomic<size_t> nbdone;
+        progressfn_t        onprogress;
+    };
+
+    /*
+        RunChunked
+            Splits [beg, end) into chunks of "grain" items, and calls chunkfn(chunkbeg, chunkend) on each of them
+            from up to LibWide().getNbThreadsToUse() threads, the calling thread included. The other threads are 
+            SharedThreadPool()'s workers, so nested calls never start more threads. Returns once all threads are done.
+            Cancellation is checked between chunks. The first exception thrown by chunkfn is rethrown once all threads stopped.
+    */
+    void RunChunked( size_t                                     beg,
+                     size_t                                     end,
+                     size_t                                     grain,
+                     const std::function<void(size_t,size_t)> & chunkfn,
+                     parallel_ctrl                            * pctrl = nullptr );
+
+    /*
+        parallel_for
+            Calls fn(i) for every i in [beg, end), "grain" consecutive indices per chunk.
+    */
+    template<class _Fn>
+        void parallel_for( size_t beg, size_t end, size_t grain, _Fn && fn, parallel_ctrl * pctrl = nullptr )
+    {
+        RunChunked( beg, end, grain, [&fn]( size_t chunkbeg, size_t chunkend )
+        {
+            for( size_t i = chunkbeg; i < chunkend; ++i )
+                fn(i);
+        }, pctrl );
+    }
+
+    /*
+        parallel_transform
+            Same as std::transform, with the items split in chunks of "grain" over several threads.
+            Both iterators must be random access, and the output range must already be large enough.
+    */
+    template<class _InIt, class _OutIt, class _Fn>
+        _OutIt parallel_transform( _InIt itbeg, _InIt itend, _OutIt itout, size_t grain, _Fn && fn, parallel_ctrl * pctrl = nullptr )
+    {
+        const size_t nbitems = static_cast<size_t>( std::distance(itbeg, itend) );
+        RunChunked( 0, nbitems, grain, [&]( size_t chunkbeg, size_t chunkend )
+        {
+            for( size_t i = chunkbeg; i < chunkend; ++i )
+                itout[i] = fn( itbeg[i] );
+        }, pctrl );
+        return itout + nbitems;
+    }
+
+    /*
+        parallel_reduce
+            Returns the reduction of mapfn(i) for every i in [beg, end), starting from "init".
+            Each chunk is reduced on its own, then "init" and the chunk results are reduced in order, so as long as "reducefn"
+            is associative, the result is the same no matter how many threads ran.
+            Throws a std::runtime_error if cancelled through "pctrl" before every chunk was reduced.
+    */
+    template<class _Ty, class _MapFn, class _RedFn>
+        _Ty parallel_reduce( size_t beg, size_t end, size_t grain, _Ty init, _MapFn && mapfn, _RedFn && reducefn, parallel_ctrl * pctrl = nullptr )
+    {
+        if( end <= beg )
+            return std::move(init);
+        if( grain == 0 )
+            grain = 1;
+
+        //The copies of init are only placeholders, and never end up in the result
+        const size_t      nbchunks = (end - beg + grain - 1) / grain;
+        std::vector<_Ty>  chunkresults( nbchunks, init );
+        std::vector<char> chunkdone   ( nbchunks, 0 );
+        RunChunked( beg, end, grain, [&]( size_t chunkbeg, size_t chunkend )
+        {
+            const size_t chunk   = (chunkbeg - beg) / grain;
+            _Ty          partial = mapfn(chunkbeg);
+            for( size_t i = chunkbeg + 1; i < chunkend; ++i )
+                partial = reducefn( std::move(partial), mapfn(i) );
+            chunkresults[chunk] = std::move(partial);
+            chunkdone[chunk]    = 1;
+        }, pctrl );
+
+        //Chunks are only ever skipped when cancelled, and a partial reduction isn't worth returning
+        if( std::find( chunkdone.begin(), chunkdone.end(), 0 ) != chunkdone.end() )
+            throw std::runtime_error("parallel_reduce(): Cancelled before all the items were reduced!");
+
+        for( auto & partial : chunkresults )
+            init = reducefn( std::move(init), std::move(partial) );
+        return std::move(init);
+    }
+
 //======================================================================================================================================
 //  ThreadedTasks
 //======================================================================================================================================
@@ -8,6 +8,12 @@
 #include <sstream>
 #include <vector>
 #include <string>
+#include <cstdio>
+#include <stdexcept>
+#ifdef _WIN32
+    #include <Poco/UnWindows.h>
+    #include <Poco/UnicodeConverter.h>
+#endif
 using namespace std;
 
 namespace utils
@@ -147,6 +153,23 @@ namespace utils
         return std::move(relative.makeAbsolute().toString());
     }
 
+    void RenameReplaceExisting( const std::string & srcpath, const std::string & destpath )
+    {
+#ifdef _WIN32
+        //Poco::File::renameTo uses MoveFileW, which fails when the destination exists
+        std::wstring usrc;
+        std::wstring udest;
+        Poco::UnicodeConverter::toUTF16( srcpath,  usrc );
+        Poco::UnicodeConverter::toUTF16( destpath, udest );
+        if( MoveFileExW( usrc.c_str(), udest.c_str(), MOVEFILE_REPLACE_EXISTING ) == 0 )
+            throw std::runtime_error( "RenameReplaceExisting(): Couldn't rename \"" + srcpath + "\" to \"" + destpath + "\"!" );
+#else
+        //POSIX rename already replaces the destination atomically
+        if( std::rename( srcpath.c_str(), destpath.c_str() ) != 0 )
+            throw std::runtime_error( "RenameReplaceExisting(): Couldn't rename \"" + srcpath + "\" to \"" + destpath + "\"!" );
+#endif
+    }
+
 //#ifndef POCO_STATIC
 //    /*
 //        StubApp
@@ -110,6 +110,15 @@ namespace utils
     */
     std::string MakeAbsolutePath( const std::string & relp, const std::string & absbasep );
     std::string MakeAbsolutePath( const std::string & relp );
+
+    /************************************************************************
+        RenameReplaceExisting
+            Renames a file, replacing any file already at the destination
+            in a single step. So, unlike removing the destination first,
+            other processes see either the old or the new file, never none.
+            Both paths must be on the same volume. Throws on failure.
+    ************************************************************************/
+    void RenameReplaceExisting( const std::string & srcpath, const std::string & destpath );
 };
 
 #endif
\ No newline at end of file
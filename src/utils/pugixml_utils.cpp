@@ -92,4 +92,74 @@ namespace pugixmlutils
             throw runtime_error( sstr.str() );
         }
     }
+
+//
+//  XMLRootStreamWriter
+//
+    XMLRootStreamWriter::XMLRootStreamWriter( const std::string & fpath, const pugi::char_t * indent, unsigned int flags, pugi::xml_encoding encoding )
+        :m_indent(indent), m_flags(flags), m_encoding(encoding), m_bwrotestart(false)
+    {
+        m_out.open( fpath, std::ios::out | std::ios::binary | std::ios::trunc );
+    }
+
+    void XMLRootStreamWriter::BeginRoot( const pugi::xml_node & root )
+    {
+        using namespace pugi;
+        //Same as what xml_document::save writes before the document's content
+        if( (m_flags & format_write_bom) && m_encoding != encoding_latin1 )
+            m_out << "\xef\xbb\xbf";
+        if( !(m_flags & format_no_declaration) )
+        {
+            m_out << "<?xml version=\"1.0\"";
+            if( m_encoding == encoding_latin1 )
+                m_out << " encoding=\"ISO-8859-1\"";
+            m_out << "?>";
+            if( !(m_flags & format_raw) )
+                m_out << '\n';
+        }
+
+        //Let pugixml format and escape the start tag. A childless element is written as "<name attrs />"
+        std::stringstream sstag;
+        root.print( sstag, PUGIXML_TEXT(""), m_flags | format_raw, m_encoding, 0 );
+        m_roottag     = sstag.str();
+#ifdef PUGIXML_WCHAR_MODE
+        m_rootend     = "</" + as_utf8(root.name()) + ">";
+#else
+        m_rootend     = std::string("</") + root.name() + ">";
+#endif
+        m_bwrotestart = false;
+    }
+
+    void XMLRootStreamWriter::WriteRootStartTag()
+    {
+        static const std::string EmptyElemEnd = " />";
+        m_out.write( m_roottag.data(), m_roottag.size() - EmptyElemEnd.size() );
+        m_out << '>';
+        if( !(m_flags & pugi::format_raw) )
+            m_out << '\n';
+        m_bwrotestart = true;
+    }
+
+    void XMLRootStreamWriter::WriteChildren( const pugi::xml_node & parent )
+    {
+        for( const pugi::xml_node & child : parent.children() )
+        {
+            if( !m_bwrotestart )
+                WriteRootStartTag();
+            child.print( m_out, m_indent.c_str(), m_flags, m_encoding, 1 );
+        }
+    }
+
+    bool XMLRootStreamWriter::EndRoot()
+    {
+        if( !m_bwrotestart )
+            m_out << m_roottag; //Root had no children
+        else
+            m_out << m_rootend;
+
+        if( !(m_flags & pugi::format_raw) )
+            m_out << '\n';
+        m_out.flush();
+        return m_out.good();
+    }
 };
\ No newline at end of file
@@ -13,6 +13,8 @@ Description:
 #include <codecvt>
 #include <locale>
 #include <sstream>
+#include <fstream>
+#include <vector>
 
 namespace pugixmlutils
 {
@@ -210,6 +212,45 @@ namespace pugixmlutils
             If there were no errors while parsing does nothing. Otherwise throws an appropriate exception!
     */
     void HandleParsingError( const pugi::xml_parse_result & result, const std::string & xmlpath );
+
+
+    /***************************************************************************************
+        XMLRootStreamWriter
+            Writes a xml document to a file one subtree at a time, so that only the 
+            subtree currently being written has to be kept in memory as a DOM.
+            The output is identical to calling xml_document::save_file on the whole 
+            document with the same indent, flags and encoding.
+
+            - BeginRoot     : Pass a childless node with the root element's name and attributes.
+            - WriteChildren : Appends a copy of all the children of the node to the root element.
+                              The node can be discarded right after.
+            - EndRoot       : Closes the root element and flushes. Returns false if anything 
+                              couldn't be written to the file.
+    ***************************************************************************************/
+    class XMLRootStreamWriter
+    {
+    public:
+        XMLRootStreamWriter( const std::string  & fpath, 
+                             const pugi::char_t * indent   = PUGIXML_TEXT("\t"), 
+                             unsigned int         flags    = pugi::format_default, 
+                             pugi::xml_encoding   encoding = pugi::encoding_utf8 );
+
+        void BeginRoot    ( const pugi::xml_node & root );
+        void WriteChildren( const pugi::xml_node & parent );
+        bool EndRoot      ();
+
+    private:
+        void WriteRootStartTag();
+
+    private:
+        std::ofstream       m_out;
+        pugi::string_t      m_indent;
+        unsigned int        m_flags;
+        pugi::xml_encoding  m_encoding;
+        std::string         m_roottag;      //The root's start tag, as written by pugixml for a childless element
+        std::string         m_rootend;      //The root's end tag
+        bool                m_bwrotestart;  //Whether the root's start tag was written yet
+    };
 };
 
 #endif
\ No newline at end of file